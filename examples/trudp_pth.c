@@ -302,6 +302,10 @@ void network_select_loop(trudp_data_t *tru, int timeout) {
     FD_ZERO(&rfds);
     FD_SET(td->fd, &rfds);
 
+    // Watch data sent by trudp_send
+    int submit_fd = trudpGetSubmitQueueFd(td);
+    if(submit_fd >= 0) FD_SET(submit_fd, &rfds);
+
     pthread_mutex_lock(&tru->mutex);
 
     // Add write queue to processing
@@ -323,7 +327,13 @@ void network_select_loop(trudp_data_t *tru, int timeout) {
 
     pthread_mutex_unlock(&tru->mutex);
 
-    rv = select((int)td->fd + 1, &rfds, &wfds, NULL, &tv);
+    rv = select((submit_fd > td->fd ? submit_fd : (int)td->fd) + 1, &rfds,
+            &wfds, NULL, &tv);
+
+    // Send data added by trudp_send
+    pthread_mutex_lock(&tru->mutex);
+    trudpProcessSubmitQueue(td);
+    pthread_mutex_unlock(&tru->mutex);
 
     // Error
     if (rv == -1) {
@@ -409,6 +419,7 @@ trudp_data_t *trudp_init(trudp_options *o) {
     else {
         trudp_data_t *tru = malloc(sizeof(trudp_data_t));
         tru->td = trudpInit(fd, o->local_port_i, event_cb, tru);
+        trudpSetSubmitQueue(tru->td, 1024);
         tru->rq = trudpReadQueueNew();
         tru->running = 1;
         tru->fd = fd;
@@ -488,21 +499,14 @@ void trudp_free_recv_data(void *data) {
 }
 
 int trudp_send(trudp_data_t *tru, void *tcd, void *msg, size_t msg_length) {
-/*    pthread_mutex_lock(&tru->mutex);
 
-    int s = 0;
-    // Check Send queue size and sleep if too match
-    while((s = trudpSendQueueSize(((trudpChannelData *)tcd)->sendQueue))>120) {
-        pthread_mutex_unlock(&tru->mutex);
+    // Data is sent by network thread, wait while submit queue is full
+    trudpChannelData *tcd_ = (trudpChannelData *)tcd;
+    while(trudpSubmitSendData(tru->td, (__CONST_SOCKADDR_ARG)&tcd_->remaddr,
+            tcd_->addrlen, tcd_->channel, msg, msg_length)) {
+        if(msg_length > TRUDP_MAX_DATA_LENGTH) return -1;
         usleep(1000);
-        pthread_mutex_lock(&tru->mutex);
     }
 
-    int rv = trudpChannelSendData(tcd, msg, msg_length);
-    pthread_mutex_unlock(&tru->mutex);
-    //usleep(10);
-    return rv;
-*/
-    // TODO: Need fix this test
-    return -1;
+    return (int)msg_length;
 }
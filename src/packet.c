@@ -49,7 +49,8 @@ typedef struct trudpHeader {
   uint8_t version : 4; ///< Protocol version number
   /**
    * Message type could be of type:
-   * DATA(0x0), ACK(0x1), RESET(0x2), ACK_RESET(0x3), PING(0x4), ACK_PING(0x5)
+   * DATA(0x0), ACK(0x1), RESET(0x2), ACK_RESET(0x3), PING(0x4), ACK_PING(0x5),
+   * DGRAM(0x6), SKIP(0x8)
    */
   uint8_t message_type : 4;
   /**
@@ -77,6 +78,10 @@ typedef struct trudpHeader {
 
 #pragma pack(pop)
 
+// Check TRUDP_HEADER_LENGTH constant used to allocate buffers for packets
+typedef char trudpHeaderLengthCheck[
+    sizeof(trudpHeader) == TRUDP_HEADER_LENGTH ? 1 : -1];
+
 // Local functions
 static void _trudpHeaderACKcreate(trudpHeader *out_th, trudpHeader *in_th);
 static void _trudpHeaderACKtoRESETcreate(trudpHeader *out_th,
@@ -250,8 +255,8 @@ static void _trudpHeaderACKtoPINGcreate(trudpPacket* packet, trudpHeader *in_th,
   _trudpHeaderCreate(packet_header, in_th->id, TRU_ACK | TRU_PING, in_th->channel,
                      in_th->payload_length, in_th->timestamp);
 
-  if (data != NULL && data_length != 0) {
-    void* packet_data = trudpPacketGetData(packet);
+  void* packet_data = trudpPacketGetData(packet);
+  if (data != NULL && data_length != 0 && data != packet_data) {
     memcpy(packet_data, data, data_length);
   }
 }
@@ -283,8 +288,8 @@ static void _trudpHeaderDATAcreate(trudpPacket* packet, uint32_t id,
   _trudpHeaderCreate(packet_header, id, TRU_DATA, channel, data_length,
                      trudpGetTimestamp());
 
-  if (data != NULL && data_length != 0) {
-    void* packet_data = trudpPacketGetData(packet);
+  void* packet_data = trudpPacketGetData(packet);
+  if (data != NULL && data_length != 0 && data != packet_data) {
     memcpy(packet_data, data, data_length);
   }
 }
@@ -303,8 +308,8 @@ static void _trudpHeaderPINGcreate(trudpPacket* packet, uint32_t id,
   _trudpHeaderCreate(packet_header, id, TRU_PING, channel, data_length,
                      trudpGetTimestamp());
 
-  if (data != NULL && data_length != 0) {
-    void* packet_data = trudpPacketGetData(packet);
+  void* packet_data = trudpPacketGetData(packet);
+  if (data != NULL && data_length != 0 && data != packet_data) {
     memcpy(packet_data, data, data_length);
   }
 }
@@ -340,6 +345,203 @@ trudpPacket* trudpPacketCheck(uint8_t* data, size_t packet_length) {
   }
 }
 
+/**
+ * Create ACK packet in buffer
+ *
+ * @param buffer Buffer to create packet in, trudpPacketACKlength() bytes
+ * @param packet Pointer to received TR-UDP packet
+ *
+ * @return Length of created packet
+ */
+size_t trudpPacketACKcreate(void *buffer, trudpPacket* packet) {
+  _trudpHeaderACKcreate((trudpHeader*)buffer, _trudpPacketGetHeader(packet));
+  return sizeof(trudpHeader);
+}
+
+/**
+ * Create ACK packet with selective acknowledgement in buffer. Payload contains
+ * cumulative id and first and last ids of each range (32 bit each), peers
+ * which don't support it process ACK of packet id only
+ *
+ * @param buffer Buffer to create packet in, TRUDP_SACK_MAX_LENGTH bytes
+ * @param packet Pointer to received TR-UDP packet
+ * @param sack Receiver state
+ *
+ * @return Length of created packet
+ */
+size_t trudpPacketACKcreateSack(void *buffer, trudpPacket* packet,
+                                const trudpSack *sack) {
+  trudpHeader *in_th = _trudpPacketGetHeader(packet);
+  uint32_t payload[1 + TRUDP_SACK_MAX_RANGES * 2];
+  size_t i, num = sack->num < TRUDP_SACK_MAX_RANGES ? sack->num
+                                                     : TRUDP_SACK_MAX_RANGES;
+
+  payload[0] = sack->cumulative;
+  for (i = 0; i < num; i++) {
+    payload[1 + i * 2] = sack->range[i].first;
+    payload[2 + i * 2] = sack->range[i].last;
+  }
+  uint16_t payload_length = (uint16_t)((1 + num * 2) * sizeof(uint32_t));
+  memcpy((trudpHeader *)buffer + 1, payload, payload_length);
+  _trudpHeaderCreate((trudpHeader *)buffer, in_th->id, TRU_ACK,
+                     in_th->channel, payload_length, in_th->timestamp);
+
+  return sizeof(trudpHeader) + payload_length;
+}
+
+/**
+ * Get selective acknowledgement from ACK packet
+ *
+ * @param packet Pointer to received ACK packet (checked by trudpPacketCheck)
+ * @param sack [out] Receiver state
+ *
+ * @return Zero at success or -1 if ACK has not selective acknowledgement
+ */
+int trudpPacketACKgetSack(trudpPacket* packet, trudpSack *sack) {
+  trudpHeader *th = _trudpPacketGetHeader(packet);
+  size_t length = th->payload_length;
+  if (length < sizeof(uint32_t) || (length - sizeof(uint32_t)) % 8) return -1;
+
+  uint32_t payload[1 + TRUDP_SACK_MAX_RANGES * 2];
+  size_t i, num = (length - sizeof(uint32_t)) / 8;
+  if (num > TRUDP_SACK_MAX_RANGES) num = TRUDP_SACK_MAX_RANGES;
+  memcpy(payload, th + 1, (1 + num * 2) * sizeof(uint32_t));
+
+  sack->cumulative = payload[0];
+  sack->num = num;
+  for (i = 0; i < num; i++) {
+    sack->range[i].first = payload[1 + i * 2];
+    sack->range[i].last = payload[2 + i * 2];
+  }
+
+  return 0;
+}
+
+/**
+ * Create ACK to RESET packet in buffer
+ *
+ * @param buffer Buffer to create packet in, trudpPacketACKlength() bytes
+ * @param packet Pointer to received TR-UDP packet (header)
+ *
+ * @return Length of created packet
+ */
+size_t trudpPacketACKtoRESETcreate(void *buffer, trudpPacket* packet) {
+  _trudpHeaderACKtoRESETcreate((trudpHeader*)buffer,
+                               _trudpPacketGetHeader(packet));
+  return sizeof(trudpHeader);
+}
+
+/**
+ * Create ACK to PING packet in buffer
+ *
+ * @param buffer Buffer to create packet in, length of received packet bytes
+ * @param packet Pointer to received TR-UDP packet (header)
+ *
+ * @return Length of created packet
+ */
+size_t trudpPacketACKtoPINGcreate(void *buffer, trudpPacket* packet) {
+  size_t data_length = trudpPacketGetDataLength(packet);
+
+  _trudpHeaderACKtoPINGcreate((trudpPacket*)buffer,
+                              _trudpPacketGetHeader(packet),
+                              trudpPacketGetData(packet), data_length);
+
+  return sizeof(trudpHeader) + data_length;
+}
+
+/**
+ * Create RESET packet in buffer
+ *
+ * @param buffer Buffer to create packet in, trudpPacketRESETlength() bytes
+ * @param id Packet ID
+ * @param channel Channel number
+ *
+ * @return Length of created packet
+ */
+size_t trudpPacketRESETcreate(void *buffer, uint32_t id, unsigned int channel) {
+  _trudpHeaderRESETcreate((trudpPacket*)buffer, id, channel);
+  return sizeof(trudpHeader);
+}
+
+/**
+ * Create DATA packet in buffer
+ *
+ * @param buffer Buffer to create packet in, header length plus data_length
+ *        bytes
+ * @param id Packet ID
+ * @param channel TR-UDP channel
+ * @param data Pointer to packet data. Data is not copied if it is already
+ *        placed after header in the buffer (trudpPacketGetData(buffer)), if
+ *        it is NULL only header is created (data is sent separately)
+ * @param data_length Packet data length
+ *
+ * @return Length of created packet
+ */
+size_t trudpPacketDATAcreate(void *buffer, uint32_t id, unsigned int channel,
+                             void *data, size_t data_length) {
+  _trudpHeaderDATAcreate((trudpPacket*)buffer, id, channel, data, data_length);
+  return sizeof(trudpHeader) + data_length;
+}
+
+/**
+ * Create SKIP packet in buffer
+ *
+ * @param buffer Buffer to create packet in, header length bytes
+ * @param id ID of expired DATA packet
+ * @param channel TR-UDP channel
+ *
+ * @return Length of created packet
+ */
+size_t trudpPacketSKIPcreate(void *buffer, uint32_t id, unsigned int channel) {
+  _trudpHeaderCreate((trudpHeader*)buffer, id, TRU_SKIP, channel, 0,
+                     trudpGetTimestamp());
+  return sizeof(trudpHeader);
+}
+
+/**
+ * Create unreliable DATA (DGRAM) packet in buffer
+ *
+ * @param buffer Buffer to create packet in, header length plus data_length
+ *        bytes
+ * @param id Datagram ID (channel datagrams counter)
+ * @param channel TR-UDP channel
+ * @param data Pointer to packet data, if it is NULL only header is created
+ *        (data is sent separately)
+ * @param data_length Packet data length
+ *
+ * @return Length of created packet
+ */
+size_t trudpPacketDGRAMcreate(void *buffer, uint32_t id, unsigned int channel,
+                              void *data, size_t data_length) {
+  trudpHeader* packet_header = (trudpHeader*)buffer;
+
+  _trudpHeaderCreate(packet_header, id, TRU_DGRAM, channel, data_length,
+                     trudpGetTimestamp());
+  if (data != NULL && data_length != 0) {
+    memcpy(packet_header + 1, data, data_length);
+  }
+
+  return sizeof(trudpHeader) + data_length;
+}
+
+/**
+ * Create PING packet in buffer
+ *
+ * @param buffer Buffer to create packet in, header length plus data_length
+ *        bytes
+ * @param id Packet ID (last send Id)
+ * @param channel TR-UDP cannel
+ * @param data Pointer to packet data
+ * @param data_length Packet data length
+ *
+ * @return Length of created packet
+ */
+size_t trudpPacketPINGcreate(void *buffer, uint32_t id, unsigned int channel,
+                             void *data, size_t data_length) {
+  _trudpHeaderPINGcreate((trudpPacket*)buffer, id, channel, data, data_length);
+  return sizeof(trudpHeader) + data_length;
+}
+
 /**
  * Create ACK packet
  *
@@ -348,12 +550,8 @@ trudpPacket* trudpPacketCheck(uint8_t* data, size_t packet_length) {
  * @return Pointer to allocated ACK packet, it should be free after use
  */
 trudpPacket* trudpPacketACKcreateNew(trudpPacket* packet) {
-  trudpHeader* in_th = _trudpPacketGetHeader(packet);
-
   trudpPacket* ack_packet = (trudpPacket*)malloc(sizeof(trudpHeader));
-  trudpHeader* out_th = _trudpPacketGetHeader(ack_packet);
-
-  _trudpHeaderACKcreate(out_th, in_th);
+  trudpPacketACKcreate(ack_packet, packet);
 
   return ack_packet;
 }
@@ -366,12 +564,8 @@ trudpPacket* trudpPacketACKcreateNew(trudpPacket* packet) {
  * @return Pointer to allocated ACK package, it should be free after use
  */
 trudpPacket* trudpPacketACKtoRESETcreateNew(trudpPacket* packet) {
-  trudpHeader* in_th = _trudpPacketGetHeader(packet);
-
   trudpPacket* ack_packet = (trudpPacket*)malloc(sizeof(trudpHeader));
-  trudpHeader* out_th = _trudpPacketGetHeader(ack_packet);
-
-  _trudpHeaderACKtoRESETcreate(out_th, in_th);
+  trudpPacketACKtoRESETcreate(ack_packet, packet);
 
   return ack_packet;
 }
@@ -384,13 +578,9 @@ trudpPacket* trudpPacketACKtoRESETcreateNew(trudpPacket* packet) {
  * @return Pointer to allocated ACK package, it should be free after use
  */
 trudpPacket* trudpPacketACKtoPINGcreateNew(trudpPacket* packet) {
-  size_t data_length = trudpPacketGetDataLength(packet);
-  size_t new_packet_length = sizeof(trudpHeader) + data_length;
-
-  trudpPacket* ack_packet = (trudpPacket*)malloc(new_packet_length);
-
-  _trudpHeaderACKtoPINGcreate(ack_packet, _trudpPacketGetHeader(packet),
-                              trudpPacketGetData(packet), data_length);
+  trudpPacket* ack_packet =
+      (trudpPacket*)malloc(trudpPacketGetPacketLength(packet));
+  trudpPacketACKtoPINGcreate(ack_packet, packet);
 
   return ack_packet;
 }
@@ -405,8 +595,7 @@ trudpPacket* trudpPacketACKtoPINGcreateNew(trudpPacket* packet) {
  */
 trudpPacket* trudpPacketRESETcreateNew(uint32_t id, unsigned int channel) {
   trudpPacket* packet = (trudpPacket*)malloc(sizeof(trudpHeader));
-
-  _trudpHeaderRESETcreate(packet, id, channel);
+  trudpPacketRESETcreate(packet, id, channel);
 
   return packet;
 }
@@ -425,11 +614,9 @@ trudpPacket* trudpPacketRESETcreateNew(uint32_t id, unsigned int channel) {
  */
 trudpPacket* trudpPacketDATAcreateNew(uint32_t id, unsigned int channel, void *data,
                                size_t data_length, size_t *packet_length) {
-  size_t new_packet_length = sizeof(trudpHeader) + data_length;
-
-  trudpPacket* packet = (trudpPacket*)malloc(new_packet_length);
-
-  _trudpHeaderDATAcreate(packet, id, channel, data, data_length);
+  trudpPacket* packet = (trudpPacket*)malloc(sizeof(trudpHeader) + data_length);
+  size_t new_packet_length =
+      trudpPacketDATAcreate(packet, id, channel, data, data_length);
 
   if (packet_length != NULL) {
     *packet_length = new_packet_length;
@@ -452,11 +639,9 @@ trudpPacket* trudpPacketDATAcreateNew(uint32_t id, unsigned int channel, void *d
  */
 trudpPacket* trudpPacketPINGcreateNew(uint32_t id, unsigned int channel, void *data,
                                size_t data_length, size_t *packet_length) {
-  size_t new_packet_length = sizeof(trudpHeader) + data_length;
-
-  trudpPacket* packet = (trudpPacket*)malloc(new_packet_length);
-
-  _trudpHeaderPINGcreate(packet, id, channel, data, data_length);
+  trudpPacket* packet = (trudpPacket*)malloc(sizeof(trudpHeader) + data_length);
+  size_t new_packet_length =
+      trudpPacketPINGcreate(packet, id, channel, data, data_length);
 
   if (packet_length != NULL) {
     *packet_length = new_packet_length;
@@ -498,6 +683,16 @@ uint32_t trudpPacketGetId(trudpPacket *packet) {
   return packet_header->id;
 }
 
+/**
+ * Get packet channel number
+ *
+ * @param packet Pointer to packet
+ * @return Channel number
+ */
+int trudpPacketGetChannel(trudpPacket *packet) {
+  return _trudpPacketGetChannel(packet);
+}
+
 /**
  * Get channel number
  *
@@ -614,6 +809,8 @@ const char *STRING_trudpPacketType(trudpPacketType value) {
     case TRU_ACK_TRU_RESET: return "TRU_ACK_TRU_RESET";
     case TRU_PING: return "TRU_PING";
     case TRU_ACK_PING: return "TRU_ACK_PING";
+    case TRU_DGRAM: return "TRU_DGRAM";
+    case TRU_SKIP: return "TRU_SKIP";
     default: break;
     }
     return "INVALID trudpPacketType";
@@ -46,6 +46,11 @@ extern "C" {
 #define MAX_ACK_WAIT 0.500                     // 500 MS
 #define MAX_MAX_ACK_WAIT (MAX_ACK_WAIT * 20.0) // 10 sec
 #define MAX_ATTEMPT 5 // maximum attempt with MAX_MAX_ACK_WAIT wait value
+#define TRUDP_HEADER_LENGTH 12 // TR-UDP packet header length
+#define TRUDP_MAX_DATA_LENGTH 0xFFF // Maximum packet payload length (12 bit)
+#define TRUDP_MAX_PACKET_LENGTH (TRUDP_HEADER_LENGTH + TRUDP_MAX_DATA_LENGTH)
+#define TRUDP_SACK_MAX_RANGES 4 // Maximum number of received ranges in ACK
+#define TRUDP_SACK_MAX_LENGTH (TRUDP_HEADER_LENGTH + 4 + TRUDP_SACK_MAX_RANGES * 8)
 
 /**
  * Forward declaration of TR_UDP packet type.
@@ -77,22 +82,56 @@ typedef enum trudpPacketType {
                      ///< payload)
   TRU_PING, ///< #4 PING The DATA messages can carrying payload, does not sent
             ///< to User level as DATA received. (payload allowed)
-  TRU_ACK_PING ///< #5 = TRU_ACK | TRU_PING: ACK for PING (payload allowed)
+  TRU_ACK_PING, ///< #5 = TRU_ACK | TRU_PING: ACK for PING (payload allowed)
+  TRU_DGRAM, ///< #6 Unreliable DATA: is not acknowledged and resent, sent to
+             ///< User level as soon as received. (has payload)
+  TRU_SKIP = 8 ///< #8 SKIP replaces expired DATA with the same ID: it is
+               ///< acknowledged as DATA, but is not sent to User level.
+               ///< (has not payload)
 
 } trudpPacketType;
 
+/**
+ * Selective acknowledgement: receiver state carried in ACK payload
+ */
+typedef struct trudpSack {
+
+  uint32_t cumulative; ///< Expected id: all packets before it are received
+  size_t num; ///< Number of ranges
+  /**
+   * Ranges of packets received after not received cumulative id, in id
+   * order. First and last ids are included in range
+   */
+  struct {
+    uint32_t first;
+    uint32_t last;
+  } range[TRUDP_SACK_MAX_RANGES];
+
+} trudpSack;
+
 TRUDP_API uint32_t trudpGetTimestamp();
 TRUDP_API uint32_t trudpPacketGetId(trudpPacket *packet);
+TRUDP_API int trudpPacketGetChannel(trudpPacket *packet);
 TRUDP_API trudpPacketType trudpPacketGetType(trudpPacket *packet);
 TRUDP_API size_t trudpPacketGetPacketLength(trudpPacket *packet);
 
 TRUDP_API uint64_t teoGetTimestampFull();
+size_t trudpPacketACKcreate(void *buffer, trudpPacket* packet);
 trudpPacket* trudpPacketACKcreateNew(trudpPacket* packet);
 size_t trudpPacketACKlength();
+size_t trudpPacketACKcreateSack(void *buffer, trudpPacket* packet,
+                                const trudpSack *sack);
+int trudpPacketACKgetSack(trudpPacket* packet, trudpSack *sack);
+size_t trudpPacketACKtoPINGcreate(void *buffer, trudpPacket* packet);
 trudpPacket* trudpPacketACKtoPINGcreateNew(trudpPacket* packet);
+size_t trudpPacketACKtoRESETcreate(void *buffer, trudpPacket* packet);
 trudpPacket* trudpPacketACKtoRESETcreateNew(trudpPacket* packet);
 trudpPacket* trudpPacketCheck(uint8_t* data, size_t packet_length);
 void trudpPacketCreatedFree(trudpPacket* packet);
+size_t trudpPacketDATAcreate(void *buffer, uint32_t id, unsigned int channel,
+                             void *data, size_t data_length);
+size_t trudpPacketDGRAMcreate(void *buffer, uint32_t id, unsigned int channel,
+                              void *data, size_t data_length);
 trudpPacket* trudpPacketDATAcreateNew(uint32_t id, unsigned int channel, void *data,
                                size_t data_length, size_t *packetLength);
 TRUDP_API void* trudpPacketGetData(trudpPacket *packet);
@@ -101,10 +140,14 @@ size_t trudpPacketGetHeaderLength(trudpPacket *packet);
 uint32_t trudpPacketGetTimestamp(trudpPacket *packet);
 void trudpPacketUpdateTimestamp(trudpPacket *packet);
 
+size_t trudpPacketPINGcreate(void *buffer, uint32_t id, unsigned int channel,
+                             void *data, size_t data_length);
 trudpPacket* trudpPacketPINGcreateNew(uint32_t id, unsigned int channel, void *data,
                                size_t data_length, size_t *packetLength);
+size_t trudpPacketRESETcreate(void *buffer, uint32_t id, unsigned int channel);
 trudpPacket* trudpPacketRESETcreateNew(uint32_t id, unsigned int channel);
 size_t trudpPacketRESETlength();
+size_t trudpPacketSKIPcreate(void *buffer, uint32_t id, unsigned int channel);
 TRUDP_API void trudpPacketHeaderDump(char *buffer, size_t buffer_len, trudpPacket *packet);
 
 const char *STRING_trudpPacketType(trudpPacketType value);
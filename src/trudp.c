@@ -29,6 +29,7 @@
 
 #include "trudp.h"
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -46,6 +47,11 @@
 #include "packet_queue.h"
 
 // Local functions
+static trudpChannelData *_trudpGetChannelCreateKey(trudpData *td,
+        const trudpChannelKey *key, __CONST_SOCKADDR_ARG addr,
+        socklen_t addr_len);
+static void _trudpProcessReceivedPacket(trudpData* td, uint8_t* data,
+        size_t recvlen, __CONST_SOCKADDR_ARG remaddr, socklen_t addr_len);
 
 #ifdef RESERVED
 static size_t trudpGetReceiveQueueMax(trudpData *td);
@@ -55,6 +61,7 @@ static size_t trudp_SendQueueGetSizeMax(trudpData *td);
 
 extern int64_t trudpOpt_CORE_keepaliveFirstPingDelay_us;
 extern int64_t trudpOpt_CORE_keepaliveNextPingDelay_us;
+extern int64_t trudpOpt_CORE_disconnectTimeoutDelay_us;
 extern bool trudpOpt_DBG_echoKeepalivePing;
 
 // Basic module functions ====================================================
@@ -74,14 +81,22 @@ trudpData *trudpInit(int fd, int port, trudpEventCb event_cb, void *user_data) {
     trudpData* trudp = (trudpData*)ccl_calloc(sizeof(trudpData));
 
     trudp->map = teoMapNew(MAP_SIZE_DEFAULT, 1);
+    trudp->idx = trudpChannelIndexNew(MAP_SIZE_DEFAULT);
+    trudp->heap = trudpChannelHeapNew(MAP_SIZE_DEFAULT);
+    trudp->keepalive = trudpTimerWheelNew(teoGetTimestampFull());
+    trudpTimerWheelListInit(&trudp->ack_list);
+    trudpTimerWheelListInit(&trudp->write_blocked_list);
+    int priority;
+    for(priority = 0; priority < WRITE_QUEUE_PRIORITIES; priority++) {
+        trudpTimerWheelListInit(&trudp->write_active_list[priority]);
+    }
+    trudp->cc_ops = trudpCcGetOps(TRUDP_CC_RENO);
+    trudpTokenBucketInit(&trudp->pacing_total, 0, PACING_BURST_SIZE);
     trudp->psq_data = NULL;
     trudp->user_data = user_data;
     trudp->port = port;
     trudp->fd = fd;
 
-    trudp->expected_max_time = UINT64_MAX;
-    trudp->channel_key = NULL;
-
     // Initialize statistic data
     trudpStatInit(trudp);
     trudp->started = teoGetTimestampFull();
@@ -103,7 +118,15 @@ trudpData *trudpInit(int fd, int port, trudpEventCb event_cb, void *user_data) {
 void trudpDestroy(trudpData* td) {
     if (td != NULL) {
         trudpSendEvent(td, DESTROY, NULL, 0, NULL);
+        trudpSetPeerCongestionControl(td, 0);
+        trudpGroupDestroyAll(td);
         teoMapDestroy(td->map);
+        trudpChannelIndexDestroy(td->idx);
+        trudpChannelHeapDestroy(td->heap);
+        trudpTimerWheelDestroy(td->keepalive);
+        trudpUdpRecvBatchDestroy(td->recv_batch);
+        trudpSetSendBatch(td, 0, 0);
+        trudpSubmitQueueDestroy(td->submit);
         free(td);
     }
 }
@@ -126,6 +149,69 @@ void trudpChannelSendEvent(trudpChannelData* tcd, int event, void* data,
     }
 }
 
+/**
+ * Send packet to channel peer: add it to egress batch if batch is enabled
+ * (trudpSetSendBatch) or send PROCESS_SEND event
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param packet Packet to send
+ * @param packet_length Packet length
+ */
+void trudpChannelSendUdp(trudpChannelData *tcd, void *packet,
+        size_t packet_length) {
+    trudpChannelSendUdpPayload(tcd, packet, packet_length, NULL);
+}
+
+/**
+ * Send packet which data is shared payload to channel peer. Egress batch
+ * sends the payload after packet header by scatter gather I/O, without
+ * batch they are joined to send PROCESS_SEND event
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param packet Packet to send (header if payload is not NULL)
+ * @param packet_length Packet (header) length
+ * @param payload Pointer to trudpPayload sent after packet or NULL
+ */
+void trudpChannelSendUdpPayload(trudpChannelData *tcd, void *packet,
+        size_t packet_length, trudpPayload *payload) {
+
+    trudpData *td = (trudpData*)tcd->td;
+    trudpUdpSendBatch *batch = td->send_batch;
+    char buffer[TRUDP_MAX_PACKET_LENGTH];
+    if (payload && (batch == NULL ||
+            packet_length + payload->length > batch->buffer_size)) {
+        memcpy(buffer, packet, packet_length);
+        memcpy(buffer + packet_length, payload->data, payload->length);
+        packet = buffer;
+        packet_length += payload->length;
+        payload = NULL;
+    }
+    if (batch == NULL) {
+        trudpChannelSendEvent(tcd, PROCESS_SEND, packet, packet_length, NULL);
+        return;
+    }
+
+    // Flush batch which waits too long
+    uint64_t ts = teoGetTimestampFull();
+    if (batch->count && ts - batch->started >= td->send_batch_delay) {
+        trudpUdpSendBatchFlush(td->fd, batch);
+    }
+
+    if (trudpUdpSendBatchAddPayload(batch, packet, packet_length, payload,
+            (const struct sockaddr *)&tcd->remaddr, tcd->addrlen, ts)) {
+        trudpUdpSendBatchFlush(td->fd, batch);
+        if (trudpUdpSendBatchAddPayload(batch, packet, packet_length, payload,
+                (const struct sockaddr *)&tcd->remaddr, tcd->addrlen, ts)) {
+            // Packet does not fit batch buffer
+            trudpUdpSendto(td->fd, packet, packet_length,
+                    (__CONST_SOCKADDR_ARG)&tcd->remaddr, tcd->addrlen);
+        }
+    }
+
+    // Flush full batch
+    if (batch->count == batch->size) trudpUdpSendBatchFlush(td->fd, batch);
+}
+
 /**
  * Execute trudpEventCb callback
  *
@@ -156,19 +242,7 @@ void trudpChannelSendEventGotData(trudpChannelData* tcd, trudpPacket *packet) {
 
 
 void trudpChannelDestroyChannel(trudpData *td, trudpChannelData *tcd) {
-	bool recalculate_expected_time = false;
-
-	if (td->channel_key == tcd->channel_key) {
-		recalculate_expected_time = true;
-		td->expected_max_time = UINT64_MAX;
-		td->channel_key = NULL;
-	}
-
 	trudpChannelDestroy(tcd);
-
-	if (recalculate_expected_time) {
-		trudpRecalculateExpectedSendTime(td);
-	}
 }
 /**
  * Destroy all trudp channels
@@ -177,8 +251,6 @@ void trudpChannelDestroyChannel(trudpData *td, trudpChannelData *tcd) {
  */
 void trudpChannelDestroyAll(trudpData *td) {
     size_t counter = teoMapSize(td->map);
-    td->expected_max_time = UINT64_MAX;
-    td->channel_key = NULL;
     while (counter != 0) {
         size_t data_len = 0;
         trudpChannelData *tcd = (trudpChannelData *)teoMapGetFirst(td->map, &data_len);
@@ -196,10 +268,7 @@ void trudpChannelDestroyAll(trudpData *td) {
  * @param channel Channel number 0-15
  */
 void trudpChannelDestroyAddr(trudpData *td, const char *addr, int port, int channel) {
-    size_t key_length;
-    const char *key = trudpMakeKey(addr, port, channel, &key_length);
-
-    trudpChannelData *tcd = (trudpChannelData *)teoMapGet(td->map, (const uint8_t*)key, key_length, NULL);
+    trudpChannelData *tcd = trudpGetChannelAddr(td, addr, port, channel);
 
     if (tcd != NULL && tcd != (void *)-1) {
         trudpChannelDestroyChannel(td, tcd);
@@ -225,6 +294,8 @@ void trudpSendResetAll(trudpData *td) {
                 teoMapIteratorElementData(el, NULL);
         trudpChannelSendRESET(tcd, NULL, 0);
     }
+
+    trudpSendBatchFlush(td);
 }
 
 /**
@@ -249,6 +320,45 @@ bool trudpIsPacketPing(uint8_t* data, size_t packet_length) {
     return false;
 }
 
+/**
+ * Process one datagram received from UDP
+ *
+ * @param td Pointer to trudpData
+ * @param data Received data
+ * @param recvlen The length in bytes of received data
+ * @param remaddr Remote address
+ * @param addr_len Remote address length
+ */
+static void _trudpProcessReceivedPacket(trudpData* td, uint8_t* data,
+        size_t recvlen, __CONST_SOCKADDR_ARG remaddr, socklen_t addr_len) {
+
+    // TR-UDP packet goes to channel of its header channel number, other data
+    // to channel 0
+    trudpPacket *packet = trudpPacketCheck(data, recvlen);
+    int channel = packet ? trudpPacketGetChannel(packet) : 0;
+
+    trudpChannelKey key;
+    trudpChannelData *tcd = (void *)-1;
+    if (!trudpChannelKeyMake(&key, remaddr, addr_len, channel)) {
+        // Don't create channel by ping packet
+        if (trudpIsPacketPing(data, recvlen) &&
+                trudpChannelIndexGet(td->idx, &key) == NULL) {
+            return;
+        }
+        tcd = _trudpGetChannelCreateKey(td, &key, remaddr, addr_len);
+    }
+
+    // FIXME: non trudp data it's return value == 0, not -1. Investigate why
+    // it works and fix appropriately
+    if(tcd == (void *)-1 || trudpChannelProcessReceivedPacket(tcd, data, recvlen) == -1) {
+        if(tcd == (void *)-1) {
+            printf("!!! can't PROCESS_RECEIVE_NO_TRUDP\n");
+        } else {
+            trudpChannelSendEvent(tcd, PROCESS_RECEIVE_NO_TRUDP, data, recvlen, NULL);
+        }
+    }
+}
+
 /**
  * Default TR-UDP process received from UDP data
  *
@@ -269,25 +379,67 @@ void trudpProcessReceived(trudpData* td, uint8_t* data, size_t data_length) {
     // Process received packet
     // TODO: Handle errors in recvfrom.
     if (recvfrom_result == TEOSOCK_RECVFROM_DATA_RECEIVED) {
-        if (trudpIsPacketPing(data, recvlen) && trudpGetChannel(td, (__CONST_SOCKADDR_ARG) &remaddr, addr_len, 0) == (void *)-1) {
-            return;
-        }
+        _trudpProcessReceivedPacket(td, data, recvlen,
+                (__CONST_SOCKADDR_ARG) &remaddr, addr_len);
+        trudpSendBatchFlush(td);
+    }
+}
+
+/**
+ * Receive batch of datagrams from UDP (one recvmmsg call where supported)
+ * and process them. Receive buffers are allocated at first call and reused.
+ * Datagrams coalesced by UDP GRO (trudpSetUdpOffload) are split to packets
+ *
+ * @param td Pointer to trudpData
+ * @param max_packets Maximum number of datagrams to receive, zero or value
+ *        greater than RECV_BATCH_MAX_SIZE means RECV_BATCH_MAX_SIZE
+ *
+ * @return Number of processed datagrams or -1 on error
+ */
+int trudpProcessReceivedBatch(trudpData* td, size_t max_packets) {
+
+    if (max_packets == 0 || max_packets > RECV_BATCH_MAX_SIZE) {
+        max_packets = RECV_BATCH_MAX_SIZE;
+    }
 
-        trudpChannelData *tcd = trudpGetChannelCreate(td, (__CONST_SOCKADDR_ARG) &remaddr, addr_len, 0);
-        // FIXME: non trudp data it's return value == 0, not -1. Investigate why
-        // it works and fix appropriately
-        if(tcd == (void *)-1 || trudpChannelProcessReceivedPacket(tcd, data, recvlen) == -1) {
-            if(tcd == (void *)-1) {
-                printf("!!! can't PROCESS_RECEIVE_NO_TRUDP\n");
-            } else {
-                trudpChannelSendEvent(tcd, PROCESS_RECEIVE_NO_TRUDP, data, recvlen, NULL);
-            }
+    if (td->recv_batch == NULL) {
+        // Coalesced by UDP GRO datagrams need large buffers
+        td->recv_batch = td->udp_gro ?
+                trudpUdpRecvBatchNew(RECV_BATCH_GRO_SIZE,
+                        RECV_BATCH_GRO_BUFFER_SIZE) :
+                trudpUdpRecvBatchNew(RECV_BATCH_MAX_SIZE,
+                        RECV_BATCH_BUFFER_SIZE);
+        if (td->recv_batch == NULL) return -1;
+    }
+
+    trudpUdpRecvBatch *batch = td->recv_batch;
+    int rv = trudpUdpRecvBatchReceive(td->fd, batch, max_packets);
+
+    size_t i;
+    for (i = 0; rv > 0 && i < batch->count; i++) {
+        uint8_t *data = batch->buffers + i * batch->buffer_size;
+        size_t length = batch->lengths[i], ptr = 0;
+        size_t segment_size = batch->segment_sizes[i] ?
+                batch->segment_sizes[i] : length;
+
+        // Split coalesced datagram to packets
+        while (ptr < length) {
+            size_t len = length - ptr < segment_size ?
+                    length - ptr : segment_size;
+            _trudpProcessReceivedPacket(td, data + ptr, len,
+                    (__CONST_SOCKADDR_ARG) &batch->addrs[i],
+                    batch->addr_lengths[i]);
+            ptr += len;
         }
     }
+    trudpSendBatchFlush(td);
+
+    return rv;
 }
 
 /**
- * Send the same data to all connected peers
+ * Send the same data to all connected peers. Data is copied once to shared
+ * payload, packets of all channels keep their headers only
  *
  * @param td Pointer to trudpData
  * @param data Pointer to data
@@ -298,6 +450,8 @@ void trudpProcessReceived(trudpData* td, uint8_t* data, size_t data_length) {
 size_t trudpSendDataToAll(trudpData *td, void *data, size_t data_length) {
 
     int rv = 0;
+    if (data_length > TRUDP_MAX_DATA_LENGTH) return 0;
+    trudpPayload *payload = trudpPayloadNew(data, data_length);
 
     teoMapIterator it;
     teoMapIteratorReset(&it, td->map);
@@ -307,15 +461,14 @@ size_t trudpSendDataToAll(trudpData *td, void *data, size_t data_length) {
         trudpChannelData *tcd = (trudpChannelData *)
                 teoMapIteratorElementData(el, NULL);
 
-        if(tcd->connected_f) {
-            // drop packets if send queue > 100 \todo move it to Send Data
-            // function or something else
-            //if(trudpSendQueueSize(tcd->sendQueue) < 100) {
-                trudpChannelSendData(tcd, data, data_length);
-                rv++;
-            //}
-        }
+        // Channels which write queue is full (trudpSetWriteQueueLimits) or
+        // which failed to send are skipped
+        if(!tcd->connected_f) continue;
+        size_t sent = trudpChannelSendPayload(tcd, payload);
+        if(sent && sent != TRUDP_SEND_WOULD_BLOCK) rv++;
     }
+    trudpPayloadRelease(payload);
+    trudpSendBatchFlush(td);
 
     return rv;
 }
@@ -323,42 +476,62 @@ size_t trudpSendDataToAll(trudpData *td, void *data, size_t data_length) {
 /**
  * Keep connection at idle line
  *
+ * Channels keepalive timers are kept in timer wheel so only channels which
+ * timer expired are processed. Received packets don't move the timer: the
+ * expired timer of channel which received packets meanwhile is moved to new
+ * deadline here.
+ *
  * @param td Pointer to trudpData
- * @return
+ * @return Number of idle channels
  */
 size_t trudpProcessKeepConnection(trudpData *td) {
 
-    int rv = -1;
-
-    teoMapIterator it;
-    teoMapElementData *el;
+    int rv = 0;
     uint64_t ts = teoGetTimestampFull();
-    while(rv == -1) {
-        teoMapIteratorReset(&it, td->map);
-        rv = 0;
-        while((el = teoMapIteratorNext(&it))) {
-            trudpChannelData *tcd = (trudpChannelData *)
-                teoMapIteratorElementData(el, NULL);
+    trudpTimerWheelNode expired, *node;
+
+    trudpTimerWheelListInit(&expired);
+    trudpTimerWheelExpire(td->keepalive, ts, &expired);
+
+    while((node = trudpTimerWheelListPop(&expired))) {
+        trudpChannelData *tcd = (trudpChannelData *)
+                ((char *)node - offsetof(trudpChannelData, keepalive));
 
-            if (tcd->connected_f) {
-                uint32_t sinceReceived = ts - tcd->lastReceived;
-                uint32_t sincePing = ts - tcd->lastSentPing;
-                if (sinceReceived > trudpOpt_CORE_keepaliveFirstPingDelay_us) {
-                    if(trudpChannelCheckDisconnected(tcd, ts) == -1) {
-                        rv = -1;
-                        break;
-                    }
-                    if (sincePing > trudpOpt_CORE_keepaliveNextPingDelay_us) {
-                        trudpChannelSendPING(tcd, "PING", 5);
-                        CLTRACK_I(trudpOpt_DBG_echoKeepalivePing, "Trudp",
-                                  "Sent keepalive ping to %s",
-                                  tcd->channel_key);
-                    }
-                    rv++;
-                }
-            }
+        if (!tcd->connected_f) {
+            trudpTimerWheelAdd(td->keepalive, node,
+                    ts + trudpOpt_CORE_keepaliveFirstPingDelay_us);
+            continue;
+        }
+
+        uint64_t sinceReceived = ts - tcd->lastReceived;
+        if (sinceReceived <= (uint64_t)trudpOpt_CORE_keepaliveFirstPingDelay_us) {
+            trudpTimerWheelAdd(td->keepalive, node, tcd->lastReceived +
+                    trudpOpt_CORE_keepaliveFirstPingDelay_us + 1);
+            continue;
+        }
+
+        // Check channel again at next ping time or at disconnect time. Set
+        // timer before events: channel may be destroyed in event callback
+        uint64_t deadline = ts + trudpOpt_CORE_keepaliveNextPingDelay_us;
+        uint64_t disconnect_time = tcd->lastReceived +
+                trudpOpt_CORE_disconnectTimeoutDelay_us + 1;
+        if (disconnect_time > ts && disconnect_time < deadline) {
+            deadline = disconnect_time;
+        }
+        trudpTimerWheelAdd(td->keepalive, node, deadline);
+        rv++;
+
+        if(trudpChannelCheckDisconnected(tcd, ts) == -1) continue;
+
+        uint64_t sincePing = ts - tcd->lastSentPing;
+        if (sincePing > (uint64_t)trudpOpt_CORE_keepaliveNextPingDelay_us) {
+            trudpChannelSendPING(tcd, "PING", 5);
+            CLTRACK_I(trudpOpt_DBG_echoKeepalivePing, "Trudp",
+                      "Sent keepalive ping to %s",
+                      tcd->channel_key);
         }
     }
+    trudpSendBatchFlush(td);
 
     return rv;
 }
@@ -403,7 +576,8 @@ trudpChannelData *trudpGetChannelAddr(trudpData *td, const char *addr,
         int port, int channel) {
 
     size_t data_length, key_length;
-    const char *key = trudpMakeKey(addr, port, channel, &key_length);
+    char key[MAX_KEY_LENGTH];
+    trudpMakeKeyBuf(key, addr, port, channel, &key_length);
     trudpChannelData *tcd = (trudpChannelData *)teoMapGet(td->map,
         (const uint8_t*)key, key_length, &data_length);
 
@@ -422,9 +596,13 @@ trudpChannelData *trudpGetChannelAddr(trudpData *td, const char *addr,
 trudpChannelData *trudpGetChannel(trudpData *td, __CONST_SOCKADDR_ARG addr, socklen_t addr_len,
         int channel) {
 
-    int port;
-    const char *addr_str = trudpUdpGetAddr(addr, addr_len, &port);
-    return trudpGetChannelAddr(td, addr_str, port, channel);
+    trudpChannelKey key;
+    if (trudpChannelKeyMake(&key, addr, addr_len, channel)) {
+        return (void *)-1;
+    }
+
+    trudpChannelData *tcd = trudpChannelIndexGet(td->idx, &key);
+    return tcd != NULL ? tcd : (void *)-1;
 }
 // \TODO: need channel alive function
 
@@ -440,15 +618,32 @@ trudpChannelData *trudpGetChannel(trudpData *td, __CONST_SOCKADDR_ARG addr, sock
  */
 trudpChannelData *trudpGetChannelCreate(trudpData *td, __CONST_SOCKADDR_ARG addr, socklen_t addr_len, int channel) {
 
-    int port;
-    const char *addr_str = trudpUdpGetAddr((__CONST_SOCKADDR_ARG)addr, addr_len, &port);
-    trudpChannelData *tcd = trudpGetChannelAddr(td, addr_str, port, channel);
-
-    if(tcd == (void*)-1) {
-        tcd = trudpChannelNew(td, addr_str, port, channel);
+    trudpChannelKey key;
+    if (trudpChannelKeyMake(&key, addr, addr_len, channel)) {
+        return (void *)-1;
     }
 
-    free((char *)addr_str);
+    return _trudpGetChannelCreateKey(td, &key, addr, addr_len);
+}
+
+/**
+ * Get trudpChannelData by binary channel key, create channel if not exists
+ *
+ * @param td Pointer to trudpData
+ * @param key Pointer to channel key made from addr
+ * @param addr Pointer to sockaddr_storage remote address
+ * @param addr_len Remote address length
+ *
+ * @return Pointer to trudpChannelData or (void*)-1 at error
+ */
+static trudpChannelData *_trudpGetChannelCreateKey(trudpData *td,
+        const trudpChannelKey *key, __CONST_SOCKADDR_ARG addr,
+        socklen_t addr_len) {
+
+    trudpChannelData *tcd = trudpChannelIndexGet(td->idx, key);
+    if (tcd == NULL) {
+        tcd = trudpChannelNewAddr(td, addr, addr_len, key->channel);
+    }
 
     if (tcd != (void*)-1 && !tcd->connected_f) {
         trudpChannelSendEvent(tcd, CONNECTED, NULL, 0, NULL);
@@ -466,14 +661,29 @@ trudpChannelData *trudpGetChannelCreate(trudpData *td, __CONST_SOCKADDR_ARG addr
  * @param td Pointer to trudpData
  * @param current_time Timestamp, usually current time
  *
- * @return Minimum timeout or UINT32_MAX if send queue is empty
+ * @return Minimum timeout or UINT32_MAX if send queue (and egress batch)
+ *         is empty
  */
 uint32_t trudpGetSendQueueTimeout(trudpData *td, uint64_t current_time) {
-    if (td->expected_max_time == UINT64_MAX) {
-        return UINT32_MAX;
+    uint64_t expected_time;
+    if (!trudpChannelHeapTop(td->heap, &expected_time)) {
+        expected_time = UINT64_MAX;
+    }
+
+    // Wake up to flush egress batch
+    if (td->send_batch && td->send_batch->count) {
+        uint64_t flush_time = td->send_batch->started + td->send_batch_delay;
+        if (flush_time < expected_time) expected_time = flush_time;
+    }
+
+    // Wake up to send delayed ACK
+    if (td->ack_list.next != &td->ack_list &&
+            td->ack_list.next->deadline < expected_time) {
+        expected_time = td->ack_list.next->deadline;
     }
+    if (expected_time == UINT64_MAX) return UINT32_MAX;
 
-    uint32_t timeout_sq = td->expected_max_time > current_time ? td->expected_max_time - current_time : 0;
+    uint32_t timeout_sq = expected_time > current_time ? expected_time - current_time : 0;
     return timeout_sq;
 }
 
@@ -511,26 +721,35 @@ static size_t trudp_SendQueueSize(trudpData *td) {
 int trudpProcessSendQueue(trudpData *td, uint64_t *next_et) {
 
     int retval, rv = 0;
-    uint64_t ts = teoGetTimestampFull(), min_expected_time, next_expected_time;
-    teoMapIterator it;
-    do {
-        retval = 0;
-        teoMapElementData *el;
-        min_expected_time = UINT64_MAX;
-
-        teoMapIteratorReset(&it, td->map);
-
-        while((el = teoMapIteratorNext(&it))) {
-            trudpChannelData *tcd = (trudpChannelData *)teoMapIteratorElementData(el, NULL);
-            retval = trudpChannelSendQueueProcess(tcd, ts, &next_expected_time);
-            if(retval < 0) break;
-            if(retval > 0) rv += retval;
-            if(next_expected_time && next_expected_time < min_expected_time)
-                min_expected_time = next_expected_time;
-        }
-    } while(retval == -1 || (retval > 0 && min_expected_time <= ts));
+    uint64_t ts = teoGetTimestampFull(), expected_time;
+    trudpChannelData *tcd;
+
+    // Send delayed ACKs which time came (list is in deadline order)
+    while(td->ack_list.next != &td->ack_list &&
+            td->ack_list.next->deadline <= ts) {
+        tcd = (trudpChannelData *)((char *)td->ack_list.next -
+                offsetof(trudpChannelData, ack_timer));
+        trudpChannelSendDelayedACK(tcd);
+    }
 
-    if(next_et) *next_et = (min_expected_time != UINT64_MAX) ? min_expected_time : 0;
+    // Process channels which expected time came only, channel moves to its
+    // next expected time (or leaves the heap) when processed
+    while((tcd = trudpChannelHeapTop(td->heap, &expected_time)) &&
+            expected_time <= ts) {
+        retval = trudpChannelSendQueueProcess(tcd, ts, NULL);
+        if(retval > 0) rv += retval;
+        // Channel was not changed (disconnected and not destroyed)
+        if(retval <= 0 && trudpChannelHeapTop(td->heap, NULL) == tcd) break;
+    }
+
+    trudpSendBatchFlush(td);
+
+    trudpChannelHeapTop(td->heap, &expected_time);
+    if(td->ack_list.next != &td->ack_list &&
+            td->ack_list.next->deadline < expected_time) {
+        expected_time = td->ack_list.next->deadline;
+    }
+    if(next_et) *next_et = (expected_time != UINT64_MAX) ? expected_time : 0;
 
     return rv;
 }
@@ -553,7 +772,7 @@ static size_t trudp_SendQueueGetSizeMax(trudpData *td) {
     while((el = teoMapIteratorNext(&it))) {
         trudpChannelData *tcd = (trudpChannelData *)
                 teoMapIteratorElementData(el, NULL);
-        int size = trudpPacketQueueSize(tcd->sendQueue);
+        int size = trudpSendQueueSize(tcd->sendQueue);
         if(size > rv) rv = size;
     }
 
@@ -564,7 +783,13 @@ static size_t trudp_SendQueueGetSizeMax(trudpData *td) {
 // Write queue functions ======================================================
 
 /**
- * Check all peers write Queue elements and write one first packet
+ * Send packets of channels write queues: one deficit round robin round over
+ * channels with not empty write queue of priority class, from the highest
+ * priority (trudpChannelSetPriority) to the lowest. Every channel of the
+ * round sends up to its quantum bytes (trudpChannelSetWriteQuantum) if
+ * congestion window allows, and moves to the end of the round robin list.
+ * Priority is strict as in shared peer window: next class makes its round
+ * only if no channel of the previous one may send now
  *
  * @param td Pointer to trudpData
  *
@@ -572,24 +797,343 @@ static size_t trudp_SendQueueGetSizeMax(trudpData *td) {
  */
 size_t trudpProcessWriteQueue(trudpData *td) {
 
-    int i = 0;
     size_t retval = 0;
-    teoMapElementData *el;
-    teoMapIterator it;
+    int priority;
+
+    for(priority = 0; priority < WRITE_QUEUE_PRIORITIES; priority++) {
+        trudpTimerWheelNode *list = &td->write_active_list[priority];
+        trudpTimerWheelNode *last = list->prev, *node;
+        size_t num = td->write_active_num;
+
+        // Processed channels leave the list or move to its end, so the round
+        // ends at the channel which was the last one
+        if (last == list) continue;
+        do {
+            node = list->next;
+            retval += trudpChannelWriteQueueProcess((trudpChannelData *)
+                    ((char *)node - offsetof(trudpChannelData, write_active)));
+        } while(node != last && list->next != list && --num);
+
+        // Lower priority classes wait while this class has data to send
+        for(node = list->next; node != list; node = node->next) {
+            trudpChannelData *tcd = (trudpChannelData *)
+                    ((char *)node - offsetof(trudpChannelData, write_active));
+            if(trudpChannelWriteQueueReady(tcd)) break;
+        }
+        if(node != list) break;
+    }
+    trudpSendBatchFlush(td);
+
+    return retval;
+}
+
+// Egress batch functions =====================================================
+
+/**
+ * Enable, resize or disable egress batch. When batch is enabled packets are
+ * collected in it and sent with one sendmmsg call instead of PROCESS_SEND
+ * event per packet. The batch is flushed when it is full, when its first
+ * packet waits max_delay_us, and at the end of trudpProcessReceived,
+ * trudpProcessReceivedBatch, trudpProcessSendQueue, trudpProcessWriteQueue,
+ * trudpProcessKeepConnection, trudpSendDataToAll and trudpSendResetAll.
+ * Packets sent with trudpChannelSendData are flushed at next of these calls or
+ * by trudpSendBatchFlush
+ *
+ * @param td Pointer to trudpData
+ * @param max_packets Maximum number of packets in batch, zero to disable
+ *        batch (packets are sent by PROCESS_SEND event)
+ * @param max_delay_us Maximum time first packet waits in batch
+ *
+ * @return Zero at success or -1 at error
+ */
+int trudpSetSendBatch(trudpData *td, size_t max_packets,
+        uint32_t max_delay_us) {
+
+    if (td->send_batch) {
+        trudpSendBatchFlush(td);
+        trudpUdpSendBatchDestroy(td->send_batch);
+        td->send_batch = NULL;
+    }
+    if (max_packets == 0) return 0;
+
+    td->send_batch = trudpUdpSendBatchNew(max_packets,
+            TRUDP_MAX_PACKET_LENGTH);
+    if (td->send_batch == NULL) return -1;
+    td->send_batch->gso = td->udp_gso;
+    td->send_batch_delay = max_delay_us;
+
+    return 0;
+}
+
+/**
+ * Enable or disable UDP GSO / GRO offload (Linux). With GSO the egress batch
+ * (trudpSetSendBatch) coalesces consecutive same size packets for one peer to
+ * one datagram which kernel segments. With GRO kernel coalesces received
+ * datagrams and trudpProcessReceivedBatch splits them back, so GRO must be
+ * used with trudpProcessReceivedBatch only: trudpProcessReceived can't split
+ * coalesced datagrams
+ *
+ * @param td Pointer to trudpData
+ * @param enable Enable if true
+ *
+ * @return Zero at success or -1 if kernel does not support GSO or GRO (not
+ *         supported feature stays disabled)
+ */
+int trudpSetUdpOffload(trudpData *td, int enable) {
+
+    // Receive buffers size depends on GRO
+    trudpUdpRecvBatchDestroy(td->recv_batch);
+    td->recv_batch = NULL;
+
+    if (!enable) trudpUdpSetGRO(td->fd, 0);
+    td->udp_gro = enable && !trudpUdpSetGRO(td->fd, 1);
+    td->udp_gso = enable && !trudpUdpCheckGSO(td->fd);
+    if (td->send_batch) td->send_batch->gso = td->udp_gso;
+
+    return enable && !(td->udp_gro && td->udp_gso) ? -1 : 0;
+}
+
+/**
+ * Send packets collected in egress batch
+ *
+ * @param td Pointer to trudpData
+ *
+ * @return Number of sent packets
+ */
+int trudpSendBatchFlush(trudpData *td) {
+    if (td->send_batch == NULL || !td->send_batch->count) return 0;
+    return trudpUdpSendBatchFlush(td->fd, td->send_batch);
+}
+
+/**
+ * Set congestion control algorithm of channels: built in one
+ * (trudpCcGetOps) or user defined. Channels created before the call start
+ * with new algorithm initial window. Default algorithm is TRUDP_CC_RENO,
+ * TRUDP_CC_FIXED keeps send queue window of NORMAL_S_SIZE packets
+ *
+ * @param td Pointer to trudpData
+ * @param ops Pointer to trudpCcOps
+ *
+ * @return Zero at success or -1 if ops is NULL
+ */
+int trudpSetCongestionControl(trudpData *td, const trudpCcOps *ops) {
+
+    if (ops == NULL) return -1;
+    td->cc_ops = ops;
 
+    teoMapIterator it;
+    teoMapElementData *el;
     teoMapIteratorReset(&it, td->map);
+    while((el = teoMapIteratorNext(&it))) {
+        trudpChannelData *tcd = (trudpChannelData *)
+                teoMapIteratorElementData(el, NULL);
+        trudpCcInit(&tcd->cc, ops);
+        if (tcd->peer) trudpCcInit(&tcd->peer->cc, ops);
+    }
+
+    return 0;
+}
 
-    while(!retval && (el = teoMapIteratorNext(&it))) {
-        if(i++ < td->writeQueueIdx) continue;
+/**
+ * Enable or disable shared congestion control of channels with the same
+ * remote address and different channel numbers (peer). Peer channels send
+ * queues are limited by one congestion window, and when it opens the window
+ * is filled from write queues of channels with higher priority first
+ * (trudpChannelSetPriority), so small control messages of one channel don't
+ * wait behind bulk data of other channel to the same peer. Existing channels
+ * join or leave their peers
+ *
+ * @param td Pointer to trudpData
+ * @param enable Enable shared congestion control
+ */
+void trudpSetPeerCongestionControl(trudpData *td, int enable) {
+
+    td->peer_cc = enable;
+
+    teoMapIterator it;
+    teoMapElementData *el;
+    teoMapIteratorReset(&it, td->map);
+    while((el = teoMapIteratorNext(&it))) {
         trudpChannelData *tcd = (trudpChannelData *)
                 teoMapIteratorElementData(el, NULL);
-        retval = trudpChannelWriteQueueProcess(tcd);
-        td->writeQueueIdx++;
+        if (enable) trudpPeerAttach(tcd);
+        else trudpPeerDetach(tcd);
     }
+}
+
+/**
+ * Enable or disable send pacing. When pacing is enabled new DATA packets
+ * of channel are sent with channel pacing rate instead of back to back: they
+ * wait in write queue and are sent by trudpProcessSendQueue (the send queue
+ * timer wakes up at pacing time). Channel pacing rate is its congestion
+ * controller pacing rate limited by channel_rate, sum of all channels rates is
+ * limited by total_rate. Retransmitted packets are not delayed but take
+ * pacing tokens
+ *
+ * @param td Pointer to trudpData
+ * @param enable Enable pacing
+ * @param channel_rate Maximum channel rate (bytes per second), zero if not
+ *        limited
+ * @param total_rate Maximum rate of all channels (bytes per second), zero if
+ *        not limited
+ */
+void trudpSetPacing(trudpData *td, int enable, uint64_t channel_rate,
+        uint64_t total_rate) {
 
-    if(!retval) td->writeQueueIdx = 0;
+    td->pacing = enable;
+    td->pacing_rate = channel_rate;
+    trudpTokenBucketInit(&td->pacing_total, total_rate, PACING_BURST_SIZE);
 
-    return retval;
+    // Send packets which wait for pacing when it is disabled
+    if (!enable) while(trudpProcessWriteQueue(td));
+}
+
+/**
+ * Enable delayed ACK mode: in order DATA packets are acknowledged by one
+ * cumulative ACK per every received packets or when the first not
+ * acknowledged packet waits delay_us, which halves reverse path packet rate
+ * of bulk transfer. Outrunning and repeated packets are acknowledged at once.
+ * Delayed ACKs are sent by trudpProcessSendQueue, trudpGetSendQueueTimeout
+ * includes their time. Works with selective acknowledgements only
+ * (trudpSetOption_CORE_selectiveAck), peer should support them
+ *
+ * @param td Pointer to trudpData
+ * @param every Acknowledge every Nth packet, zero or one to disable delayed
+ *        ACK
+ * @param delay_us Maximum ACK delay
+ */
+void trudpSetDelayedAck(trudpData *td, uint32_t every, uint32_t delay_us) {
+
+    // Send ACKs delayed with previous settings
+    trudpTimerWheelNode *node;
+    while((node = trudpTimerWheelListPop(&td->ack_list))) {
+        trudpChannelSendDelayedACK((trudpChannelData *)
+                ((char *)node - offsetof(trudpChannelData, ack_timer)));
+    }
+    trudpSendBatchFlush(td);
+
+    td->ack_every = every;
+    td->ack_delay = delay_us;
+}
+
+/**
+ * Set write queue limits. Packets which can't be sent at once (congestion
+ * window is full) wait in channel write queue. When channel write queue or
+ * all channels write queues reach high watermark trudpChannelSendData returns
+ * TRUDP_SEND_WOULD_BLOCK, and the channel gets WRITABLE event when both go
+ * down to low watermarks
+ *
+ * @param td Pointer to trudpData
+ * @param channel_high Channel write queue high watermark (bytes), zero if not
+ *        limited
+ * @param channel_low Channel write queue low watermark (bytes)
+ * @param total_high All channels write queues high watermark (bytes), zero if
+ *        not limited
+ * @param total_low All channels write queues low watermark (bytes)
+ */
+void trudpSetWriteQueueLimits(trudpData *td, size_t channel_high,
+        size_t channel_low, size_t total_high, size_t total_low) {
+
+    td->wq_channel_high = channel_high;
+    td->wq_channel_low = channel_low < channel_high ? channel_low : channel_high;
+    td->wq_total_high = total_high;
+    td->wq_total_low = total_low < total_high ? total_low : total_high;
+
+    // Channels may become writable with new limits
+    trudpChannelSendWritable(td);
+}
+
+/**
+ * Create submit queue which lets other threads send data without locking
+ * trudpData (trudpSubmitSendData). The thread which runs trudpData event
+ * loop processes the queue by trudpProcessSubmitQueue when submit queue fd
+ * (trudpGetSubmitQueueFd) becomes readable
+ *
+ * @param td Pointer to trudpData
+ * @param size Maximum number of not processed messages, zero to destroy
+ *        submit queue
+ *
+ * @return Zero at success or -1 at error
+ */
+int trudpSetSubmitQueue(trudpData *td, size_t size) {
+
+    if (td->submit) {
+        trudpProcessSubmitQueue(td);
+        trudpSubmitQueueDestroy(td->submit);
+        td->submit = NULL;
+    }
+    if (size == 0) return 0;
+
+    td->submit = trudpSubmitQueueNew(size);
+
+    return td->submit == NULL ? -1 : 0;
+}
+
+/**
+ * Send data to peer from any thread. Data is copied to submit queue
+ * (trudpSetSubmitQueue) and sent by trudpProcessSubmitQueue in event loop
+ * thread, channel is created there if not exists
+ *
+ * @param td Pointer to trudpData
+ * @param addr Peer address
+ * @param addr_len Peer address length
+ * @param channel TR-UDP channel number
+ * @param data Pointer to data
+ * @param data_length Data length
+ *
+ * @return Zero at success or -1 if submit queue is not created, it is full or
+ *         data is too large
+ */
+int trudpSubmitSendData(trudpData *td, __CONST_SOCKADDR_ARG addr,
+        socklen_t addr_len, int channel, void *data, size_t data_length) {
+
+    if (td->submit == NULL || data_length > TRUDP_MAX_DATA_LENGTH) return -1;
+    return trudpSubmitQueuePush(td->submit, addr, addr_len, channel, data,
+            data_length);
+}
+
+/**
+ * Send data added to submit queue by other threads. Must be called from
+ * trudpData event loop thread
+ *
+ * @param td Pointer to trudpData
+ *
+ * @return Number of processed messages
+ */
+size_t trudpProcessSubmitQueue(trudpData *td) {
+
+    if (td->submit == NULL) return 0;
+
+    size_t num = 0;
+    trudpSubmitQueueData d;
+    trudpSubmitQueueClearEvent(td->submit);
+    while (!trudpSubmitQueuePop(td->submit, &d)) {
+        trudpChannelData *tcd = trudpGetChannelCreate(td,
+                (__CONST_SOCKADDR_ARG)&d.addr, d.addr_len, d.channel);
+        // Submit queue is limited itself, so its data is not limited by
+        // write queue limits
+        if (tcd != (void *)-1) {
+            trudpChannelSendDataUnlimited(tcd, d.data, d.data_length);
+        }
+        free(d.data);
+        num++;
+    }
+    if (num) trudpSendBatchFlush(td);
+
+    return num;
+}
+
+/**
+ * Get submit queue fd which becomes readable when other thread adds data to
+ * submit queue
+ *
+ * @param td Pointer to trudpData
+ *
+ * @return File descriptor or -1 if submit queue is not created or platform
+ *         has no wakeup event (call trudpProcessSubmitQueue every loop)
+ */
+int trudpGetSubmitQueueFd(trudpData *td) {
+    return td->submit ? trudpSubmitQueueGetFd(td->submit) : -1;
 }
 
 /**
@@ -601,15 +1145,17 @@ size_t trudpProcessWriteQueue(trudpData *td) {
 size_t trudpGetWriteQueueSize(trudpData *td) {
 
     size_t retval = 0;
-    teoMapElementData *el;
-    teoMapIterator it;
-    teoMapIteratorReset(&it, td->map);
+    trudpTimerWheelNode *node;
+    int priority;
 
-    while((el = teoMapIteratorNext(&it))) {
-        size_t data_lenth;
-        trudpChannelData *tcd = (trudpChannelData *)
-                teoMapIteratorElementData(el, &data_lenth);
-        retval += trudpWriteQueueSize(tcd->writeQueue);
+    // Only channels with not empty write queue are in write_active_list
+    for(priority = 0; priority < WRITE_QUEUE_PRIORITIES; priority++) {
+        trudpTimerWheelNode *list = &td->write_active_list[priority];
+        for(node = list->next; node != list; node = node->next) {
+            trudpChannelData *tcd = (trudpChannelData *)
+                    ((char *)node - offsetof(trudpChannelData, write_active));
+            retval += trudpWriteQueueSize(tcd->writeQueue);
+        }
     }
 
     return retval;
@@ -653,6 +1199,8 @@ const char *STRING_trudpEvent(trudpEvent val) {
       return "PROCESS_SEND";
     case GOT_DATA_NO_TRUDP:
       return "GOT_DATA_NO_TRUDP";
+    case WRITABLE:
+      return "WRITABLE";
   }
   return "INVALID trudpEvent";
 }
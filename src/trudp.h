@@ -37,6 +37,9 @@
 #include "udp.h"
 
 #include "trudp_channel.h"
+#include "trudp_channel_heap.h"
+#include "trudp_group.h"
+#include "trudp_submit_queue.h"
 #include "trudp_const.h"
 #include "trudp_api.h"
 
@@ -173,7 +176,16 @@ typedef enum trudpEvent {
      * @param data_length Length of data
      * @param user_data NULL
      */
-    GOT_DATA_NO_TRUDP
+    GOT_DATA_NO_TRUDP,
+
+    /**
+     * Channel send returned TRUDP_SEND_WOULD_BLOCK before and its write queue
+     * went down to low watermark (trudpSetWriteQueueLimits)
+     * @param data NULL
+     * @param data_length 0
+     * @param user_data NULL
+     */
+    WRITABLE
 
 } trudpEvent;
 
@@ -206,9 +218,33 @@ typedef struct trudpStatData {
 typedef struct trudpData {
 
     teoMap *map; ///< Channels map (key: ip:port:channel)
-
-    uint64_t expected_max_time;
-    char *channel_key;
+    trudpChannelIndex *idx; ///< Channels index (key: binary address, port and channel)
+    teoMap *groups; ///< Peer groups (key: group name, data: pointer to trudpChannelIndex of members, NULL if no groups)
+
+    trudpChannelHeap *heap; ///< Channels with not empty send queue ordered by expected time
+    trudpTimerWheel *keepalive; ///< Channels keepalive timers
+    trudpUdpRecvBatch *recv_batch; ///< Receive buffers of trudpProcessReceivedBatch
+    trudpUdpSendBatch *send_batch; ///< Egress batch (NULL if packets are sent by PROCESS_SEND event)
+    uint32_t send_batch_delay; ///< Maximum time packet waits in egress batch (usec)
+    int udp_gso; ///< Coalesce egress batch packets with UDP GSO
+    int udp_gro; ///< Receive datagrams coalesced by UDP GRO
+    trudpSubmitQueue *submit; ///< Data sent by other threads (NULL if not used)
+    trudpTimerWheelNode ack_list; ///< Channels with delayed ACK in deadline order
+    uint32_t ack_every; ///< Acknowledge every Nth in order DATA packet (0 or 1 if ACK is not delayed)
+    uint32_t ack_delay; ///< Maximum ACK delay (usec)
+    const trudpCcOps *cc_ops; ///< Congestion control algorithm of new channels
+    int peer_cc; ///< Channels of one remote address share congestion controller (trudpSetPeerCongestionControl)
+    int pacing; ///< Pace channels sends (trudpSetPacing)
+    uint64_t pacing_rate; ///< Maximum channel pacing rate (bytes per second, zero if not limited)
+    trudpTokenBucket pacing_total; ///< Pacing token bucket of all channels
+    size_t write_queue_bytes; ///< Length of packets in all channels write queues
+    size_t wq_channel_high; ///< Channel write queue high watermark (bytes, zero if not limited)
+    size_t wq_channel_low; ///< Channel write queue low watermark (bytes)
+    size_t wq_total_high; ///< All channels write queues high watermark (bytes, zero if not limited)
+    size_t wq_total_low; ///< All channels write queues low watermark (bytes)
+    trudpTimerWheelNode write_blocked_list; ///< Channels waiting for WRITABLE event
+    trudpTimerWheelNode write_active_list[WRITE_QUEUE_PRIORITIES]; ///< Channels with not empty write queue in round robin order by priority
+    size_t write_active_num; ///< Number of channels in write_active_list
 
     void* psq_data; ///< Send queue process data (used in external event loop)
     void* user_data; ///< User data
@@ -222,8 +258,6 @@ typedef struct trudpData {
     trudpStatData stat;
     unsigned long long started;
 
-    size_t writeQueueIdx;
-
 } trudpData;
 
 TRUDP_API trudpData *trudpInit(int fd, int port, trudpEventCb event_cb,
@@ -231,18 +265,41 @@ TRUDP_API trudpData *trudpInit(int fd, int port, trudpEventCb event_cb,
 TRUDP_API void trudpDestroy(trudpData* td);
 TRUDP_API void trudpChannelSendEvent(trudpChannelData* tcd, int event, void *data,
             size_t data_length, void *reserved);
+void trudpChannelSendUdp(trudpChannelData *tcd, void *packet,
+            size_t packet_length);
+void trudpChannelSendUdpPayload(trudpChannelData *tcd, void *packet,
+            size_t packet_length, trudpPayload *payload);
 TRUDP_API void trudpSendEvent(trudpData* td, int event, void *data,
             size_t data_length, void *reserved);
 TRUDP_API trudpChannelData *trudpGetChannelCreate(trudpData *td,
             __CONST_SOCKADDR_ARG addr, socklen_t addr_len, int channel);
 TRUDP_API size_t trudpProcessKeepConnection(trudpData *td);
 TRUDP_API void trudpProcessReceived(trudpData* td, uint8_t* data, size_t data_length);
+TRUDP_API int trudpProcessReceivedBatch(trudpData* td, size_t max_packets);
 TRUDP_API size_t trudpSendDataToAll(trudpData *td, void *data, size_t data_length);
 TRUDP_API void trudpSendResetAll(trudpData *td);
 TRUDP_API uint32_t trudpGetSendQueueTimeout(trudpData *td, uint64_t ts);
 TRUDP_API size_t trudpGetWriteQueueSize(trudpData *td);
 TRUDP_API int trudpProcessSendQueue(trudpData *td, uint64_t *next_et);
 TRUDP_API size_t trudpProcessWriteQueue(trudpData *td);
+TRUDP_API int trudpSetSendBatch(trudpData *td, size_t max_packets,
+            uint32_t max_delay_us);
+TRUDP_API int trudpSendBatchFlush(trudpData *td);
+TRUDP_API int trudpSetUdpOffload(trudpData *td, int enable);
+TRUDP_API int trudpSetSubmitQueue(trudpData *td, size_t size);
+TRUDP_API int trudpSetCongestionControl(trudpData *td,
+            const trudpCcOps *ops);
+TRUDP_API void trudpSetPeerCongestionControl(trudpData *td, int enable);
+TRUDP_API void trudpSetPacing(trudpData *td, int enable, uint64_t channel_rate,
+            uint64_t total_rate);
+TRUDP_API void trudpSetDelayedAck(trudpData *td, uint32_t every,
+            uint32_t delay_us);
+TRUDP_API void trudpSetWriteQueueLimits(trudpData *td, size_t channel_high,
+            size_t channel_low, size_t total_high, size_t total_low);
+TRUDP_API int trudpSubmitSendData(trudpData *td, __CONST_SOCKADDR_ARG addr,
+            socklen_t addr_len, int channel, void *data, size_t data_length);
+TRUDP_API size_t trudpProcessSubmitQueue(trudpData *td);
+TRUDP_API int trudpGetSubmitQueueFd(trudpData *td);
 
 TRUDP_API void trudpChannelDestroyAddr(trudpData *td, const char *addr, int port,
   int channel);
@@ -0,0 +1,340 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_cc.c
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Congestion control: each channel keeps congestion window, new DATA packets
+ * are sent while send queue is smaller than the window and wait in write
+ * queue otherwise. Algorithm is selected per trudpData by
+ * trudpSetCongestionControl, it may be built in (trudpCcGetOps) or user
+ * defined trudpCcOps.
+ *
+ * Created on October 17, 2026, 9:05 PM
+ */
+
+#include "trudp_cc.h"
+
+#include "trudp_const.h"
+
+#define CUBIC_C 0.4 // CUBIC scaling constant
+#define CUBIC_BETA 0.7 // CUBIC multiplicative decrease factor
+
+// Local functions
+static double _trudpCcCbrt(double x);
+static void _trudpCcUpdatePacingRate(trudpCc *cc);
+static void _trudpCcFixedInit(trudpCc *cc);
+static void _trudpCcRenoInit(trudpCc *cc);
+static void _trudpCcRenoOnAck(trudpCc *cc, size_t packets, uint32_t rtt,
+        uint64_t ts);
+static void _trudpCcRenoOnLoss(trudpCc *cc, int timeout, uint64_t ts);
+static void _trudpCcCubicOnAck(trudpCc *cc, size_t packets, uint32_t rtt,
+        uint64_t ts);
+static void _trudpCcCubicOnLoss(trudpCc *cc, int timeout, uint64_t ts);
+
+static const trudpCcOps trudpCcFixedOps = {
+    "fixed", _trudpCcFixedInit, NULL, NULL, NULL
+};
+
+static const trudpCcOps trudpCcRenoOps = {
+    "reno", _trudpCcRenoInit, NULL, _trudpCcRenoOnAck, _trudpCcRenoOnLoss
+};
+
+static const trudpCcOps trudpCcCubicOps = {
+    "cubic", _trudpCcRenoInit, NULL, _trudpCcCubicOnAck, _trudpCcCubicOnLoss
+};
+
+/**
+ * Get built in congestion control algorithm
+ *
+ * @param algorithm Algorithm
+ *
+ * @return Pointer to trudpCcOps or NULL if algorithm is unknown
+ */
+const trudpCcOps *trudpCcGetOps(trudpCcAlgorithm algorithm) {
+
+    switch (algorithm) {
+        case TRUDP_CC_FIXED: return &trudpCcFixedOps;
+        case TRUDP_CC_RENO: return &trudpCcRenoOps;
+        case TRUDP_CC_CUBIC: return &trudpCcCubicOps;
+    }
+
+    return NULL;
+}
+
+/**
+ * Initialize channel congestion controller
+ *
+ * @param cc Pointer to trudpCc
+ * @param ops Algorithm
+ */
+void trudpCcInit(trudpCc *cc, const trudpCcOps *ops) {
+
+    cc->ops = ops;
+    cc->cwnd = TRUDP_CC_INITIAL_CWND;
+    cc->ssthresh = TRUDP_CC_MAX_CWND;
+    cc->srtt = 0;
+    cc->min_rtt = 0;
+    cc->pacing_rate = 0;
+    cc->mss = 0;
+    cc->in_recovery = 0;
+    cc->recovery_id = 0;
+    cc->w_max = 0;
+    cc->k = 0;
+    cc->w_est = 0;
+    cc->epoch_start = 0;
+    if (ops->init) ops->init(cc);
+}
+
+/**
+ * Get congestion window
+ *
+ * @param cc Pointer to trudpCc
+ *
+ * @return Number of packets which may be in send queue
+ */
+size_t trudpCcGetWindow(trudpCc *cc) {
+
+    if (cc->cwnd < 1) return 1;
+    if (cc->cwnd > TRUDP_CC_MAX_CWND) return TRUDP_CC_MAX_CWND;
+
+    return (size_t)cc->cwnd;
+}
+
+/**
+ * Process sent DATA packet
+ *
+ * @param cc Pointer to trudpCc
+ * @param bytes Packet length
+ * @param ts Current time
+ */
+void trudpCcOnSend(trudpCc *cc, size_t bytes, uint64_t ts) {
+
+    cc->mss = cc->mss ? (cc->mss * 7 + bytes) / 8 : bytes;
+    if (cc->ops->on_send) cc->ops->on_send(cc, bytes, ts);
+}
+
+/**
+ * Process acknowledged packets
+ *
+ * @param cc Pointer to trudpCc
+ * @param packets Number of acknowledged packets
+ * @param rtt Round trip time sample (usec), zero if not known
+ * @param ts Current time
+ */
+void trudpCcOnAck(trudpCc *cc, size_t packets, uint32_t rtt, uint64_t ts) {
+
+    if (rtt) {
+        cc->srtt = cc->srtt ? (cc->srtt * 7 + rtt) / 8 : rtt;
+        if (!cc->min_rtt || rtt < cc->min_rtt) cc->min_rtt = rtt;
+    }
+    if (packets && cc->ops->on_ack) cc->ops->on_ack(cc, packets, rtt, ts);
+
+    // Window never grows beyond receive window
+    if (cc->cwnd > TRUDP_CC_MAX_CWND) cc->cwnd = TRUDP_CC_MAX_CWND;
+    _trudpCcUpdatePacingRate(cc);
+}
+
+/**
+ * Process packet loss
+ *
+ * @param cc Pointer to trudpCc
+ * @param timeout True at retransmit timeout
+ * @param ts Current time
+ */
+void trudpCcOnLoss(trudpCc *cc, int timeout, uint64_t ts) {
+
+    if (cc->ops->on_loss) cc->ops->on_loss(cc, timeout, ts);
+    _trudpCcUpdatePacingRate(cc);
+}
+
+/**
+ * Set pacing rate to window per smoothed round trip time, twice faster in
+ * slow start so window can grow
+ *
+ * @param cc Pointer to trudpCc
+ */
+static void _trudpCcUpdatePacingRate(trudpCc *cc) {
+
+    if (!cc->srtt || !cc->mss) return;
+
+    double gain = cc->cwnd < cc->ssthresh ? 2.0 : 1.2;
+    cc->pacing_rate = (uint64_t)(gain * trudpCcGetWindow(cc) * cc->mss *
+            1000000.0 / cc->srtt);
+}
+
+/**
+ * Calculate cube root (Newton's method, avoids libm dependency)
+ *
+ * @param x Non negative value
+ *
+ * @return Cube root of x
+ */
+static double _trudpCcCbrt(double x) {
+
+    if (x <= 0) return 0;
+
+    double r = x > 1 ? x / 3 : 1;
+    int i;
+    for (i = 0; i < 64; i++) {
+        double next = (2 * r + x / (r * r)) / 3;
+        if (next >= r * 0.999999 && next <= r * 1.000001) return next;
+        r = next;
+    }
+
+    return r;
+}
+
+// Fixed window ===============================================================
+
+/**
+ * Set window to NORMAL_S_SIZE packets
+ *
+ * @param cc Pointer to trudpCc
+ */
+static void _trudpCcFixedInit(trudpCc *cc) {
+    cc->cwnd = NORMAL_S_SIZE;
+    cc->ssthresh = NORMAL_S_SIZE;
+}
+
+// NewReno ====================================================================
+
+/**
+ * Initialize NewReno (and CUBIC) state
+ *
+ * @param cc Pointer to trudpCc
+ */
+static void _trudpCcRenoInit(trudpCc *cc) {
+    cc->cwnd = TRUDP_CC_INITIAL_CWND;
+    cc->ssthresh = TRUDP_CC_MAX_CWND;
+}
+
+/**
+ * Grow window: by one packet per acknowledged packet in slow start, by one
+ * packet per window in congestion avoidance. Window does not grow in
+ * recovery
+ *
+ * @param cc Pointer to trudpCc
+ * @param packets Number of acknowledged packets
+ * @param rtt Round trip time sample
+ * @param ts Current time
+ */
+static void _trudpCcRenoOnAck(trudpCc *cc, size_t packets, uint32_t rtt,
+        uint64_t ts) {
+
+    (void)rtt;
+    (void)ts;
+
+    if (cc->in_recovery) return;
+    if (cc->cwnd < cc->ssthresh) cc->cwnd += packets;
+    else cc->cwnd += (double)packets / cc->cwnd;
+}
+
+/**
+ * Halve window at loss, restart slow start from one packet at timeout
+ *
+ * @param cc Pointer to trudpCc
+ * @param timeout True at retransmit timeout
+ * @param ts Current time
+ */
+static void _trudpCcRenoOnLoss(trudpCc *cc, int timeout, uint64_t ts) {
+
+    (void)ts;
+
+    cc->ssthresh = cc->cwnd / 2;
+    if (cc->ssthresh < TRUDP_CC_MIN_CWND) cc->ssthresh = TRUDP_CC_MIN_CWND;
+    cc->cwnd = timeout ? 1 : cc->ssthresh;
+}
+
+// CUBIC ======================================================================
+
+/**
+ * Grow window by cubic function of time since last window reduction, but not
+ * slower than NewReno would
+ *
+ * @param cc Pointer to trudpCc
+ * @param packets Number of acknowledged packets
+ * @param rtt Round trip time sample
+ * @param ts Current time
+ */
+static void _trudpCcCubicOnAck(trudpCc *cc, size_t packets, uint32_t rtt,
+        uint64_t ts) {
+
+    (void)rtt;
+
+    if (cc->in_recovery) return;
+
+    // Slow start
+    if (cc->cwnd < cc->ssthresh) {
+        cc->cwnd += packets;
+        return;
+    }
+
+    // Start congestion avoidance epoch
+    if (!cc->epoch_start) {
+        cc->epoch_start = ts;
+        if (cc->w_max < cc->cwnd) {
+            cc->k = 0;
+            cc->w_max = cc->cwnd;
+        } else {
+            cc->k = _trudpCcCbrt((cc->w_max - cc->cwnd) / CUBIC_C);
+        }
+        cc->w_est = cc->cwnd;
+    }
+
+    // Cubic window one round trip time later
+    double t = (ts - cc->epoch_start + cc->min_rtt) / 1000000.0 - cc->k;
+    double target = CUBIC_C * t * t * t + cc->w_max;
+
+    // Reno friendly window
+    cc->w_est += 3 * (1 - CUBIC_BETA) / (1 + CUBIC_BETA) * packets / cc->w_est;
+    if (target < cc->w_est) target = cc->w_est;
+
+    if (target > cc->cwnd) {
+        cc->cwnd += (target - cc->cwnd) / cc->cwnd * packets;
+    } else {
+        cc->cwnd += 0.01 * packets / cc->cwnd;
+    }
+}
+
+/**
+ * Reduce window by CUBIC_BETA factor at loss, restart slow start from one
+ * packet at timeout
+ *
+ * @param cc Pointer to trudpCc
+ * @param timeout True at retransmit timeout
+ * @param ts Current time
+ */
+static void _trudpCcCubicOnLoss(trudpCc *cc, int timeout, uint64_t ts) {
+
+    (void)ts;
+
+    // Fast convergence: release bandwidth for new flows
+    if (cc->cwnd < cc->w_max) cc->w_max = cc->cwnd * (1 + CUBIC_BETA) / 2;
+    else cc->w_max = cc->cwnd;
+    cc->epoch_start = 0;
+
+    cc->ssthresh = cc->cwnd * CUBIC_BETA;
+    if (cc->ssthresh < TRUDP_CC_MIN_CWND) cc->ssthresh = TRUDP_CC_MIN_CWND;
+    cc->cwnd = timeout ? 1 : cc->ssthresh;
+}
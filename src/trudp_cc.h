@@ -0,0 +1,139 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_cc.h
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Created on October 17, 2026, 9:05 PM
+ */
+
+#ifndef TRUDP_CC_H
+#define TRUDP_CC_H
+
+#include "teobase/types.h"
+
+#include "trudp_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRUDP_CC_INITIAL_CWND 10 // Initial congestion window (packets)
+#define TRUDP_CC_MIN_CWND 2 // Minimum congestion window after loss (packets)
+#define TRUDP_CC_MAX_CWND 512 // Maximum congestion window: receive window size (packets)
+
+/**
+ * Built in congestion control algorithms
+ */
+typedef enum trudpCcAlgorithm {
+
+    TRUDP_CC_FIXED, ///< Fixed window of NORMAL_S_SIZE packets (no congestion control)
+    TRUDP_CC_RENO,  ///< NewReno: slow start, additive increase, halve at loss
+    TRUDP_CC_CUBIC  ///< CUBIC (RFC 8312): window grows by cubic function of time since loss
+
+} trudpCcAlgorithm;
+
+struct trudpCc;
+
+/**
+ * Congestion controller operations. Window is in packets, callbacks may be
+ * NULL if algorithm does not need them
+ */
+typedef struct trudpCcOps {
+
+    const char *name; ///< Algorithm name
+
+    /**
+     * Initialize controller state (window and algorithm data)
+     */
+    void (*init)(struct trudpCc *cc);
+
+    /**
+     * New DATA packet is sent
+     *
+     * @param cc Pointer to trudpCc
+     * @param bytes Packet length
+     * @param ts Current time
+     */
+    void (*on_send)(struct trudpCc *cc, size_t bytes, uint64_t ts);
+
+    /**
+     * Packets are acknowledged
+     *
+     * @param cc Pointer to trudpCc
+     * @param packets Number of acknowledged packets
+     * @param rtt Round trip time sample (usec)
+     * @param ts Current time
+     */
+    void (*on_ack)(struct trudpCc *cc, size_t packets, uint32_t rtt,
+            uint64_t ts);
+
+    /**
+     * Packet loss is detected: once per window of data for losses reported
+     * by selective acknowledgements, at every retransmit timeout
+     *
+     * @param cc Pointer to trudpCc
+     * @param timeout True at retransmit timeout, false at loss reported by
+     *        selective acknowledgement
+     * @param ts Current time
+     */
+    void (*on_loss)(struct trudpCc *cc, int timeout, uint64_t ts);
+
+} trudpCcOps;
+
+/**
+ * Channel congestion controller state
+ */
+typedef struct trudpCc {
+
+    const trudpCcOps *ops; ///< Algorithm
+    double cwnd;           ///< Congestion window (packets)
+    double ssthresh;       ///< Slow start threshold (packets)
+    uint32_t srtt;         ///< Smoothed round trip time (usec)
+    uint32_t min_rtt;      ///< Minimum round trip time (usec)
+    uint64_t pacing_rate;  ///< Pacing rate (bytes per second), zero if not known
+    size_t mss;            ///< Average sent packet length (bytes)
+    int in_recovery;       ///< Loss recovery: window is not reduced again
+    uint32_t recovery_id;  ///< Recovery ends when this packet id is acknowledged
+
+    // CUBIC data
+    double w_max;          ///< Window before last reduction
+    double k;              ///< Time to reach w_max (sec)
+    double w_est;          ///< Reno friendly window estimation
+    uint64_t epoch_start;  ///< Congestion avoidance epoch start time
+
+} trudpCc;
+
+TRUDP_API const trudpCcOps *trudpCcGetOps(trudpCcAlgorithm algorithm);
+
+void trudpCcInit(trudpCc *cc, const trudpCcOps *ops);
+size_t trudpCcGetWindow(trudpCc *cc);
+void trudpCcOnSend(trudpCc *cc, size_t bytes, uint64_t ts);
+void trudpCcOnAck(trudpCc *cc, size_t packets, uint32_t rtt, uint64_t ts);
+void trudpCcOnLoss(trudpCc *cc, int timeout, uint64_t ts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRUDP_CC_H */
@@ -26,6 +26,7 @@
 
 #include "trudp_channel.h"
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -45,29 +46,78 @@
 static trudpChannelData *_trudpChannelAddToMap(trudpData *td,
                                                trudpChannelData *tcd);
 static uint64_t _trudpChannelCalculateExpectedTime(trudpChannelData *tcd,
-                                                   uint64_t current_time,
-                                                   int retransmit);
+                                                   uint64_t current_time);
 static void _trudpChannelCalculateTriptime(trudpChannelData *tcd, void *packet,
                                            size_t send_data_length);
+static void _trudpChannelSetRto(trudpChannelData *tcd, int64_t rto);
+static void _trudpChannelUpdateRto(trudpChannelData *tcd);
 static void _trudpChannelFree(trudpChannelData *tcd);
 static uint32_t _trudpChannelGetId(trudpChannelData *tcd);
 static uint32_t _trudpChannelGetNewId(trudpChannelData *tcd);
 static void _trudpChannelIncrementStatSendQueueSize(trudpChannelData *tcd);
 static void _trudpChannelIncrementStatWriteQueueSize(trudpChannelData *tcd);
 static void _trudpChannelReset(trudpChannelData *tcd);
+static int _trudpChannelAckPacket(trudpChannelData *tcd, uint32_t id);
+static void _trudpChannelMakeSack(trudpChannelData *tcd, trudpSack *sack);
+static trudpCc *_trudpChannelCc(trudpChannelData *tcd);
+static void _trudpChannelCongestionAck(trudpChannelData *tcd, size_t acked,
+        uint32_t rtt, uint64_t ts);
+static void _trudpChannelCongestionLoss(trudpChannelData *tcd, int timeout,
+        uint64_t ts);
+static size_t _trudpChannelProcessSack(trudpChannelData *tcd,
+        trudpPacket *ack);
+static void _trudpChannelRackUpdate(trudpChannelData *tcd, uint32_t xmit_ts,
+        uint64_t ts);
+static uint64_t _trudpChannelRackLostTime(trudpChannelData *tcd,
+        trudpSendQueueData *sqd, uint64_t ts);
+static size_t _trudpChannelRackDetectLoss(trudpChannelData *tcd, uint64_t ts);
+static void _trudpChannelArmProbe(trudpChannelData *tcd, uint64_t ts);
+static size_t _trudpChannelSendProbe(trudpChannelData *tcd, uint64_t ts);
+static void _trudpChannelRetransmit(trudpChannelData *tcd,
+        trudpSendQueueData *tqd, uint64_t ts);
 static void _trudpChannelSendACK(trudpChannelData *tcd, trudpPacket *packet);
+static void _trudpChannelSendDataACK(trudpChannelData *tcd,
+        trudpPacket *packet);
 static void _trudpChannelSendACKtoPING(trudpChannelData *tcd, trudpPacket* packet);
 static void _trudpChannelSendACKtoRESET(trudpChannelData *tcd, trudpPacket* packet);
+static void _trudpChannelUpdateExpectedTime(trudpChannelData *tcd);
+static int _trudpChannelSendNow(trudpChannelData *tcd);
+static int _trudpChannelWindowOpen(trudpChannelData *tcd);
+static uint64_t _trudpChannelPacingTime(trudpChannelData *tcd, uint64_t ts);
+static void _trudpChannelPacingConsume(trudpChannelData *tcd, size_t bytes,
+        uint64_t ts);
 static size_t _trudpChannelSendPacket(trudpChannelData *tcd,
                                       trudpPacket *packetDATA,
-                                      size_t packetLength,
-                                      int save_to_send_queue);
+                                      size_t packetLength);
+static size_t _trudpChannelSendQueued(trudpChannelData *tcd,
+                                      trudpSendQueueData *sqd);
+static void _trudpChannelSendSlot(trudpChannelData *tcd,
+                                  trudpSendQueueData *sqd);
+static size_t _trudpChannelWriteQueueMove(trudpChannelData *tcd);
+static void _trudpChannelWriteQueueDrained(trudpChannelData *tcd,
+        size_t bytes);
+static int _trudpChannelWriteBlocked(trudpChannelData *tcd);
+static void _trudpChannelWriteActiveAdd(trudpChannelData *tcd);
+static void _trudpChannelWriteActiveRemove(trudpChannelData *tcd);
+static size_t _trudpChannelWriteQueueRound(trudpChannelData *tcd);
+static void _trudpChannelPeerWriteQueueProcess(trudpPeer *peer);
+static int _trudpChannelWritable(trudpChannelData *tcd);
+static size_t _trudpChannelSendData(trudpChannelData *tcd, void *data,
+        size_t data_length, trudpPayload *payload, uint64_t deadline,
+        int limited);
+static void _trudpChannelDeliver(trudpChannelData *tcd, trudpPacket *packet);
+static size_t _trudpChannelSendDatagram(trudpChannelData *tcd, void *data,
+        size_t data_length, trudpPayload *payload);
 static void _trudpChannelSetDefaults(trudpChannelData *tcd);
 static void _trudpChannelSetLastReceived(trudpChannelData *tcd);
 
 // importing debug option flag
 extern bool trudpOpt_DBG_dumpDataPacketHeaders;
 extern int64_t trudpOpt_CORE_disconnectTimeoutDelay_us;
+extern int64_t trudpOpt_CORE_keepaliveFirstPingDelay_us;
+extern bool trudpOpt_CORE_selectiveAck;
+extern int64_t trudpOpt_CORE_minRetransmitTimeout_us;
+extern int64_t trudpOpt_CORE_maxRetransmitTimeout_us;
 
 void trudp_ChannelSendReset(trudpChannelData *tcd) {
   trudpChannelSendRESET(tcd, NULL, 0);
@@ -112,19 +162,35 @@ static void _trudpChannelSetDefaults(trudpChannelData *tcd) {
 
   tcd->sendId = 0;
   tcd->triptime = 0;
-  tcd->triptimeFactor = 1.5;
   tcd->outrunning_cnt = 0;
   tcd->receiveExpectedId = 0;
   tcd->lastReceived = teoGetTimestampFull();
   tcd->lastSentPing = 0;  //  Never sent ping before
-  tcd->triptimeMiddle = START_MIDDLE_TIME;
   tcd->read_buffer = NULL;
   tcd->read_buffer_ptr = 0;
   tcd->read_buffer_size = 0;
   tcd->last_packet_ptr = 0;
 
+  // Initialize congestion controller and pacing
+  trudpCcInit(&tcd->cc, tcd->td->cc_ops);
+  trudpTokenBucketInit(&tcd->pacing, 0, PACING_BURST_SIZE);
+
   // Initialize statistic
   trudpStatChannelInit(tcd);
+
+  // Initialize retransmit timeout
+  tcd->triptimeMiddle = 0;
+  tcd->rttvar = 0;
+  tcd->rto_backoff_time = 0;
+  _trudpChannelSetRto(tcd, INITIAL_RTO);
+
+  // Initialize loss detection
+  tcd->rack_xmit_time = 0;
+  tcd->rack_rtt = 0;
+  tcd->rack_min_rtt = UINT32_MAX;
+  tcd->rack_time = 0;
+  tcd->tlp_time = 0;
+  tcd->tlp_wait_ack_f = false;
 }
 
 /**
@@ -136,6 +202,7 @@ static void _trudpChannelFree(trudpChannelData *tcd) {
 
   tcd->td->stat.sendQueue.size_current -= trudpSendQueueSize(tcd->sendQueue);
   tcd->td->stat.writeQueue.size_current -= trudpWriteQueueSize(tcd->writeQueue);
+  size_t write_queue_bytes = trudpWriteQueueBytes(tcd->writeQueue);
 
   if (tcd->read_buffer != NULL) {
     free(tcd->read_buffer);
@@ -145,7 +212,16 @@ static void _trudpChannelFree(trudpChannelData *tcd) {
   trudpSendQueueFree(tcd->sendQueue);
   trudpWriteQueueFree(tcd->writeQueue);
   trudpReceiveQueueFree(tcd->receiveQueue);
+  trudpChannelHeapRemove(tcd->td->heap, tcd);
+  trudpTimerWheelRemove(&tcd->ack_timer);
+  tcd->ack_pending = 0;
+  trudpPeerEndRecovery(tcd);
   _trudpChannelSetDefaults(tcd);
+
+  // Cleared write queue may unblock other channels
+  _trudpChannelWriteActiveRemove(tcd);
+  trudpTimerWheelRemove(&tcd->write_blocked);
+  _trudpChannelWriteQueueDrained(tcd, write_queue_bytes);
 }
 
 // ============================================================================
@@ -162,6 +238,28 @@ static void _trudpChannelFree(trudpChannelData *tcd) {
 trudpChannelData *trudpChannelNew(struct trudpData *td, const char *remote_address,
                                   int remote_port_i, int channel) {
 
+  struct sockaddr_storage remaddr;
+  socklen_t addrlen = 0;
+
+  memset(&remaddr, 0, sizeof(remaddr));
+  trudpUdpMakeAddr(remote_address, remote_port_i, (__SOCKADDR_ARG)&remaddr, &addrlen);
+
+  return trudpChannelNewAddr(td, (__CONST_SOCKADDR_ARG)&remaddr, addrlen, channel);
+}
+
+/**
+ * Create trudp channel by socket address
+ *
+ * @param td Pointer to trudpData
+ * @param addr Pointer to remote address
+ * @param addr_len Remote address length
+ * @param channel TR-UDP channel
+ * @return
+ */
+trudpChannelData *trudpChannelNewAddr(struct trudpData *td,
+                                      __CONST_SOCKADDR_ARG addr,
+                                      socklen_t addr_len, int channel) {
+
   trudpChannelData tcd;
   memset(&tcd, 0, sizeof(tcd));
 
@@ -169,26 +267,42 @@ trudpChannelData *trudpChannelNew(struct trudpData *td, const char *remote_addre
   tcd.sendQueue = trudpSendQueueNew();
   tcd.writeQueue = trudpWriteQueueNew();
   tcd.receiveQueue = trudpReceiveQueueNew();
-  trudpUdpMakeAddr(remote_address, remote_port_i, (__SOCKADDR_ARG)&tcd.remaddr, &tcd.addrlen);
+  if (addr_len > sizeof(tcd.remaddr)) addr_len = sizeof(tcd.remaddr);
+  memcpy(&tcd.remaddr, addr, addr_len);
+  tcd.addrlen = addr_len;
   tcd.channel = channel;
+  trudpChannelKeyMake(&tcd.key, (__CONST_SOCKADDR_ARG)&tcd.remaddr,
+                      tcd.addrlen, channel);
 
   tcd.connected_f = 0;
+  tcd.write_quantum = WRITE_QUEUE_QUANTUM;
 
   // Set other defaults
   _trudpChannelSetDefaults(&tcd);
   tcd.fd = 0;
 
-  // Add channel to map
+  // Make string key, it used in statistic and logs only
+  int port;
   size_t channel_key_length;
-  const char *addr_ch = trudpUdpGetAddr((__CONST_SOCKADDR_ARG)&tcd.remaddr, tcd.addrlen, NULL);
-  const char *channel_key = trudpMakeKey(addr_ch, remote_port_i, channel, &channel_key_length);
+  char channel_key[MAX_KEY_LENGTH];
+  const char *addr_ch = trudpUdpGetAddr((__CONST_SOCKADDR_ARG)&tcd.remaddr, tcd.addrlen, &port);
+  trudpMakeKeyBuf(channel_key, addr_ch, port, channel, &channel_key_length);
   free((char*)addr_ch);
 
   tcd.channel_key = ccl_malloc(channel_key_length);
   memcpy(tcd.channel_key, channel_key, channel_key_length);
   tcd.channel_key_length = channel_key_length;
 
+  // Add channel to map and index
   trudpChannelData *tcd_return = _trudpChannelAddToMap(td, &tcd);
+  trudpChannelIndexAdd(td->idx, &tcd_return->key, tcd_return);
+
+  if (td->peer_cc) trudpPeerAttach(tcd_return);
+
+  // Start keepalive timer
+  trudpTimerWheelAdd(td->keepalive, &tcd_return->keepalive,
+      tcd_return->lastReceived + trudpOpt_CORE_keepaliveFirstPingDelay_us);
+
   return tcd_return;
 }
 
@@ -214,7 +328,14 @@ void trudpChannelDestroy(trudpChannelData *tcd) {
   trudpWriteQueueDestroy(tcd->writeQueue);
   trudpReceiveQueueDestroy(tcd->receiveQueue);
 
+  trudpTimerWheelRemove(&tcd->keepalive);
+  trudpTimerWheelRemove(&tcd->ack_timer);
+  trudpPeerDetach(tcd);
+
   char *channel_key = tcd->channel_key;
+  if (trudpChannelIndexGet(tcd->td->idx, &tcd->key) == tcd) {
+    trudpChannelIndexDelete(tcd->td->idx, &tcd->key);
+  }
   teoMapDelete(tcd->td->map, (uint8_t*)channel_key, tcd->channel_key_length);
   free(channel_key);
 }
@@ -284,7 +405,7 @@ static uint32_t _trudpChannelGetId(trudpChannelData *tcd) {
  *
  * @param tcd Pointer to trudpChannelData
  *
- * @return Static buffer with key ip:port:channel
+ * @return Static (thread local) buffer with key ip:port:channel
  */
 const char *trudpChannelMakeKey(trudpChannelData *tcd) {
 
@@ -333,33 +454,58 @@ static void _trudpChannelCalculateTriptime(trudpChannelData *tcd, void *packet,
 
   tcd->triptime = trudpGetTimestamp() - trudpPacketGetTimestamp(packet);
 
-  // Calculate and set Middle Triptime value
-  tcd->triptimeMiddle = tcd->triptimeMiddle == START_MIDDLE_TIME
-                            ? tcd->triptime * tcd->triptimeFactor
-                            : // Set first middle time
-                            tcd->triptime > tcd->triptimeMiddle
-                                ? tcd->triptime * tcd->triptimeFactor
-                                : // Set middle time to max triptime
-                                (tcd->triptimeMiddle * 19 + tcd->triptime) /
-                                    20.0; // Calculate middle value
-
-  // Correct triptimeMiddle
-  if (tcd->triptimeMiddle < tcd->triptime * tcd->triptimeFactor)
-    tcd->triptimeMiddle = tcd->triptime * tcd->triptimeFactor;
-  if (tcd->triptimeMiddle > tcd->triptime * 10)
-    tcd->triptimeMiddle = tcd->triptime * 10;
-  if (tcd->triptimeMiddle > MAX_TRIPTIME_MIDDLE)
-    tcd->triptimeMiddle = MAX_TRIPTIME_MIDDLE;
-
-  // tcd->triptimeMiddle *= 5;
-
   // Statistic
   tcd->stat.ack_receive++;
   tcd->stat.triptime_last = tcd->triptime;
-  tcd->stat.wait = tcd->triptimeMiddle / 1000.0;
   trudpStatProcessLast10Send(tcd, packet, send_data_length);
 }
 
+/**
+ * Set retransmit timeout limited by minimum and maximum retransmit timeout
+ * options
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param rto Retransmit timeout
+ */
+static void _trudpChannelSetRto(trudpChannelData *tcd, int64_t rto) {
+
+  if (rto > trudpOpt_CORE_maxRetransmitTimeout_us)
+    rto = trudpOpt_CORE_maxRetransmitTimeout_us;
+  if (rto < trudpOpt_CORE_minRetransmitTimeout_us)
+    rto = trudpOpt_CORE_minRetransmitTimeout_us;
+  tcd->rto = (uint32_t)rto;
+  tcd->stat.wait = tcd->rto / 1000.0;
+}
+
+/**
+ * Update smoothed round trip time (triptimeMiddle), its variation and
+ * retransmit timeout by last triptime measurement (RFC 6298). Variation part
+ * of retransmit timeout is not less than minimum retransmit timeout, so
+ * short delay spikes do not cause retransmits
+ *
+ * @param tcd Pointer to trudpChannelData
+ */
+static void _trudpChannelUpdateRto(trudpChannelData *tcd) {
+
+  uint32_t rtt = tcd->triptime;
+  if (!tcd->triptimeMiddle) {
+    // First measurement
+    tcd->triptimeMiddle = rtt ? rtt : 1;
+    tcd->rttvar = rtt / 2;
+  } else {
+    uint32_t delta = tcd->triptimeMiddle > rtt ? tcd->triptimeMiddle - rtt
+                                               : rtt - tcd->triptimeMiddle;
+    tcd->rttvar = ((uint64_t)tcd->rttvar * 3 + delta) / 4;
+    tcd->triptimeMiddle = ((uint64_t)tcd->triptimeMiddle * 7 + rtt) / 8;
+    if (!tcd->triptimeMiddle) tcd->triptimeMiddle = 1; // Zero is not measured
+  }
+
+  int64_t var = 4 * (int64_t)tcd->rttvar;
+  if (var < trudpOpt_CORE_minRetransmitTimeout_us)
+    var = trudpOpt_CORE_minRetransmitTimeout_us;
+  _trudpChannelSetRto(tcd, tcd->triptimeMiddle + var);
+}
+
 /**
  * Set last received field to current timestamp
  *
@@ -369,6 +515,36 @@ static void _trudpChannelSetLastReceived(trudpChannelData *tcd) {
   tcd->lastReceived = teoGetTimestampFull();
 }
 
+/**
+ * Make selective acknowledgement from receive queue: expected id and ranges
+ * of outrunning packets. It is sent before acknowledged packet is processed,
+ * this packet is acknowledged by ACK header id
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param sack [out] Receiver state
+ */
+static void _trudpChannelMakeSack(trudpChannelData *tcd, trudpSack *sack) {
+
+  sack->cumulative = tcd->receiveExpectedId;
+  sack->num = 0;
+  if (!trudpReceiveQueueSize(tcd->receiveQueue)) return;
+
+  uint32_t id = tcd->receiveExpectedId;
+  while (sack->num < TRUDP_SACK_MAX_RANGES) {
+    uint32_t first = id, last;
+    if (!trudpReceiveQueueFindNext(tcd->receiveQueue, &first) ||
+        _trudpGetSeqIdDistance(id, first) < 0) {
+      break; // Search wrapped around receive window
+    }
+    for (last = first; trudpReceiveQueueFindById(tcd->receiveQueue,
+             _trudpGetNextSeqId(last)); last = _trudpGetNextSeqId(last));
+    sack->range[sack->num].first = first;
+    sack->range[sack->num].last = last;
+    sack->num++;
+    id = _trudpGetNextSeqId(last);
+  }
+}
+
 /**
  * Create ACK packet and send it back to sender
  *
@@ -376,12 +552,66 @@ static void _trudpChannelSetLastReceived(trudpChannelData *tcd) {
  * @param packet Pointer to received packet
  */
 static void _trudpChannelSendACK(trudpChannelData *tcd, trudpPacket* packet) {
-  trudpPacket* ack_packet = trudpPacketACKcreateNew(packet);
-  trudpChannelSendEvent(tcd, PROCESS_SEND, ack_packet, trudpPacketACKlength(), NULL);
-  trudpPacketCreatedFree(ack_packet);
+  char ack_packet[TRUDP_SACK_MAX_LENGTH];
+  size_t ack_length;
+  if (trudpOpt_CORE_selectiveAck) {
+    trudpSack sack;
+    _trudpChannelMakeSack(tcd, &sack);
+    ack_length = trudpPacketACKcreateSack(ack_packet, packet, &sack);
+  } else {
+    ack_length = trudpPacketACKcreate(ack_packet, packet);
+  }
+
+  // This ACK acknowledges delayed ones too
+  tcd->ack_pending = 0;
+  trudpTimerWheelRemove(&tcd->ack_timer);
+  trudpChannelSendUdp(tcd, ack_packet, ack_length);
   _trudpChannelSetLastReceived(tcd);
 }
 
+/**
+ * Acknowledge received DATA packet. In delayed ACK mode (trudpSetDelayedAck)
+ * ACK of in order packet is delayed until Nth packet is received or ACK
+ * delay expires, than one ACK acknowledges all received packets with its
+ * cumulative id. Outrunning or repeated packets are acknowledged at once
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param packet Pointer to received packet
+ */
+static void _trudpChannelSendDataACK(trudpChannelData *tcd,
+                                     trudpPacket *packet) {
+
+  trudpData *td = tcd->td;
+  if (td->ack_every > 1 && trudpOpt_CORE_selectiveAck &&
+      tcd->receiveExpectedId &&
+      trudpPacketGetId(packet) == tcd->receiveExpectedId &&
+      !trudpReceiveQueueSize(tcd->receiveQueue) &&
+      ++tcd->ack_pending < td->ack_every) {
+
+    memcpy(tcd->ack_header, packet, TRUDP_HEADER_LENGTH);
+    if (tcd->ack_timer.next == NULL) {
+      trudpTimerWheelListAdd(&td->ack_list, &tcd->ack_timer,
+                             teoGetTimestampFull() + td->ack_delay);
+    }
+    _trudpChannelSetLastReceived(tcd);
+    return;
+  }
+
+  _trudpChannelSendACK(tcd, packet);
+}
+
+/**
+ * Send delayed ACK of last received in order DATA packet
+ *
+ * @param tcd Pointer to trudpChannelData
+ */
+void trudpChannelSendDelayedACK(trudpChannelData *tcd) {
+  trudpTimerWheelRemove(&tcd->ack_timer);
+  if (tcd->ack_pending) {
+    _trudpChannelSendACK(tcd, (trudpPacket *)tcd->ack_header);
+  }
+}
+
 /**
  * Create ACK to RESET packet and send it back to sender
  *
@@ -389,9 +619,9 @@ static void _trudpChannelSendACK(trudpChannelData *tcd, trudpPacket* packet) {
  * @param packet Pointer to received packet
  */
 static void _trudpChannelSendACKtoRESET(trudpChannelData *tcd, trudpPacket* packet) {
-  trudpPacket* ack_packet = trudpPacketACKtoRESETcreateNew(packet);
-  trudpChannelSendEvent(tcd, PROCESS_SEND, ack_packet, trudpPacketACKlength(), NULL);
-  trudpPacketCreatedFree(ack_packet);
+  char ack_packet[TRUDP_HEADER_LENGTH];
+  size_t ack_length = trudpPacketACKtoRESETcreate(ack_packet, packet);
+  trudpChannelSendUdp(tcd, ack_packet, ack_length);
   _trudpChannelSetLastReceived(tcd);
 }
 
@@ -402,10 +632,9 @@ static void _trudpChannelSendACKtoRESET(trudpChannelData *tcd, trudpPacket* pack
  * @param packet Pointer to received packet
  */
 static void _trudpChannelSendACKtoPING(trudpChannelData *tcd, trudpPacket* packet) {
-  trudpPacket* ack_packet = trudpPacketACKtoPINGcreateNew(packet);
-  trudpChannelSendEvent(tcd, PROCESS_SEND, ack_packet,
-                 trudpPacketGetPacketLength(packet), NULL);
-  trudpPacketCreatedFree(ack_packet);
+  char ack_packet[TRUDP_MAX_PACKET_LENGTH];
+  size_t ack_length = trudpPacketACKtoPINGcreate(ack_packet, packet);
+  trudpChannelSendUdp(tcd, ack_packet, ack_length);
   _trudpChannelSetLastReceived(tcd);
 }
 
@@ -420,11 +649,10 @@ void trudpChannelSendRESET(trudpChannelData *tcd, void *data,
                            size_t data_length) {
 
   if (tcd) {
-    void *packetRESET = trudpPacketRESETcreateNew(_trudpChannelGetNewId(tcd),
-                  tcd->channel);
-    trudpChannelSendEvent(tcd, PROCESS_SEND, packetRESET, trudpPacketRESETlength(),
-                  NULL);
-    trudpPacketCreatedFree(packetRESET);
+    char packetRESET[TRUDP_HEADER_LENGTH];
+    size_t packetLength = trudpPacketRESETcreate(packetRESET,
+                  _trudpChannelGetNewId(tcd), tcd->channel);
+    trudpChannelSendUdp(tcd, packetRESET, packetLength);
     trudpChannelSendEvent(tcd, SEND_RESET, data, data_length, NULL);
   }
 }
@@ -434,22 +662,13 @@ void trudpChannelSendRESET(trudpChannelData *tcd, void *data,
  *
  * @param tcd Pointer to trudpChannelData
  * @param current_time_usec Current time (uSec)
- * @param retransmit This is retransmitted
  *
- * @return Current time plus
+ * @return Current time plus retransmit timeout
  */
 static uint64_t _trudpChannelCalculateExpectedTime(trudpChannelData *tcd,
-                                                   uint64_t current_time_usec,
-                                                   int retransmit) {
-
-  // int rtt = tcd->triptimeMiddle + RTT * (retransmit);
-  // int rtt = tcd->triptimeMiddle + (RTT/10);// * (retransmit?0.5:0);
-  uint32_t rtt = tcd->triptimeMiddle + RTT;
-  if (rtt > MAX_RTT)
-    rtt = MAX_RTT;
-  uint64_t expected_time = current_time_usec + rtt;
+                                                   uint64_t current_time_usec) {
 
-  return expected_time;
+  return current_time_usec + tcd->rto;
 }
 
 /**
@@ -465,9 +684,108 @@ static void _trudpChannelIncrementStatWriteQueueSize(trudpChannelData *tcd) {
   tcd->td->stat.writeQueue.size_current++;
 }
 
-static void _updateMainExpectedTimeAndChannel(trudpChannelData *tcd, uint64_t new_expected_time) {
-    tcd->td->expected_max_time = new_expected_time;
-    tcd->td->channel_key = tcd->channel_key;
+/**
+ * Update channel position in trudpData channel heap after its send queue
+ * first element or loss detection timers changed
+ *
+ * @param tcd Pointer to trudpChannelData
+ */
+static void _trudpChannelUpdateExpectedTime(trudpChannelData *tcd) {
+  uint64_t expected_time = trudpSendQueueGetExpectedTime(tcd->sendQueue);
+
+  // Wake up to retransmit lost packets and send tail loss probe
+  if (tcd->rack_time && tcd->rack_time < expected_time)
+    expected_time = tcd->rack_time;
+  if (tcd->tlp_time && tcd->tlp_time < expected_time)
+    expected_time = tcd->tlp_time;
+
+  // Wake up to send write queue packets delayed by pacing
+  if (tcd->td->pacing && trudpWriteQueueSize(tcd->writeQueue) &&
+      _trudpChannelWindowOpen(tcd)) {
+    uint64_t pacing_time =
+        _trudpChannelPacingTime(tcd, teoGetTimestampFull());
+    if (pacing_time < expected_time) expected_time = pacing_time;
+  }
+
+  trudpChannelHeapUpdate(tcd->td->heap, tcd, expected_time);
+}
+
+/**
+ * Get time when next packet may be sent by pacing. Channel rate is
+ * congestion controller pacing rate limited by trudpData channel pacing
+ * rate, all channels are limited by trudpData total pacing rate
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param ts Current time
+ *
+ * @return Time when packet may be sent, ts if it may be sent now
+ */
+static uint64_t _trudpChannelPacingTime(trudpChannelData *tcd, uint64_t ts) {
+
+  trudpData *td = tcd->td;
+  if (!td->pacing) return ts;
+
+  uint64_t rate = _trudpChannelCc(tcd)->pacing_rate;
+  if (td->pacing_rate && (!rate || rate > td->pacing_rate))
+    rate = td->pacing_rate;
+  trudpTokenBucketSetRate(&tcd->pacing, rate, ts);
+
+  uint64_t pacing_time = trudpTokenBucketGetTime(&tcd->pacing, ts);
+  uint64_t total_time = trudpTokenBucketGetTime(&td->pacing_total, ts);
+
+  return pacing_time > total_time ? pacing_time : total_time;
+}
+
+/**
+ * Take sent packet from channel and trudpData pacing token buckets
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param bytes Packet length
+ * @param ts Current time
+ */
+static void _trudpChannelPacingConsume(trudpChannelData *tcd, size_t bytes,
+                                       uint64_t ts) {
+
+  if (!tcd->td->pacing) return;
+  trudpTokenBucketConsume(&tcd->pacing, bytes, ts);
+  trudpTokenBucketConsume(&tcd->td->pacing_total, bytes, ts);
+}
+
+/**
+ * Check that new packet may be sent now (send queue is smaller than
+ * congestion window and pacing allows it) or should wait in write queue
+ *
+ * @param tcd Pointer to trudpChannelData
+ *
+ * @return True if packet may be added to send queue and sent now
+ */
+static int _trudpChannelSendNow(trudpChannelData *tcd) {
+
+    if (!_trudpChannelWindowOpen(tcd)) return 0;
+    if (!tcd->td->pacing) return 1;
+
+    uint64_t ts = teoGetTimestampFull();
+    return _trudpChannelPacingTime(tcd, ts) <= ts;
+}
+
+/**
+ * Check that send queue is smaller than congestion window
+ *
+ * @param tcd Pointer to trudpChannelData
+ *
+ * @return True if packet may be added to send queue
+ */
+static int _trudpChannelWindowOpen(trudpChannelData *tcd) {
+    size_t size_sq = trudpSendQueueSize(tcd->sendQueue);
+    size_t in_flight = tcd->peer ? trudpPeerSendQueueSize(tcd->peer) : size_sq;
+
+    int sendNowFlag = in_flight < trudpCcGetWindow(_trudpChannelCc(tcd));
+    if(size_sq == 1) {
+      trudpSendQueueData *data = trudpSendQueueGetFirst(tcd->sendQueue);
+      if(trudpPacketGetId((trudpPacket *)data->packet) == 0) sendNowFlag = 0;
+    }
+
+    return sendNowFlag;
 }
 
 /**
@@ -476,48 +794,251 @@ static void _updateMainExpectedTimeAndChannel(trudpChannelData *tcd, uint64_t ne
  * @param tcd Pointer to trudpChannelData
  * @param packet Pointer to send data
  * @param packetLength Data length
- * @param save_to_send_queue Save to send queue if true
  *
  * @return Zero on error
  */
 static size_t _trudpChannelSendPacket(trudpChannelData *tcd,
-                                      trudpPacket *packet, size_t packetLength,
-                                      int save_to_send_queue) {
-    size_t size_sq = trudpSendQueueSize(tcd->sendQueue);
+                                      trudpPacket *packet, size_t packetLength) {
 
-    int sendNowFlag = size_sq < NORMAL_S_SIZE;
-    if(size_sq == 1) {
-      trudpSendQueueData *data = trudpSendQueueGetFirst(tcd->sendQueue);
-      if(trudpPacketGetId((trudpPacket *)data->packet) == 0) sendNowFlag = 0;
+    // Send packet to trudp event loop
+    trudpChannelSendUdp(tcd, packet, packetLength);
+    tcd->stat.packets_send++; // Send packets statistic
+
+    return packetLength;
+}
+
+/**
+ * Send packet just added to send queue
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param sqd Pointer to trudpSendQueueData with packet
+ *
+ * @return Zero on error
+ */
+static size_t _trudpChannelSendQueued(trudpChannelData *tcd,
+                                      trudpSendQueueData *sqd) {
+    if (sqd == NULL) return 0;
+
+    uint64_t ts = teoGetTimestampFull();
+    _trudpChannelPacingConsume(tcd, sqd->packet_length, ts);
+    _trudpChannelArmProbe(tcd, ts);
+    _trudpChannelUpdateExpectedTime(tcd);
+    _trudpChannelIncrementStatSendQueueSize(tcd);
+    trudpCcOnSend(_trudpChannelCc(tcd), sqd->packet_length, ts);
+
+    size_t packet_length = sqd->packet_length;
+    _trudpChannelSendSlot(tcd, sqd);
+    tcd->stat.packets_send++; // Send packets statistic
+
+    return packet_length;
+}
+
+/**
+ * Send packet of send queue slot, shared payload is sent after packet header
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param sqd Pointer to trudpSendQueueData with packet
+ */
+static void _trudpChannelSendSlot(trudpChannelData *tcd,
+                                  trudpSendQueueData *sqd) {
+    if (sqd->payload) {
+        trudpChannelSendUdpPayload(tcd, sqd->packet, TRUDP_HEADER_LENGTH,
+                                   sqd->payload);
+    } else {
+        trudpChannelSendUdp(tcd, sqd->packet, sqd->packet_length);
     }
+}
 
-    // Save packet to send queue
-    if (save_to_send_queue) {
-        if (sendNowFlag) {
-            uint64_t expected_time = _trudpChannelCalculateExpectedTime(tcd, teoGetTimestampFull(), 0);
-            if (tcd->td->expected_max_time > expected_time) {
-                _updateMainExpectedTimeAndChannel(tcd, expected_time);
-            }
-            trudpSendQueueAdd(tcd->sendQueue, packet, packetLength, expected_time);
-            _trudpChannelIncrementStatSendQueueSize(tcd);
-        } else {
-            void *packetCopy = ccl_malloc(packetLength);
-            memcpy(packetCopy, packet, packetLength);
-            trudpWriteQueueAdd(tcd->writeQueue, NULL, packetCopy, packetLength);
-            _trudpChannelIncrementStatWriteQueueSize(tcd);
-        }
+/**
+ * Move first packet from write queue to send queue and send it. The packet
+ * buffer is passed to send queue without copy
+ *
+ * @param tcd Pointer to trudpChannelData
+ *
+ * @return Length of sent packet or zero if write queue is empty
+ */
+static size_t _trudpChannelWriteQueueMove(trudpChannelData *tcd) {
+
+    trudpWriteQueueData *wqd = trudpWriteQueueGetFirst(tcd->writeQueue);
+    if (wqd == NULL) return 0;
+    size_t packet_length = wqd->packet_length;
+
+    uint64_t ts = teoGetTimestampFull();
+    uint64_t expected_time = _trudpChannelCalculateExpectedTime(tcd, ts);
+    uint64_t deadline = wqd->deadline;
+    trudpSendQueueData *sqd;
+    if (deadline && deadline <= ts) {
+        // Expired packet is dropped, SKIP packet with its id is sent instead
+        char skip[TRUDP_HEADER_LENGTH];
+        trudpPacket *packet = (trudpPacket *)(wqd->packet_ptr ?
+                wqd->packet_ptr : wqd->packet);
+        trudpPacketSKIPcreate(skip, trudpPacketGetId(packet), tcd->channel);
+        free(wqd->packet_ptr);
+        trudpPayloadRelease(wqd->payload);
+        sqd = trudpSendQueueAdd(tcd->sendQueue, skip, TRUDP_HEADER_LENGTH,
+                                expected_time);
+        deadline = 0;
+    } else if (wqd->payload) {
+        trudpPacketUpdateTimestamp((trudpPacket *)wqd->packet);
+        sqd = trudpSendQueueAddPayload(tcd->sendQueue, wqd->packet,
+                                       wqd->payload, expected_time);
+    } else if (wqd->packet_ptr) {
+        trudpPacketUpdateTimestamp((trudpPacket *)wqd->packet_ptr);
+        sqd = trudpSendQueueAddBuffer(tcd->sendQueue, wqd->packet_ptr,
+                                      wqd->packet_length, expected_time);
+    } else {
+        trudpPacketUpdateTimestamp((trudpPacket *)wqd->packet);
+        sqd = trudpSendQueueAdd(tcd->sendQueue, wqd->packet,
+                                wqd->packet_length, expected_time);
     }
+    if (sqd) sqd->deadline = deadline;
+    trudpWriteQueueDeleteFirst(tcd->writeQueue);
+    tcd->td->stat.writeQueue.size_current--;
+    if (!trudpWriteQueueSize(tcd->writeQueue)) {
+        _trudpChannelWriteActiveRemove(tcd);
+    }
+
+    size_t rv = _trudpChannelSendQueued(tcd, sqd);
+    _trudpChannelWriteQueueDrained(tcd, packet_length);
+
+    return rv;
+}
 
-    // Send data (add to write queue)
-    if (!save_to_send_queue || sendNowFlag) {
-        // Send packet to trudp event loop
-        trudpChannelSendEvent(tcd, PROCESS_SEND, packet, packetLength, NULL);
-        tcd->stat.packets_send++; // Send packets statistic
+/**
+ * Account packets removed from channel write queue and send WRITABLE event
+ * to the channel (or to all waiting channels when all channels write queues
+ * went down to low watermark)
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param bytes Length of removed packets
+ */
+static void _trudpChannelWriteQueueDrained(trudpChannelData *tcd,
+                                           size_t bytes) {
+
+    trudpData *td = tcd->td;
+    size_t total = td->write_queue_bytes;
+    td->write_queue_bytes -= bytes;
+
+    if (td->wq_total_high && total > td->wq_total_low &&
+        td->write_queue_bytes <= td->wq_total_low) {
+        trudpChannelSendWritable(td);
+    } else if (tcd->write_blocked.next && _trudpChannelWritable(tcd)) {
+        trudpTimerWheelRemove(&tcd->write_blocked);
+        trudpChannelSendEvent(tcd, WRITABLE, NULL, 0, NULL);
     }
-    //    else if(save_to_send_queue)
-    //    trudp_start_send_queue_cb(tcd->td->psq_data, 0);
+}
 
-    return packetLength;
+/**
+ * Add channel to the end of trudpData list of channels with not empty write
+ * queue (write queue scheduler round robin list)
+ *
+ * @param tcd Pointer to trudpChannelData
+ */
+static void _trudpChannelWriteActiveAdd(trudpChannelData *tcd) {
+
+    if (tcd->write_active.next) return;
+    trudpTimerWheelListAdd(&tcd->td->write_active_list[tcd->priority],
+                           &tcd->write_active, 0);
+    tcd->td->write_active_num++;
+}
+
+/**
+ * Remove channel which write queue became empty from write queue scheduler
+ * round robin list
+ *
+ * @param tcd Pointer to trudpChannelData
+ */
+static void _trudpChannelWriteActiveRemove(trudpChannelData *tcd) {
+
+    if (!tcd->write_active.next) return;
+    trudpTimerWheelRemove(&tcd->write_active);
+    tcd->td->write_active_num--;
+    tcd->write_deficit = 0;
+}
+
+/**
+ * Set channel write queue scheduler quantum: number of bytes channel may
+ * send from its write queue in every trudpProcessWriteQueue round. Channels
+ * with larger quantum get proportionally larger part of send rate when
+ * write queues of several channels wait
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param quantum Quantum (bytes), it is not less than maximum packet length
+ *        (WRITE_QUEUE_QUANTUM), so every channel sends at least one packet
+ *        per round
+ */
+void trudpChannelSetWriteQuantum(trudpChannelData *tcd, size_t quantum) {
+    tcd->write_quantum = quantum > WRITE_QUEUE_QUANTUM ? quantum
+                                                       : WRITE_QUEUE_QUANTUM;
+}
+
+/**
+ * Check that packet may be added to write queue. Channel which write queue
+ * or all channels write queues reached high watermark waits for WRITABLE
+ * event in trudpData write_blocked_list, and stays blocked until it
+ *
+ * @param tcd Pointer to trudpChannelData
+ *
+ * @return True if packet should not be added to write queue
+ */
+static int _trudpChannelWriteBlocked(trudpChannelData *tcd) {
+
+    trudpData *td = tcd->td;
+    if (!tcd->write_blocked.next &&
+        (!td->wq_channel_high ||
+         trudpWriteQueueBytes(tcd->writeQueue) < td->wq_channel_high) &&
+        (!td->wq_total_high || td->write_queue_bytes < td->wq_total_high)) {
+        return 0;
+    }
+
+    if (!tcd->write_blocked.next) {
+        trudpTimerWheelListAdd(&td->write_blocked_list, &tcd->write_blocked, 0);
+    }
+    return 1;
+}
+
+/**
+ * Check that channel write queue and all channels write queues are not
+ * longer than low watermarks
+ *
+ * @param tcd Pointer to trudpChannelData
+ *
+ * @return True if waiting channel may get WRITABLE event
+ */
+static int _trudpChannelWritable(trudpChannelData *tcd) {
+
+    trudpData *td = tcd->td;
+    return (!td->wq_channel_high ||
+            trudpWriteQueueBytes(tcd->writeQueue) <= td->wq_channel_low) &&
+           (!td->wq_total_high || td->write_queue_bytes <= td->wq_total_low);
+}
+
+/**
+ * Send WRITABLE event to waiting channels which write queues went down to
+ * low watermarks
+ *
+ * @param td Pointer to trudpData
+ */
+void trudpChannelSendWritable(trudpData *td) {
+
+    trudpTimerWheelNode ready, *node, *next;
+    trudpTimerWheelListInit(&ready);
+
+    // Event callback may send data and block channels again, so ready
+    // channels are moved to separate list first
+    for (node = td->write_blocked_list.next; node != &td->write_blocked_list;
+         node = next) {
+        next = node->next;
+        if (_trudpChannelWritable((trudpChannelData *)
+                ((char *)node - offsetof(trudpChannelData, write_blocked)))) {
+            trudpTimerWheelListAdd(&ready, node, 0);
+        }
+    }
+    while ((node = trudpTimerWheelListPop(&ready))) {
+        trudpChannelSendEvent((trudpChannelData *)
+                ((char *)node - offsetof(trudpChannelData, write_blocked)),
+                WRITABLE, NULL, 0, NULL);
+    }
 }
 
 /**
@@ -529,16 +1050,16 @@ static size_t _trudpChannelSendPacket(trudpChannelData *tcd,
 size_t trudpChannelSendPING(trudpChannelData *tcd, void *data,
                             size_t data_length) {
 
-  // Create DATA package
-  size_t packetLength;
-  trudpPacket *packet = trudpPacketPINGcreateNew(
-      _trudpChannelGetId(tcd), tcd->channel, data, data_length, &packetLength);
+  if (data_length > TRUDP_MAX_DATA_LENGTH) return 0;
 
-  // Send data
-  size_t rv = _trudpChannelSendPacket(tcd, packet, packetLength, 0);
+  // Create PING package
+  char packet[TRUDP_MAX_PACKET_LENGTH];
+  size_t packetLength = trudpPacketPINGcreate(packet, _trudpChannelGetId(tcd),
+      tcd->channel, data, data_length);
 
-  // Free created packet
-  trudpPacketCreatedFree(packet);
+  // Send data
+  size_t rv = _trudpChannelSendPacket(tcd, (trudpPacket *)packet,
+      packetLength);
 
   tcd->lastSentPing = teoGetTimestampFull();
   return rv;
@@ -551,10 +1072,77 @@ size_t trudpChannelSendPING(trudpChannelData *tcd, void *data,
  * @param data Pointer to send data
  * @param data_length Data length
  *
- * @return Zero on error
+ * @return Zero on error or TRUDP_SEND_WOULD_BLOCK if write queue is full
+ *         (trudpSetWriteQueueLimits), WRITABLE event is sent when data may
+ *         be sent again
  */
 size_t trudpChannelSendData(trudpChannelData *tcd, void *data,
                             size_t data_length) {
+  return _trudpChannelSendData(tcd, data, data_length, NULL, 0, 1);
+}
+
+/**
+ * Send data which expires after lifetime. Expired packet is not resent (or
+ * not sent from write queue): SKIP packet with its id is sent instead, so
+ * receiver does not wait for it
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param data Pointer to send data
+ * @param data_length Data length
+ * @param lifetime Data lifetime in microseconds, zero if data does not expire
+ *
+ * @return Zero on error or TRUDP_SEND_WOULD_BLOCK if write queue is full
+ *         (trudpSetWriteQueueLimits)
+ */
+size_t trudpChannelSendDataExpire(trudpChannelData *tcd, void *data,
+                                  size_t data_length, uint32_t lifetime) {
+  uint64_t deadline = lifetime ? teoGetTimestampFull() + lifetime : 0;
+  return _trudpChannelSendData(tcd, data, data_length, NULL, deadline, 1);
+}
+
+/**
+ * Send shared payload. Send and write queues keep reference to the payload
+ * instead of data copy, so the same payload may be sent to many channels
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param payload Pointer to trudpPayload (caller keeps its reference)
+ *
+ * @return Zero on error or TRUDP_SEND_WOULD_BLOCK if write queue is full
+ *         (trudpSetWriteQueueLimits)
+ */
+size_t trudpChannelSendPayload(trudpChannelData *tcd, trudpPayload *payload) {
+  return _trudpChannelSendData(tcd, NULL, payload->length, payload, 0, 1);
+}
+
+/**
+ * Send data, write queue limits are not checked
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param data Pointer to send data
+ * @param data_length Data length
+ *
+ * @return Zero on error
+ */
+size_t trudpChannelSendDataUnlimited(trudpChannelData *tcd, void *data,
+                                     size_t data_length) {
+  return _trudpChannelSendData(tcd, data, data_length, NULL, 0, 0);
+}
+
+/**
+ * Send data or add it to write queue
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param data Pointer to send data (not used if payload is set)
+ * @param data_length Data length
+ * @param payload Pointer to shared trudpPayload or NULL
+ * @param deadline Time when packet expires or zero
+ * @param limited Check write queue limits
+ *
+ * @return Zero on error or TRUDP_SEND_WOULD_BLOCK if write queue is full
+ */
+static size_t _trudpChannelSendData(trudpChannelData *tcd, void *data,
+                                    size_t data_length, trudpPayload *payload,
+                                    uint64_t deadline, int limited) {
 
   size_t rv = 0;
 
@@ -562,23 +1150,132 @@ size_t trudpChannelSendData(trudpChannelData *tcd, void *data,
   //         ( tcd->sendId % 100 != 100 - trudpSendQueueSize(tcd->sendQueue) ) )
   //         {
 
-  // Create DATA package
-  size_t packetLength;
-  trudpPacket *packet =
-      trudpPacketDATAcreateNew(_trudpChannelGetNewId(tcd), tcd->channel, data,
-                               data_length, &packetLength);
+  if (data_length > TRUDP_MAX_DATA_LENGTH) return 0;
 
-  // Send data
-  rv = _trudpChannelSendPacket(tcd, packet, packetLength, 1);
+  // Unreliable channel sends datagrams, they bypass write and send queues
+  if (tcd->unreliable_f) {
+    return _trudpChannelSendDatagram(tcd, data, data_length, payload);
+  }
+
+  // Packets waiting in write queue go first to keep ids sent in order
+  int send_now = !trudpWriteQueueSize(tcd->writeQueue) &&
+                 _trudpChannelSendNow(tcd);
+  if (!send_now && limited && _trudpChannelWriteBlocked(tcd)) {
+    return TRUDP_SEND_WOULD_BLOCK;
+  }
+
+  uint32_t id = _trudpChannelGetNewId(tcd);
+  size_t packetLength = TRUDP_HEADER_LENGTH + data_length;
 
-  // Free created packet
-  trudpPacketCreatedFree(packet);
+  // Only packet header is created for shared payload, queues keep reference
+  // to the payload
+  char header[TRUDP_HEADER_LENGTH];
+  if (payload) {
+    trudpPacketDATAcreate(header, id, tcd->channel, NULL, data_length);
+  }
+
+  if (send_now) {
+    // Create DATA package in send queue and send it
+    uint64_t expected_time =
+        _trudpChannelCalculateExpectedTime(tcd, teoGetTimestampFull());
+    trudpSendQueueData *sqd;
+    if (payload) {
+      sqd = trudpSendQueueAddPayload(tcd->sendQueue, header,
+          trudpPayloadRef(payload), expected_time);
+    } else {
+      sqd = trudpSendQueueAlloc(tcd->sendQueue, id, packetLength,
+          expected_time);
+      if (sqd == NULL) return 0;
+      trudpPacketDATAcreate(sqd->packet, id, tcd->channel, data, data_length);
+    }
+    if (sqd) sqd->deadline = deadline;
+    rv = _trudpChannelSendQueued(tcd, sqd);
+  } else {
+    // Create DATA package and add it to write queue
+    trudpWriteQueueData *wqd;
+    if (payload) {
+      wqd = trudpWriteQueueAddPayload(tcd->writeQueue, header,
+          TRUDP_HEADER_LENGTH, trudpPayloadRef(payload));
+    } else {
+      void *packet = ccl_malloc(packetLength);
+      trudpPacketDATAcreate(packet, id, tcd->channel, data, data_length);
+      wqd = trudpWriteQueueAdd(tcd->writeQueue, NULL, packet, packetLength);
+    }
+    wqd->deadline = deadline;
+    tcd->td->write_queue_bytes += packetLength;
+    _trudpChannelWriteActiveAdd(tcd);
+    _trudpChannelIncrementStatWriteQueueSize(tcd);
+    if (tcd->td->pacing) _trudpChannelUpdateExpectedTime(tcd);
+    rv = packetLength;
+  }
 
   //    }
 
   return rv;
 }
 
+/**
+ * Send data by unreliable datagram. Datagram is not added to send queue, is
+ * not acknowledged and is not resent. Receiver gets it by GOT_DATA event as
+ * soon as datagram is received, it does not wait for lost DATA packets
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param data Pointer to send data
+ * @param data_length Data length
+ *
+ * @return Length of sent packet or zero on error
+ */
+size_t trudpChannelSendDatagram(trudpChannelData *tcd, void *data,
+                                size_t data_length) {
+  if (data_length > TRUDP_MAX_DATA_LENGTH) return 0;
+  return _trudpChannelSendDatagram(tcd, data, data_length, NULL);
+}
+
+/**
+ * Create unreliable datagram and send it
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param data Pointer to send data (not used if payload is set)
+ * @param data_length Data length
+ * @param payload Pointer to shared trudpPayload or NULL
+ *
+ * @return Length of sent packet
+ */
+static size_t _trudpChannelSendDatagram(trudpChannelData *tcd, void *data,
+                                        size_t data_length,
+                                        trudpPayload *payload) {
+
+  char packet[TRUDP_MAX_PACKET_LENGTH];
+  size_t packet_length = trudpPacketDGRAMcreate(packet, tcd->dgramSendId++,
+      tcd->channel, payload ? NULL : data, data_length);
+
+  _trudpChannelPacingConsume(tcd, packet_length, teoGetTimestampFull());
+  if (payload) {
+    trudpChannelSendUdpPayload(tcd, packet, TRUDP_HEADER_LENGTH, payload);
+  } else {
+    trudpChannelSendUdp(tcd, packet, packet_length);
+  }
+
+  // Statistic
+  tcd->stat.packets_send++;
+  trudpStatProcessLast10Send(tcd, packet, data_length);
+
+  return packet_length;
+}
+
+/**
+ * Send received DATA packet to User level by GOT_DATA event, SKIP packet has
+ * no data and is not sent
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param packet Pointer to received DATA or SKIP packet
+ */
+static void _trudpChannelDeliver(trudpChannelData *tcd, trudpPacket *packet) {
+  if (trudpPacketGetType(packet) == TRU_DATA) {
+    trudpChannelSendEventGotData(tcd, packet);
+  }
+}
+
 /**
  * Process received packet
  *
@@ -603,47 +1300,43 @@ int trudpChannelProcessReceivedPacket(trudpChannelData *tcd, uint8_t *data,
 
     // ACK to DATA packet received
     case TRU_ACK: {
-      // Find packet in send queue by id
-      size_t send_data_length = 0;
-      trudpSendQueueData *sqd =
-          trudpSendQueueFindById(tcd->sendQueue, trudpPacketGetId(packet));
-      if (sqd) {
-        trudpPacket* sq_packet = trudpPacketQueueDataGetPacket(sqd);
-
-        // Process ACK data callback
-        trudpChannelSendEvent(tcd, GOT_ACK, sq_packet, sqd->packet_length, NULL);
-
-        // Remove packet from send queue
-        send_data_length = trudpPacketGetDataLength(sq_packet);
-        trudpSendQueueDelete(tcd->sendQueue, sqd);
-        tcd->td->stat.sendQueue.size_current--;
-
-        if (tcd->td->channel_key == tcd->channel_key) {
-            trudpRecalculateExpectedSendTime(tcd->td);
-        } else {
-            if (tcd->td->expected_max_time == UINT64_MAX) {
-                LTRACK_E("TrudpChannel", "expected_max_time so BIG, while we got ack from channel %s", tcd->channel_key);
-            }
-            uint64_t expected_time = trudpSendQueueGetExpectedTime(tcd->sendQueue);
-            if (tcd->td->expected_max_time > expected_time) {
-                _updateMainExpectedTimeAndChannel(tcd, expected_time);
-            }
-        }
-
-        if (trudpWriteQueueSize(tcd->writeQueue) > 0) {
-          trudpWriteQueueData *wqd_first =
-              trudpWriteQueueGetFirst(tcd->writeQueue);
-          _trudpChannelSendPacket(tcd, wqd_first->packet_ptr,
-                                  wqd_first->packet_length, 1);
-          free(wqd_first->packet_ptr);
-          trudpWriteQueueDeleteFirst(tcd->writeQueue);
-          tcd->td->stat.writeQueue.size_current--;
-        }
-      }
+      // Find packet in send queue by id and remove it. Triptime of
+      // retransmitted packet is used to calculate retransmit timeout only if
+      // ACK echoes timestamp of last retransmission, ACK to previous one is
+      // ambiguous (Karn's rule)
+      uint64_t ts = teoGetTimestampFull();
+      uint32_t id = trudpPacketGetId(packet);
+      trudpSendQueueData *sqd = trudpSendQueueFindById(tcd->sendQueue, id);
+      int rtt_valid = sqd != NULL && (!sqd->retrieves ||
+          trudpPacketGetTimestamp(trudpSendQueueDataGetPacket(sqd)) ==
+          trudpPacketGetTimestamp(packet));
+      int send_data_length = _trudpChannelAckPacket(tcd, id);
+      size_t acked = send_data_length >= 0;
 
       // Calculate triptime
-      _trudpChannelCalculateTriptime(tcd, packet, send_data_length);
+      _trudpChannelCalculateTriptime(tcd, packet,
+          send_data_length > 0 ? send_data_length : 0);
+      if (rtt_valid) _trudpChannelUpdateRto(tcd);
       _trudpChannelSetLastReceived(tcd);
+
+      // Release packets received by peer and resend packets sent before
+      // acknowledged one (time based loss detection)
+      acked += _trudpChannelProcessSack(tcd, packet);
+      if (acked) {
+        _trudpChannelRackUpdate(tcd, trudpPacketGetTimestamp(packet), ts);
+        tcd->tlp_wait_ack_f = false;
+        _trudpChannelArmProbe(tcd, ts);
+      }
+      _trudpChannelRackDetectLoss(tcd, ts);
+      _trudpChannelCongestionAck(tcd, acked,
+          rtt_valid ? tcd->triptime : 0, ts);
+      _trudpChannelUpdateExpectedTime(tcd);
+
+      // Move next packets from write queue to send queue while congestion
+      // window allows, shared window is filled by peer channels in priority
+      // order
+      if (tcd->peer) _trudpChannelPeerWriteQueueProcess(tcd->peer);
+      else while (_trudpChannelSendNow(tcd) && _trudpChannelWriteQueueMove(tcd));
     } break;
 
     // ACK to RESET packet received
@@ -665,6 +1358,7 @@ int trudpChannelProcessReceivedPacket(trudpChannelData *tcd, uint8_t *data,
 
       // Calculate Triptime
       _trudpChannelCalculateTriptime(tcd, packet, packet_length);
+      _trudpChannelUpdateRto(tcd);
       _trudpChannelSetLastReceived(tcd);
 
       // Send event
@@ -695,10 +1389,22 @@ int trudpChannelProcessReceivedPacket(trudpChannelData *tcd, uint8_t *data,
     } break;
 
     // DATA packet received
+    // SKIP packet received: it takes place of expired DATA packet
+    case TRU_SKIP:
     case TRU_DATA: {
 
+      // Drop packet which is too far ahead to fit receive window without
+      // ACK, sender will resend it later. Packet with id 0 is never ahead:
+      // it starts new sequence of restarted peer
+      if (tcd->receiveExpectedId && trudpPacketGetId(packet) &&
+          _trudpGetSeqIdDistance(tcd->receiveExpectedId,
+              trudpPacketGetId(packet)) >= RECEIVE_QUEUE_SIZE) {
+        tcd->stat.packets_receive_dropped++;
+        break;
+      }
+
       // Create ACK packet and send it back to sender
-      _trudpChannelSendACK(tcd, packet);
+      _trudpChannelSendDataACK(tcd, packet);
 
       if (trudpOpt_DBG_dumpDataPacketHeaders) {
         char buffer[8192];
@@ -718,11 +1424,25 @@ int trudpChannelProcessReceivedPacket(trudpChannelData *tcd, uint8_t *data,
         break;
       }
 
+      // Reset channel if packet id = 0 and we are waiting for non-zero one
+      // Don't reset in case we waiting for id=1, just skip it to mitigate case
+      // the remote side did not receive our ACK for packet id=0 and sent it again
+      if (tcd->receiveExpectedId && !trudpPacketGetId(packet)) {
+        if (!tcd->zero_tolerance_f && (tcd->receiveExpectedId != 1)) {
+          // Send Send Reset event
+          trudpChannelSendRESET(tcd, NULL, 0);
+          break;
+        }
+        tcd->stat.packets_receive_dropped++;
+        trudpStatProcessLast10Receive(tcd, packet);
+        break;
+      }
+
       // Check expected Id and return data
       if (trudpPacketGetId(packet) == tcd->receiveExpectedId) {
 
         // Send Got Data event
-        trudpChannelSendEventGotData(tcd, packet);
+        _trudpChannelDeliver(tcd, packet);
 
         // Proceed to next expected id
         tcd->receiveExpectedId = _trudpGetNextSeqId(tcd->receiveExpectedId);
@@ -730,10 +1450,10 @@ int trudpChannelProcessReceivedPacket(trudpChannelData *tcd, uint8_t *data,
         trudpReceiveQueueData *rqd;
         while ((rqd = trudpReceiveQueueFindById(tcd->receiveQueue,
                                                 tcd->receiveExpectedId))) {
-          trudpPacket* rq_packet = trudpPacketQueueDataGetPacket(rqd);
+          trudpPacket* rq_packet = trudpReceiveQueueDataGetPacket(rqd);
 
           // Send Got Data event
-          trudpChannelSendEventGotData(tcd, rq_packet);
+          _trudpChannelDeliver(tcd, rq_packet);
 
           // Delete element from received queue
           trudpReceiveQueueDelete(tcd->receiveQueue, rqd);
@@ -754,7 +1474,7 @@ int trudpChannelProcessReceivedPacket(trudpChannelData *tcd, uint8_t *data,
                 !trudpReceiveQueueFindById(tcd->receiveQueue,
                                           trudpPacketGetId(packet))) {
 
-        trudpReceiveQueueAdd(tcd->receiveQueue, packet, packet_length, 0);
+        trudpReceiveQueueAdd(tcd->receiveQueue, packet, packet_length);
         tcd->outrunning_cnt++; // Increment outrunning count
 
         // Statistic
@@ -763,21 +1483,26 @@ int trudpChannelProcessReceivedPacket(trudpChannelData *tcd, uint8_t *data,
         break;
       }
 
-      // Reset channel if packet id = 0 and we are waiting for non-zero one
-      // Don't reset in case we waiting for id=1, just skip it to mitigate case
-      // the remote side did not receive our ACK for packet id=0 and sent it again
-      if ((trudpPacketGetId(packet) == 0) && !tcd->zero_tolerance_f && (tcd->receiveExpectedId != 1)) {
-        // Send Send Reset event
-        trudpChannelSendRESET(tcd, NULL, 0);
-        break;
-      }
-
       // Skip already processed packet
       // Statistic
       tcd->stat.packets_receive_dropped++;
       trudpStatProcessLast10Receive(tcd, packet);
     } break;
 
+    // Unreliable DATA packet received: it is not acknowledged and does not
+    // wait for DATA packets before it
+    case TRU_DGRAM: {
+
+      // Send Got Data event
+      trudpChannelSendEventGotData(tcd, packet);
+      _trudpChannelSetLastReceived(tcd);
+
+      // Statistic
+      tcd->stat.packets_receive++;
+      trudpStatProcessLast10Receive(tcd, packet);
+
+    } break;
+
     // RESET packet received
     case TRU_RESET: {
 
@@ -814,6 +1539,334 @@ int trudpChannelProcessReceivedPacket(trudpChannelData *tcd, uint8_t *data,
 
 // Send queue functions ======================================================
 
+/**
+ * Remove acknowledged packet from send queue
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param id Acknowledged packet id
+ *
+ * @return Data length of removed packet or -1 if packet is not in send queue
+ */
+static int _trudpChannelAckPacket(trudpChannelData *tcd, uint32_t id) {
+
+  trudpSendQueueData *sqd = trudpSendQueueFindById(tcd->sendQueue, id);
+  if (sqd == NULL) return -1;
+
+  trudpPacket* sq_packet = trudpSendQueueDataGetPacket(sqd);
+  int send_data_length = trudpPacketGetDataLength(sq_packet);
+
+  // Send time of not retransmitted packet is known exactly
+  if (!sqd->retrieves) {
+    _trudpChannelRackUpdate(tcd, trudpPacketGetTimestamp(sq_packet),
+        teoGetTimestampFull());
+  }
+
+  // Process ACK data callback (packet header only if payload is shared), data
+  // of expired packet was not delivered
+  if (trudpPacketGetType(sq_packet) != TRU_SKIP) {
+    trudpChannelSendEvent(tcd, GOT_ACK, sq_packet,
+        sqd->payload ? TRUDP_HEADER_LENGTH : sqd->packet_length, NULL);
+  }
+
+  // Remove packet from send queue (find it again: callback may send
+  // data and move send queue slots)
+  if (trudpSendQueueDelete(tcd->sendQueue,
+          trudpSendQueueFindById(tcd->sendQueue, id)) == 0) {
+      tcd->td->stat.sendQueue.size_current--;
+  }
+
+  return send_data_length;
+}
+
+/**
+ * Process selective acknowledgement of received ACK: remove all packets
+ * received by peer from send queue. Packets in holes between received ranges
+ * are resent by time based loss detection
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param ack Pointer to received ACK packet
+ *
+ * @return Number of removed packets
+ */
+static size_t _trudpChannelProcessSack(trudpChannelData *tcd,
+                                       trudpPacket *ack) {
+
+  trudpSack sack;
+  if (trudpPacketACKgetSack(ack, &sack)) return 0;
+
+  // Ignore acknowledgement of packets which were not sent (it was sent
+  // before channel reset)
+  uint32_t highest = sack.num ? sack.range[sack.num - 1].last
+                              : sack.cumulative;
+  if (_trudpGetSeqIdDistance(highest, tcd->sendId) < (sack.num ? 1 : 0) ||
+      _trudpGetSeqIdDistance(sack.cumulative, highest) < 0) {
+    return 0;
+  }
+
+  // Release packets before cumulative id and in received ranges
+  size_t i, released = 0;
+  trudpSendQueueData *sqd;
+  while ((sqd = trudpSendQueueGetFirst(tcd->sendQueue)) &&
+         _trudpGetSeqIdDistance(trudpPacketGetId(
+             trudpSendQueueDataGetPacket(sqd)), sack.cumulative) > 0) {
+    if (_trudpChannelAckPacket(tcd, trudpPacketGetId(
+            trudpSendQueueDataGetPacket(sqd))) < 0) break;
+    released++;
+  }
+  for (i = 0; i < sack.num; i++) {
+    uint32_t id = sack.range[i].first;
+    int32_t n = _trudpGetSeqIdDistance(id, sack.range[i].last);
+    for (; n >= 0 && n < RECEIVE_QUEUE_SIZE; n--, id = _trudpGetNextSeqId(id)) {
+      if (_trudpChannelAckPacket(tcd, id) >= 0) released++;
+    }
+  }
+
+  return released;
+}
+
+/**
+ * Get channel congestion controller: the peer one if channels of remote
+ * address share it (trudpSetPeerCongestionControl)
+ *
+ * @param tcd Pointer to trudpChannelData
+ *
+ * @return Pointer to trudpCc
+ */
+static trudpCc *_trudpChannelCc(trudpChannelData *tcd) {
+  return tcd->peer ? &tcd->peer->cc : &tcd->cc;
+}
+
+/**
+ * Pass acknowledged packets to congestion controller. Loss recovery ends when
+ * all packets sent before loss was detected are acknowledged (packets of the
+ * channel which loss started recovery if congestion controller is shared)
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param acked Number of acknowledged packets
+ * @param rtt Round trip time measurement or zero if not measured
+ * @param ts Current timestamp
+ */
+static void _trudpChannelCongestionAck(trudpChannelData *tcd, size_t acked,
+                                       uint32_t rtt, uint64_t ts) {
+
+  trudpCc *cc = _trudpChannelCc(tcd);
+  if (cc->in_recovery && (!tcd->peer || tcd->peer->recovery_tcd == tcd)) {
+    trudpSendQueueData *sqd = trudpSendQueueGetFirst(tcd->sendQueue);
+    if (sqd == NULL || _trudpGetSeqIdDistance(cc->recovery_id,
+            trudpPacketGetId(trudpSendQueueDataGetPacket(sqd))) >= 0) {
+      cc->in_recovery = 0;
+    }
+  }
+  trudpCcOnAck(cc, acked, rtt, ts);
+}
+
+/**
+ * Pass packet loss to congestion controller. Losses reported by selective
+ * acknowledgements reduce window once per window of data (until recovery
+ * ends), retransmit timeout reduces it every time
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param timeout True at retransmit timeout
+ * @param ts Current timestamp
+ */
+static void _trudpChannelCongestionLoss(trudpChannelData *tcd, int timeout,
+                                        uint64_t ts) {
+
+  trudpCc *cc = _trudpChannelCc(tcd);
+  if (cc->in_recovery && !timeout) return;
+
+  trudpCcOnLoss(cc, timeout, ts);
+  cc->in_recovery = !timeout;
+  cc->recovery_id = tcd->sendId;
+  if (tcd->peer) tcd->peer->recovery_tcd = tcd;
+}
+
+/**
+ * Remember send time of packet acknowledged by peer if it was sent after
+ * previous acknowledged one (RACK, RFC 8985)
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param xmit_ts Packet send timestamp (32 bit packet timestamp)
+ * @param ts Current timestamp
+ */
+static void _trudpChannelRackUpdate(trudpChannelData *tcd, uint32_t xmit_ts,
+                                    uint64_t ts) {
+
+  uint32_t rtt = (uint32_t)ts - xmit_ts;
+  uint64_t xmit_time = ts - rtt;
+
+  if (rtt < tcd->rack_min_rtt) tcd->rack_min_rtt = rtt;
+  if (xmit_time > tcd->rack_xmit_time) {
+    tcd->rack_xmit_time = xmit_time;
+    tcd->rack_rtt = rtt;
+  }
+}
+
+/**
+ * Get time when packet sent before packet acknowledged by peer is lost (RACK,
+ * RFC 8985): its send time plus round trip time and reordering window
+ * (quarter of minimal round trip time)
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param sqd Pointer to trudpSendQueueData
+ * @param ts Current timestamp
+ *
+ * @return Lost time or zero if packet was sent after acknowledged one
+ */
+static uint64_t _trudpChannelRackLostTime(trudpChannelData *tcd,
+                                          trudpSendQueueData *sqd,
+                                          uint64_t ts) {
+
+  uint64_t xmit_time = ts - (uint32_t)((uint32_t)ts -
+      trudpPacketGetTimestamp(trudpSendQueueDataGetPacket(sqd)));
+  if (xmit_time >= tcd->rack_xmit_time) return 0;
+
+  return xmit_time + tcd->rack_rtt + tcd->rack_min_rtt / 4;
+}
+
+/**
+ * Detect lost packets by time (RACK, RFC 8985): packet sent before packet
+ * acknowledged by peer is lost when it is not acknowledged during round trip
+ * time plus reordering window. Lost packets are retransmitted as congestion
+ * window (packets in flight which are not lost) and pacing allow, the rest
+ * wait for next ACK or pacing time. The channel wakes up at rack_time to
+ * check packets which may be reordered yet
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param ts Current timestamp
+ *
+ * @return Number of retransmitted packets
+ */
+static size_t _trudpChannelRackDetectLoss(trudpChannelData *tcd, uint64_t ts) {
+
+  size_t rv = 0, lost = 0;
+  trudpSendQueueData *sqd, *first_lost = NULL;
+  uint64_t lost_time;
+
+  tcd->rack_time = 0;
+  for (sqd = trudpSendQueueGetFirst(tcd->sendQueue); sqd;
+       sqd = trudpSendQueueGetNext(tcd->sendQueue, sqd)) {
+
+    // Packets are sent in id order, so next packets were sent later too
+    // unless they were retransmitted
+    if (!(lost_time = _trudpChannelRackLostTime(tcd, sqd, ts))) {
+      if (!sqd->retrieves) break;
+      continue;
+    }
+
+    if (lost_time <= ts) {
+      if (!lost++) first_lost = sqd;
+    } else if (!tcd->rack_time || lost_time < tcd->rack_time) {
+      tcd->rack_time = lost_time;
+    }
+  }
+  if (!lost) return 0;
+
+  _trudpChannelCongestionLoss(tcd, 0, ts);
+
+  // Lost packets are not in flight
+  size_t in_flight = tcd->peer ? trudpPeerSendQueueSize(tcd->peer)
+                               : trudpSendQueueSize(tcd->sendQueue);
+  size_t cwnd = trudpCcGetWindow(_trudpChannelCc(tcd));
+  in_flight -= lost;
+
+  for (sqd = first_lost; sqd && rv < lost && in_flight < cwnd;
+       sqd = trudpSendQueueGetNext(tcd->sendQueue, sqd)) {
+
+    lost_time = _trudpChannelRackLostTime(tcd, sqd, ts);
+    if (!lost_time || lost_time > ts) continue;
+
+    uint64_t pacing_time = _trudpChannelPacingTime(tcd, ts);
+    if (pacing_time > ts) {
+      if (!tcd->rack_time || pacing_time < tcd->rack_time)
+        tcd->rack_time = pacing_time;
+      break;
+    }
+
+    _trudpChannelRetransmit(tcd, sqd, ts);
+    in_flight++;
+    rv++;
+  }
+
+  return rv;
+}
+
+/**
+ * Schedule tail loss probe: two smoothed round trip times after last sent
+ * packet or received ACK (RFC 8985). Only one probe is sent until next ACK,
+ * probe is not scheduled if it comes later than retransmit timeout
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param ts Current timestamp
+ */
+static void _trudpChannelArmProbe(trudpChannelData *tcd, uint64_t ts) {
+
+  tcd->tlp_time = 0;
+  size_t size_sq = trudpSendQueueSize(tcd->sendQueue);
+  if (tcd->tlp_wait_ack_f || !size_sq || !tcd->triptimeMiddle) return;
+
+  // Single packet may wait for peer delayed ACK
+  uint64_t pto = 2 * (uint64_t)tcd->triptimeMiddle;
+  if (size_sq == 1 && tcd->td->ack_every > 1) pto += tcd->td->ack_delay;
+  if (pto < TLP_MIN_TIMEOUT) pto = TLP_MIN_TIMEOUT;
+
+  if (pto < tcd->rto) tcd->tlp_time = ts + pto;
+}
+
+/**
+ * Send tail loss probe: next packet of write queue if congestion window
+ * allows, or last packet of send queue otherwise. ACK to probe lets time based
+ * loss detection find lost packets of the tail without retransmit timeout
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param ts Current timestamp
+ *
+ * @return Number of sent packets
+ */
+static size_t _trudpChannelSendProbe(trudpChannelData *tcd, uint64_t ts) {
+
+  tcd->tlp_time = 0;
+  trudpSendQueueData *sqd = trudpSendQueueGetLast(tcd->sendQueue);
+  if (sqd == NULL) return 0;
+
+  tcd->tlp_wait_ack_f = true;
+  if (_trudpChannelWindowOpen(tcd) && _trudpChannelWriteQueueMove(tcd))
+    return 1;
+
+  _trudpChannelRetransmit(tcd, sqd, ts);
+  return 1;
+}
+
+/**
+ * Resend packet of send queue
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param tqd Pointer to trudpSendQueueData
+ * @param ts Current timestamp
+ */
+static void _trudpChannelRetransmit(trudpChannelData *tcd,
+                                    trudpSendQueueData *tqd, uint64_t ts) {
+
+  // Change records expected time
+  trudpSendQueueSetExpectedTime(tcd->sendQueue, tqd,
+      _trudpChannelCalculateExpectedTime(tcd, ts));
+  tcd->stat.packets_attempt++; // Attempt statistic parameter increment
+  if (!tqd->retrieves)
+    tqd->retrieves_start = ts;
+
+  tqd->retrieves++;
+
+  // Expired packet is not resent, receiver is told to skip its id
+  if (tqd->deadline && tqd->deadline <= ts) trudpSendQueueDataSkip(tqd);
+
+  trudpPacket* tq_packet = trudpSendQueueDataGetPacket(tqd);
+
+  // Resend data
+  _trudpChannelPacingConsume(tcd, tqd->packet_length, ts);
+  trudpPacketUpdateTimestamp(tq_packet);
+  _trudpChannelSendSlot(tcd, tqd);
+}
+
 /**
  * Check send Queue elements and resend elements with expired time
  *
@@ -831,35 +1884,64 @@ int trudpChannelSendQueueProcess(trudpChannelData *tcd, uint64_t ts,
   int rv = 0;
   trudpSendQueueData *tqd = NULL;
 
-  // Get first element from send queue and check it expected time
+  // Retransmit packets lost by time and send tail loss probe
+  if (tcd->rack_time && tcd->rack_time <= ts) {
+    rv += _trudpChannelRackDetectLoss(tcd, ts);
+  }
+  if (tcd->tlp_time && tcd->tlp_time <= ts) {
+    rv += _trudpChannelSendProbe(tcd, ts);
+  }
+
+  // Check minimal expected time of send queue packets: retransmitted first
+  // packet may expire after next ones
   if (trudpSendQueueSize(tcd->sendQueue) &&
-      (tqd = trudpSendQueueGetFirst(tcd->sendQueue)) &&
-      tqd->expected_time <= ts) {
-
-    // Change records expected time
-    tqd->expected_time =
-        _trudpChannelCalculateExpectedTime(tcd, ts, tqd->retrieves);
-    if (tcd->td->expected_max_time > tqd->expected_time) {
-        _updateMainExpectedTimeAndChannel(tcd, tqd->expected_time);
-    } else if (tcd->td->channel_key == tcd->channel_key) {
-      trudpRecalculateExpectedSendTime(tcd->td);
+      trudpSendQueueGetExpectedTime(tcd->sendQueue) <= ts) {
+
+    // Double retransmit timeout until next round trip time measurement and
+    // reduce congestion window. Packets sent together expire together, so it
+    // is done once per retransmit timeout. No tail loss probe until next ACK
+    if (ts >= tcd->rto_backoff_time + tcd->rto) {
+      tcd->rto_backoff_time = ts;
+      _trudpChannelSetRto(tcd, (int64_t)tcd->rto * 2);
+      _trudpChannelCongestionLoss(tcd, 1, ts);
     }
-    // Move record to the end of Queue \todo or don't move record to the end of
-    // queue because it should be send first
-    // trudpPacketQueueMoveToEnd(tcd->sendQueue, tqd);
-    tcd->stat.packets_attempt++; // Attempt statistic parameter increment
-    if (!tqd->retrieves)
-      tqd->retrieves_start = ts;
-
-    tqd->retrieves++;
-    rv++;
-
-    trudpPacket* tq_packet = trudpPacketQueueDataGetPacket(tqd);
+    tcd->tlp_time = 0;
+    tcd->tlp_wait_ack_f = true;
+
+    // Expired packets are not in flight any more, so they are resent in send
+    // order within congestion window less packets still in flight, at least
+    // one packet per timeout
+    size_t expired = 0;
+    for (tqd = trudpSendQueueGetFirst(tcd->sendQueue); tqd;
+         tqd = trudpSendQueueGetNext(tcd->sendQueue, tqd)) {
+      if (tqd->expected_time <= ts) expired++;
+    }
+    size_t in_flight = (tcd->peer ? trudpPeerSendQueueSize(tcd->peer) :
+        trudpSendQueueSize(tcd->sendQueue)) - expired;
+    size_t cwnd = trudpCcGetWindow(_trudpChannelCc(tcd));
+    size_t budget = in_flight < cwnd ? cwnd - in_flight : 1;
+
+    // Rest of expired packets wait for next timeout or for ACK which detects
+    // them by RACK: the channel is not due again at this time
+    size_t resent = 0;
+    uint64_t deferred_time = _trudpChannelCalculateExpectedTime(tcd, ts);
+    for (tqd = trudpSendQueueGetFirst(tcd->sendQueue); tqd;
+         tqd = trudpSendQueueGetNext(tcd->sendQueue, tqd)) {
+      if (tqd->expected_time > ts) continue;
+      if (resent < budget) {
+        _trudpChannelRetransmit(tcd, tqd, ts);
+        resent++;
+      }
+      else trudpSendQueueSetExpectedTime(tcd->sendQueue, tqd, deferred_time);
+    }
+    rv += resent;
+  }
 
-    // Resend data
-    trudpPacketUpdateTimestamp(tq_packet);
-    trudpChannelSendEvent(tcd, PROCESS_SEND, tq_packet, tqd->packet_length, NULL);
+  // Send write queue packets delayed by pacing
+  if (tcd->td->pacing && trudpWriteQueueSize(tcd->writeQueue)) {
+    while (_trudpChannelSendNow(tcd) && _trudpChannelWriteQueueMove(tcd));
   }
+  _trudpChannelUpdateExpectedTime(tcd);
 
   // Disconnect channel at long last receive
   if (trudpChannelCheckDisconnected(tcd, ts) == -1) {
@@ -883,9 +1965,9 @@ int trudpChannelSendQueueProcess(trudpChannelData *tcd, uint64_t ts,
 
   // If record exists
   if (next_expected_time) {
-    if (rv != -1)
-      tqd = trudpSendQueueGetFirst(tcd->sendQueue);
-    *next_expected_time = tqd ? tqd->expected_time : 0;
+    uint64_t expected_time = rv != -1 ?
+        trudpSendQueueGetExpectedTime(tcd->sendQueue) : UINT64_MAX;
+    *next_expected_time = expected_time != UINT64_MAX ? expected_time : 0;
   }
 
   return rv;
@@ -894,48 +1976,121 @@ int trudpChannelSendQueueProcess(trudpChannelData *tcd, uint64_t ts,
 // Write queue functions ======================================================
 
 /**
- * Process write queue and send first ready packet
+ * Make channel deficit round robin round: add quantum to channel deficit and
+ * send write queue packets while they fit the deficit and congestion window
+ * allows. Channel which can't send now loses its deficit, so it can't send a
+ * burst later
  *
- * @param tcd
+ * @param tcd Pointer to trudpChannelData
+ *
+ * @return Size of send packets or 0 if nothing was sent
+ */
+static size_t _trudpChannelWriteQueueRound(trudpChannelData *tcd) {
+
+  size_t rv = 0;
+  trudpWriteQueueData *wqd;
+
+  tcd->write_deficit += tcd->write_quantum;
+  while ((wqd = trudpWriteQueueGetFirst(tcd->writeQueue)) &&
+         wqd->packet_length <= tcd->write_deficit &&
+         _trudpChannelSendNow(tcd)) {
+    tcd->write_deficit -= wqd->packet_length;
+    rv += _trudpChannelWriteQueueMove(tcd);
+  }
+
+  if (tcd->write_active.next && wqd &&
+      wqd->packet_length <= tcd->write_deficit) {
+    tcd->write_deficit = 0;
+  }
+
+  return rv;
+}
+
+/**
+ * Process write queue in deficit round robin round of channel priority class.
+ * Channel which write queue is not empty moves to the end of its round robin
+ * list
+ *
+ * @param tcd Pointer to trudpChannelData
  *
- * @return Number of send packet or 0 if write queue is empty
+ * @return Size of send packets or 0 if nothing was sent
  */
 size_t trudpChannelWriteQueueProcess(trudpChannelData *tcd) {
 
-  size_t retval = 0;
-  trudpWriteQueueData *wqd = trudpWriteQueueGetFirst(tcd->writeQueue);
-  if (wqd) {
-    void *packet = wqd->packet_ptr ? wqd->packet_ptr : wqd->packet;
-    trudpChannelSendEvent(tcd, PROCESS_SEND, packet, wqd->packet_length, NULL);
-    trudpWriteQueueDeleteFirst(tcd->writeQueue);
-    retval = wqd->packet_length;
+  size_t rv = _trudpChannelWriteQueueRound(tcd);
+
+  if (tcd->write_active.next) {
+    trudpTimerWheelListAdd(&tcd->td->write_active_list[tcd->priority],
+                           &tcd->write_active, 0);
   }
 
-  return retval;
+  return rv;
 }
 
+/**
+ * Check that channel write queue has packets which congestion window and
+ * pacing allow to send now
+ *
+ * @param tcd Pointer to trudpChannelData
+ *
+ * @return True if write queue packet may be sent now
+ */
+int trudpChannelWriteQueueReady(trudpChannelData *tcd) {
+  return trudpWriteQueueSize(tcd->writeQueue) && _trudpChannelSendNow(tcd);
+}
 
-// Forward declare trudpData.Need some code-reorganize
-void trudpRecalculateExpectedSendTime(struct trudpData *td) {
-    teoMapIterator it;
-    teoMapElementData *el;
-    uint64_t min_time = UINT64_MAX;
-    char *min_channel_key = NULL;
-    uint64_t current_time = teoGetTimestampFull();
-    teoMapIteratorReset(&it, td->map);
-    while((el = teoMapIteratorNext(&it))) {
-        trudpChannelData *tcd = (trudpChannelData *)teoMapIteratorElementData(el, NULL);
-        uint64_t expected_time = trudpSendQueueGetExpectedTime(tcd->sendQueue);
+/**
+ * Fill shared congestion window of peer from write queues of its channels:
+ * channel with the highest priority and not empty write queue makes deficit
+ * round robin round and moves to the end of channels with its priority,
+ * until window is full or write queues are empty
+ *
+ * @param peer Pointer to trudpPeer
+ */
+static void _trudpChannelPeerWriteQueueProcess(trudpPeer *peer) {
 
-        if (expected_time <= current_time) {
-            min_time = current_time;
-            min_channel_key = tcd->channel_key;
-            break;
-        } else if (expected_time < min_time) {
-            min_time = expected_time;
-            min_channel_key = tcd->channel_key;
-        }
-    }
-    td->expected_max_time = min_time;
-    td->channel_key = min_channel_key;
-}
\ No newline at end of file
+  trudpChannelData *tcd;
+  while ((tcd = trudpPeerGetWriteChannel(peer)) &&
+         _trudpChannelSendNow(tcd)) {
+    _trudpChannelWriteQueueRound(tcd);
+    trudpPeerMoveLast(tcd);
+  }
+}
+
+/**
+ * Set channel write queue scheduler priority class (strict priority). Write
+ * queues of channels with lower priority are sent by trudpProcessWriteQueue
+ * only when channels with higher priority can't send (their write queues are
+ * empty or congestion window or pacing does not allow), and when channels of
+ * remote address share congestion controller, higher priority channels fill
+ * its window first. Channels of the same priority share send rate by their
+ * quantum (trudpChannelSetWriteQuantum)
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param priority Priority class from 0 (the highest, default) to
+ *        WRITE_QUEUE_PRIORITIES - 1
+ */
+void trudpChannelSetPriority(trudpChannelData *tcd, int priority) {
+
+  if (priority < 0) priority = 0;
+  if (priority >= WRITE_QUEUE_PRIORITIES) priority = WRITE_QUEUE_PRIORITIES - 1;
+  tcd->priority = priority;
+
+  if (tcd->write_active.next) {
+    trudpTimerWheelListAdd(&tcd->td->write_active_list[priority],
+                           &tcd->write_active, 0);
+  }
+  trudpPeerMoveLast(tcd);
+}
+
+/**
+ * Set channel unreliable mode: trudpChannelSendData sends data by unreliable
+ * datagrams (trudpChannelSendDatagram). Packets which are already in write
+ * and send queues are delivered reliably
+ *
+ * @param tcd Pointer to trudpChannelData
+ * @param enable Send unreliable datagrams if true
+ */
+void trudpChannelSetUnreliable(trudpChannelData *tcd, int enable) {
+  tcd->unreliable_f = enable != 0;
+}
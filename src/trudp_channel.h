@@ -54,8 +54,13 @@ typedef int socklen_t;
 #include "teobase/types.h"
 
 #include "trudp_api.h"
+#include "trudp_cc.h"
 #include "trudp_const.h"
+#include "trudp_channel_index.h"
+#include "trudp_pacing.h"
+#include "trudp_peer.h"
 #include "trudp_send_queue.h"
+#include "trudp_timer_wheel.h"
 #include "trudp_receive_queue.h"
 
 #include "packet_queue.h"
@@ -116,10 +121,13 @@ struct trudpData;
 typedef struct trudpChannelData {
 
     uint32_t sendId; ///< Send ID
+    uint32_t dgramSendId; ///< Send ID of unreliable datagrams
     trudpSendQueue *sendQueue; ///< Pointer to send queue trudpSendQueue
     uint32_t triptime; ///< Trip time
-    double triptimeFactor; ///< Triptime factor
-    uint32_t triptimeMiddle; ///< Trip time middle
+    uint32_t triptimeMiddle; ///< Trip time middle (smoothed round trip time)
+    uint32_t rttvar; ///< Round trip time variation
+    uint32_t rto; ///< Retransmit timeout
+    uint64_t rto_backoff_time; ///< Last retransmit timeout backoff time
     uint32_t lastSentPing; ///< Last ping send time
 
     trudpWriteQueue *writeQueue; ///< Pointer to write queue trudpWriteQueue
@@ -150,22 +158,65 @@ typedef struct trudpChannelData {
     size_t read_buffer_size;
     size_t last_packet_ptr;
 
-    // Cached channel unique string key
+    // Cached channel unique string key (used in statistic and logs)
     char *channel_key;
     size_t channel_key_length;
 
+    trudpChannelKey key;        ///< Binary channel key (used in channel index)
+    size_t heap_idx;            ///< Position in trudpData channel heap plus one (zero if not in heap)
+    trudpTimerWheelNode keepalive; ///< Keepalive timer (in trudpData keepalive wheel)
+    trudpCc cc;                 ///< Congestion controller
+    trudpTokenBucket pacing;    ///< Send pacing token bucket
+    trudpTimerWheelNode write_blocked; ///< Node of trudpData list of channels waiting for WRITABLE event
+    trudpTimerWheelNode write_active; ///< Node of trudpData list of channels with not empty write queue
+    size_t write_quantum;       ///< Bytes added to write deficit every scheduler round
+    size_t write_deficit;       ///< Bytes channel may send from write queue in current round
+    int priority;               ///< Write queue scheduler priority class (0 is the highest)
+    trudpPeer *peer;            ///< Peer sharing congestion controller or NULL
+    bool unreliable_f;          ///< Channel sends data by unreliable datagrams (trudpChannelSetUnreliable)
+    trudpTimerWheelNode peer_node; ///< Node of peer channels list
+
+    // Time based loss detection (RACK) and tail loss probe
+    uint64_t rack_xmit_time;    ///< Send time of last sent packet acknowledged by peer
+    uint32_t rack_rtt;          ///< Round trip time of this packet
+    uint32_t rack_min_rtt;      ///< Minimal round trip time
+    uint64_t rack_time;         ///< Time when not acknowledged packets become lost or zero
+    uint64_t tlp_time;          ///< Tail loss probe time or zero
+    bool tlp_wait_ack_f;        ///< Next tail loss probe waits for ACK
+
+    // Delayed ACK
+    trudpTimerWheelNode ack_timer; ///< Delayed ACK timer (in trudpData delayed ACK list)
+    uint32_t ack_pending;       ///< Number of received DATA packets not acknowledged yet
+    char ack_header[TRUDP_HEADER_LENGTH]; ///< Header of last not acknowledged DATA packet
+
 } trudpChannelData;
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * trudpChannelSendData result when write queue is full, WRITABLE event is
+ * sent when data may be sent again
+ */
+#define TRUDP_SEND_WOULD_BLOCK ((size_t)-1)
+
 TRUDP_API void trudpChannelDestroy(trudpChannelData *tcd);
 TRUDP_API const char *trudpChannelMakeKey(trudpChannelData *tcd);
 TRUDP_API trudpChannelData *trudpChannelNew(struct trudpData *td,
         const char *remote_address, int remote_port_i, int channel);
+TRUDP_API trudpChannelData *trudpChannelNewAddr(struct trudpData *td,
+        __CONST_SOCKADDR_ARG addr, socklen_t addr_len, int channel);
 TRUDP_API size_t trudpChannelSendData(trudpChannelData *tcd, void *data,
   size_t data_length);
+TRUDP_API size_t trudpChannelSendPayload(trudpChannelData *tcd,
+  trudpPayload *payload);
+TRUDP_API size_t trudpChannelSendDataExpire(trudpChannelData *tcd, void *data,
+  size_t data_length, uint32_t lifetime);
+TRUDP_API size_t trudpChannelSendDatagram(trudpChannelData *tcd, void *data,
+  size_t data_length);
+size_t trudpChannelSendDataUnlimited(trudpChannelData *tcd, void *data,
+  size_t data_length);
 TRUDP_API void trudpChannelSendRESET(trudpChannelData *tcd, void* data, size_t data_length);
 /**
  * Create RESET packet and send it to sender
@@ -173,6 +224,10 @@ TRUDP_API void trudpChannelSendRESET(trudpChannelData *tcd, void* data, size_t d
  * @param tcd Pointer to trudpChannelData
  */
 TRUDP_API void trudp_ChannelSendReset(trudpChannelData *tcd);
+TRUDP_API void trudpChannelSetWriteQuantum(trudpChannelData *tcd,
+        size_t quantum);
+TRUDP_API void trudpChannelSetPriority(trudpChannelData *tcd, int priority);
+TRUDP_API void trudpChannelSetUnreliable(trudpChannelData *tcd, int enable);
 
 TRUDP_API int trudpChannelProcessReceivedPacket(trudpChannelData *tcd, uint8_t *data,
         size_t packet_length);
@@ -183,7 +238,9 @@ int trudpChannelSendQueueProcess(trudpChannelData *tcd, uint64_t ts,
         uint64_t *next_expected_time);
 int trudpChannelCheckDisconnected(trudpChannelData *tcd, uint64_t ts);
 size_t trudpChannelWriteQueueProcess(trudpChannelData *tcd);
-TRUDP_API void trudpRecalculateExpectedSendTime(struct trudpData *td);
+int trudpChannelWriteQueueReady(trudpChannelData *tcd);
+void trudpChannelSendDelayedACK(trudpChannelData *tcd);
+void trudpChannelSendWritable(struct trudpData *td);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,230 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_channel_heap.c
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Channel heap: finds channels which send queue expected time came without
+ * scanning all channels.
+ *
+ * Created on October 17, 2026, 2:05 PM
+ */
+
+#include "trudp_channel_heap.h"
+
+#include "teoccl/memory.h"
+
+#include "trudp_channel.h"
+
+#define CHANNEL_HEAP_MIN_SIZE 16
+
+// Local functions
+static void _trudpChannelHeapSet(trudpChannelHeap *heap, size_t i,
+        trudpChannelHeapData *hd);
+static void _trudpChannelHeapUp(trudpChannelHeap *heap, size_t i);
+static void _trudpChannelHeapDown(trudpChannelHeap *heap, size_t i);
+
+/**
+ * Create new channel heap
+ *
+ * @param size Expected number of channels
+ *
+ * @return Pointer to trudpChannelHeap
+ */
+trudpChannelHeap *trudpChannelHeapNew(size_t size) {
+
+    trudpChannelHeap *heap = (trudpChannelHeap *)ccl_calloc(
+            sizeof(trudpChannelHeap));
+    heap->alloc = size > CHANNEL_HEAP_MIN_SIZE ? size : CHANNEL_HEAP_MIN_SIZE;
+    heap->data = (trudpChannelHeapData *)ccl_malloc(
+            heap->alloc * sizeof(trudpChannelHeapData));
+
+    return heap;
+}
+
+/**
+ * Destroy channel heap
+ *
+ * @param heap Pointer to trudpChannelHeap
+ */
+void trudpChannelHeapDestroy(trudpChannelHeap *heap) {
+    if (heap) {
+        free(heap->data);
+        free(heap);
+    }
+}
+
+/**
+ * Get number of channels in heap
+ *
+ * @param heap Pointer to trudpChannelHeap
+ *
+ * @return Number of channels
+ */
+size_t trudpChannelHeapSize(trudpChannelHeap *heap) {
+    return heap->size;
+}
+
+/**
+ * Put element to heap position and save the position in the channel
+ *
+ * @param heap Pointer to trudpChannelHeap
+ * @param i Heap position
+ * @param hd Pointer to element
+ */
+static void _trudpChannelHeapSet(trudpChannelHeap *heap, size_t i,
+        trudpChannelHeapData *hd) {
+
+    heap->data[i] = *hd;
+    hd->tcd->heap_idx = i + 1;
+}
+
+/**
+ * Move element up to its place
+ *
+ * @param heap Pointer to trudpChannelHeap
+ * @param i Heap position of element
+ */
+static void _trudpChannelHeapUp(trudpChannelHeap *heap, size_t i) {
+
+    trudpChannelHeapData hd = heap->data[i];
+    while (i) {
+        size_t parent = (i - 1) / 2;
+        if (heap->data[parent].expected_time <= hd.expected_time) break;
+        _trudpChannelHeapSet(heap, i, &heap->data[parent]);
+        i = parent;
+    }
+    _trudpChannelHeapSet(heap, i, &hd);
+}
+
+/**
+ * Move element down to its place
+ *
+ * @param heap Pointer to trudpChannelHeap
+ * @param i Heap position of element
+ */
+static void _trudpChannelHeapDown(trudpChannelHeap *heap, size_t i) {
+
+    trudpChannelHeapData hd = heap->data[i];
+    for (;;) {
+        size_t child = i * 2 + 1;
+        if (child >= heap->size) break;
+        if (child + 1 < heap->size && heap->data[child + 1].expected_time <
+                heap->data[child].expected_time) {
+            child++;
+        }
+        if (hd.expected_time <= heap->data[child].expected_time) break;
+        _trudpChannelHeapSet(heap, i, &heap->data[child]);
+        i = child;
+    }
+    _trudpChannelHeapSet(heap, i, &hd);
+}
+
+/**
+ * Add channel to heap or change its expected time. Channel with expected
+ * time UINT64_MAX (empty send queue) is removed from heap
+ *
+ * @param heap Pointer to trudpChannelHeap
+ * @param tcd Pointer to trudpChannelData
+ * @param expected_time Send queue expected time
+ *
+ * @return Zero at success
+ */
+int trudpChannelHeapUpdate(trudpChannelHeap *heap,
+        struct trudpChannelData *tcd, uint64_t expected_time) {
+
+    if (expected_time == UINT64_MAX) {
+        trudpChannelHeapRemove(heap, tcd);
+        return 0;
+    }
+
+    // Change expected time of channel in heap
+    if (tcd->heap_idx) {
+        size_t i = tcd->heap_idx - 1;
+        uint64_t old_expected_time = heap->data[i].expected_time;
+        heap->data[i].expected_time = expected_time;
+        if (expected_time < old_expected_time) _trudpChannelHeapUp(heap, i);
+        else _trudpChannelHeapDown(heap, i);
+        return 0;
+    }
+
+    // Add channel to heap
+    if (heap->size == heap->alloc) {
+        trudpChannelHeapData *data = (trudpChannelHeapData *)ccl_realloc(
+                heap->data, heap->alloc * 2 * sizeof(trudpChannelHeapData));
+        if (data == NULL) return -1;
+        heap->data = data;
+        heap->alloc *= 2;
+    }
+    heap->data[heap->size].expected_time = expected_time;
+    heap->data[heap->size].tcd = tcd;
+    _trudpChannelHeapUp(heap, heap->size++);
+
+    return 0;
+}
+
+/**
+ * Remove channel from heap
+ *
+ * @param heap Pointer to trudpChannelHeap
+ * @param tcd Pointer to trudpChannelData
+ */
+void trudpChannelHeapRemove(trudpChannelHeap *heap,
+        struct trudpChannelData *tcd) {
+
+    if (!tcd->heap_idx) return;
+
+    size_t i = tcd->heap_idx - 1;
+    tcd->heap_idx = 0;
+    if (i == --heap->size) return;
+
+    // Move last element to the freed position
+    uint64_t old_expected_time = heap->data[i].expected_time;
+    _trudpChannelHeapSet(heap, i, &heap->data[heap->size]);
+    if (heap->data[i].expected_time < old_expected_time) {
+        _trudpChannelHeapUp(heap, i);
+    } else {
+        _trudpChannelHeapDown(heap, i);
+    }
+}
+
+/**
+ * Get channel with minimal expected time
+ *
+ * @param heap Pointer to trudpChannelHeap
+ * @param expected_time [out] Expected time of the channel or UINT64_MAX if
+ *        heap is empty, may be NULL
+ *
+ * @return Pointer to trudpChannelData or NULL if heap is empty
+ */
+struct trudpChannelData *trudpChannelHeapTop(trudpChannelHeap *heap,
+        uint64_t *expected_time) {
+
+    if (!heap->size) {
+        if (expected_time) *expected_time = UINT64_MAX;
+        return NULL;
+    }
+    if (expected_time) *expected_time = heap->data[0].expected_time;
+
+    return heap->data[0].tcd;
+}
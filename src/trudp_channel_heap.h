@@ -0,0 +1,81 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_channel_heap.h
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Created on October 17, 2026, 2:05 PM
+ */
+
+#ifndef TRUDP_CHANNEL_HEAP_H
+#define TRUDP_CHANNEL_HEAP_H
+
+#include <stdlib.h>
+
+#include "teobase/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Forward declare trudpChannelData to use it in trudpChannelHeap.
+struct trudpChannelData;
+
+/**
+ * Channel heap element
+ */
+typedef struct trudpChannelHeapData {
+
+    uint64_t expected_time;        ///< Channel send queue expected time
+    struct trudpChannelData *tcd;  ///< Pointer to channel
+
+} trudpChannelHeapData;
+
+/**
+ * Channel heap: binary min-heap of channels ordered by send queue expected
+ * time. Channel keeps its heap position in trudpChannelData.heap_idx, so
+ * it can be updated or removed in O(log N)
+ */
+typedef struct trudpChannelHeap {
+
+    trudpChannelHeapData *data; ///< Heap array
+    size_t size;                ///< Number of channels in heap
+    size_t alloc;               ///< Allocated number of elements
+
+} trudpChannelHeap;
+
+trudpChannelHeap *trudpChannelHeapNew(size_t size);
+void trudpChannelHeapDestroy(trudpChannelHeap *heap);
+size_t trudpChannelHeapSize(trudpChannelHeap *heap);
+int trudpChannelHeapUpdate(trudpChannelHeap *heap,
+        struct trudpChannelData *tcd, uint64_t expected_time);
+void trudpChannelHeapRemove(trudpChannelHeap *heap,
+        struct trudpChannelData *tcd);
+struct trudpChannelData *trudpChannelHeapTop(trudpChannelHeap *heap,
+        uint64_t *expected_time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRUDP_CHANNEL_HEAP_H */
@@ -0,0 +1,321 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_channel_index.c
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Channel index: finds channel by binary remote address without formatting
+ * the address to string. Open addressing with linear probing, keys are hashed
+ * with SipHash-1-3 using random per-index key, so remote peers can't choose
+ * addresses to collide.
+ *
+ * Created on October 17, 2026, 10:12 AM
+ */
+
+#include "trudp_channel_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "teoccl/memory.h"
+
+#include "packet.h"
+
+#define CHANNEL_INDEX_MIN_SIZE 16
+
+// Local functions
+static uint64_t _trudpChannelKeyHash(trudpChannelIndex *idx,
+        const trudpChannelKey *key);
+static size_t _trudpChannelIndexFind(trudpChannelIndex *idx,
+        const trudpChannelKey *key, uint64_t hash);
+static int _trudpChannelIndexResize(trudpChannelIndex *idx, size_t size);
+
+/**
+ * Make binary channel key from socket address and channel number
+ *
+ * @param key [out] Pointer to trudpChannelKey to fill
+ * @param addr Pointer to socket address
+ * @param addr_len Length of socket address
+ * @param channel TR-UDP channel number
+ *
+ * @return Zero at success or -1 if address family is not supported
+ */
+int trudpChannelKeyMake(trudpChannelKey *key, __CONST_SOCKADDR_ARG addr,
+        socklen_t addr_len, int channel) {
+
+    memset(key, 0, sizeof(*key));
+    key->channel = (uint32_t)channel;
+
+    if (addr->sa_family == AF_INET &&
+            addr_len >= (socklen_t)sizeof(struct sockaddr_in)) {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)addr;
+        key->family = AF_INET;
+        key->port = sin->sin_port;
+        memcpy(key->addr, &sin->sin_addr, sizeof(sin->sin_addr));
+        return 0;
+    }
+
+    if (addr->sa_family == AF_INET6 &&
+            addr_len >= (socklen_t)sizeof(struct sockaddr_in6)) {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)addr;
+        key->family = AF_INET6;
+        key->port = sin6->sin6_port;
+        key->scope_id = sin6->sin6_scope_id;
+        memcpy(key->addr, &sin6->sin6_addr, sizeof(sin6->sin6_addr));
+        return 0;
+    }
+
+    return -1;
+}
+
+#define ROTL64(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+#define SIPROUND                                                               \
+    do {                                                                       \
+        v0 += v1; v1 = ROTL64(v1, 13); v1 ^= v0; v0 = ROTL64(v0, 32);          \
+        v2 += v3; v3 = ROTL64(v3, 16); v3 ^= v2;                               \
+        v0 += v3; v3 = ROTL64(v3, 21); v3 ^= v0;                               \
+        v2 += v1; v1 = ROTL64(v1, 17); v1 ^= v2; v2 = ROTL64(v2, 32);          \
+    } while (0)
+
+/**
+ * Calculate SipHash-1-3 of channel key
+ *
+ * @param idx Pointer to trudpChannelIndex (contains hash key)
+ * @param key Pointer to trudpChannelKey
+ *
+ * @return 64 bit hash
+ */
+static uint64_t _trudpChannelKeyHash(trudpChannelIndex *idx,
+        const trudpChannelKey *key) {
+
+    uint64_t v0 = idx->k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = idx->k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = idx->k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = idx->k1 ^ 0x7465646279746573ULL;
+    uint64_t m[sizeof(trudpChannelKey) / sizeof(uint64_t)];
+    size_t i;
+
+    memcpy(m, key, sizeof(m));
+    for (i = 0; i < sizeof(m) / sizeof(m[0]); i++) {
+        v3 ^= m[i];
+        SIPROUND;
+        v0 ^= m[i];
+    }
+
+    uint64_t b = ((uint64_t)sizeof(m)) << 56;
+    v3 ^= b;
+    SIPROUND;
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+#undef SIPROUND
+#undef ROTL64
+
+/**
+ * Create new channel index
+ *
+ * @param size Expected number of channels
+ *
+ * @return Pointer to trudpChannelIndex
+ */
+trudpChannelIndex *trudpChannelIndexNew(size_t size) {
+
+    trudpChannelIndex *idx = (trudpChannelIndex *)ccl_calloc(
+            sizeof(trudpChannelIndex));
+
+    // Keep load factor below 1/2
+    size_t slots = CHANNEL_INDEX_MIN_SIZE;
+    while (slots < size * 2) slots <<= 1;
+    idx->slots = (trudpChannelIndexSlot *)ccl_calloc(
+            slots * sizeof(trudpChannelIndexSlot));
+    idx->mask = slots - 1;
+    idx->size = 0;
+
+    // Random hash key
+    uint64_t seed = teoGetTimestampFull() ^ (uint64_t)(uintptr_t)idx;
+    seed ^= (uint64_t)(uintptr_t)idx->slots << 17;
+    idx->k0 = seed * 0x9e3779b97f4a7c15ULL;
+    idx->k1 = (seed ^ (seed >> 29)) * 0xbf58476d1ce4e5b9ULL;
+
+    return idx;
+}
+
+/**
+ * Destroy channel index
+ *
+ * @param idx Pointer to trudpChannelIndex
+ */
+void trudpChannelIndexDestroy(trudpChannelIndex *idx) {
+    if (idx) {
+        free(idx->slots);
+        free(idx);
+    }
+}
+
+/**
+ * Get number of channels in index
+ *
+ * @param idx Pointer to trudpChannelIndex
+ *
+ * @return Number of channels
+ */
+size_t trudpChannelIndexSize(trudpChannelIndex *idx) {
+    return idx->size;
+}
+
+/**
+ * Find slot with key or empty slot where key should be added
+ *
+ * @param idx Pointer to trudpChannelIndex
+ * @param key Pointer to trudpChannelKey
+ * @param hash Hash of the key
+ *
+ * @return Slot number
+ */
+static size_t _trudpChannelIndexFind(trudpChannelIndex *idx,
+        const trudpChannelKey *key, uint64_t hash) {
+
+    size_t i = (size_t)hash & idx->mask;
+    for (;;) {
+        trudpChannelIndexSlot *slot = &idx->slots[i];
+        if (slot->tcd == NULL) return i;
+        if (slot->hash == hash && !memcmp(&slot->key, key, sizeof(*key))) {
+            return i;
+        }
+        i = (i + 1) & idx->mask;
+    }
+}
+
+/**
+ * Resize channel index slots array
+ *
+ * @param idx Pointer to trudpChannelIndex
+ * @param size New number of slots (power of two)
+ *
+ * @return Zero at success
+ */
+static int _trudpChannelIndexResize(trudpChannelIndex *idx, size_t size) {
+
+    trudpChannelIndexSlot *slots = (trudpChannelIndexSlot *)ccl_calloc(
+            size * sizeof(trudpChannelIndexSlot));
+    if (slots == NULL) return -1;
+
+    trudpChannelIndexSlot *old_slots = idx->slots;
+    size_t old_size = idx->mask + 1, i;
+
+    idx->slots = slots;
+    idx->mask = size - 1;
+    for (i = 0; i < old_size; i++) {
+        if (old_slots[i].tcd != NULL) {
+            size_t j = _trudpChannelIndexFind(idx, &old_slots[i].key,
+                    old_slots[i].hash);
+            idx->slots[j] = old_slots[i];
+        }
+    }
+    free(old_slots);
+
+    return 0;
+}
+
+/**
+ * Get channel by key
+ *
+ * @param idx Pointer to trudpChannelIndex
+ * @param key Pointer to trudpChannelKey
+ *
+ * @return Pointer to trudpChannelData or NULL if not found
+ */
+struct trudpChannelData *trudpChannelIndexGet(trudpChannelIndex *idx,
+        const trudpChannelKey *key) {
+
+    uint64_t hash = _trudpChannelKeyHash(idx, key);
+    return idx->slots[_trudpChannelIndexFind(idx, key, hash)].tcd;
+}
+
+/**
+ * Add channel to index or replace channel with the same key
+ *
+ * @param idx Pointer to trudpChannelIndex
+ * @param key Pointer to trudpChannelKey
+ * @param tcd Pointer to trudpChannelData
+ *
+ * @return Zero at success
+ */
+int trudpChannelIndexAdd(trudpChannelIndex *idx, const trudpChannelKey *key,
+        struct trudpChannelData *tcd) {
+
+    if ((idx->size + 1) * 2 > idx->mask + 1 &&
+            _trudpChannelIndexResize(idx, (idx->mask + 1) * 2)) {
+        return -1;
+    }
+
+    uint64_t hash = _trudpChannelKeyHash(idx, key);
+    trudpChannelIndexSlot *slot =
+            &idx->slots[_trudpChannelIndexFind(idx, key, hash)];
+    if (slot->tcd == NULL) idx->size++;
+    slot->hash = hash;
+    slot->key = *key;
+    slot->tcd = tcd;
+
+    return 0;
+}
+
+/**
+ * Remove channel from index
+ *
+ * @param idx Pointer to trudpChannelIndex
+ * @param key Pointer to trudpChannelKey
+ *
+ * @return Zero at success or -1 if key not found
+ */
+int trudpChannelIndexDelete(trudpChannelIndex *idx,
+        const trudpChannelKey *key) {
+
+    uint64_t hash = _trudpChannelKeyHash(idx, key);
+    size_t i = _trudpChannelIndexFind(idx, key, hash);
+    if (idx->slots[i].tcd == NULL) return -1;
+
+    // Backward shift deletion: move following slots of the probe chain
+    // to the freed position so lookups never need tombstones
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & idx->mask;
+        if (idx->slots[j].tcd == NULL) break;
+        size_t home = (size_t)idx->slots[j].hash & idx->mask;
+        if (((j - home) & idx->mask) >= ((j - i) & idx->mask)) {
+            idx->slots[i] = idx->slots[j];
+            i = j;
+        }
+    }
+    memset(&idx->slots[i], 0, sizeof(idx->slots[i]));
+    idx->size--;
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_channel_index.h
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Created on October 17, 2026, 10:12 AM
+ */
+
+#ifndef TRUDP_CHANNEL_INDEX_H
+#define TRUDP_CHANNEL_INDEX_H
+
+#include "teobase/types.h"
+
+#include "trudp_api.h"
+#include "udp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Forward declare trudpChannelData to use it in trudpChannelIndex.
+struct trudpChannelData;
+
+/**
+ * Binary channel key: (family, address, port, channel) tuple
+ */
+typedef struct trudpChannelKey {
+
+    uint16_t family;    ///< Address family (AF_INET or AF_INET6)
+    uint16_t port;      ///< Port in network byte order
+    uint32_t channel;   ///< TR-UDP channel number
+    uint32_t scope_id;  ///< IPv6 scope id (zero for IPv4)
+    uint32_t reserved;  ///< Always zero
+    uint8_t addr[16];   ///< IPv4 (first 4 bytes) or IPv6 address
+
+} trudpChannelKey;
+
+/**
+ * Channel index slot
+ */
+typedef struct trudpChannelIndexSlot {
+
+    uint64_t hash;                 ///< Hash of the key
+    trudpChannelKey key;           ///< Channel key
+    struct trudpChannelData *tcd;  ///< Pointer to channel or NULL if empty
+
+} trudpChannelIndexSlot;
+
+/**
+ * Channel index: open addressing hash table keyed by trudpChannelKey
+ */
+typedef struct trudpChannelIndex {
+
+    trudpChannelIndexSlot *slots; ///< Slots array, size is power of two
+    size_t mask;                  ///< Number of slots minus one
+    size_t size;                  ///< Number of channels in index
+    uint64_t k0;                  ///< Hash key (first half)
+    uint64_t k1;                  ///< Hash key (second half)
+
+} trudpChannelIndex;
+
+int trudpChannelKeyMake(trudpChannelKey *key, __CONST_SOCKADDR_ARG addr,
+        socklen_t addr_len, int channel);
+
+trudpChannelIndex *trudpChannelIndexNew(size_t size);
+void trudpChannelIndexDestroy(trudpChannelIndex *idx);
+size_t trudpChannelIndexSize(trudpChannelIndex *idx);
+struct trudpChannelData *trudpChannelIndexGet(trudpChannelIndex *idx,
+        const trudpChannelKey *key);
+int trudpChannelIndexAdd(trudpChannelIndex *idx, const trudpChannelKey *key,
+        struct trudpChannelData *tcd);
+int trudpChannelIndexDelete(trudpChannelIndex *idx, const trudpChannelKey *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRUDP_CHANNEL_INDEX_H */
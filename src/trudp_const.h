@@ -39,15 +39,29 @@ extern "C" {
 // TR-UDP constants
 #define MAX_KEY_LENGTH 64 // Maximum key length
 #define MAX_OUTRUNNING 500 // Maximum outrunning in receive queue to send reset
-#define START_MIDDLE_TIME (MAX_ACK_WAIT/5) * 1000000 // Midle time at start
 #define MAX_TRIPTIME_MIDDLE 5757575/2 // Maximum number of Middle triptime
 #define MAX_LAST_RECEIVE MAX_TRIPTIME_MIDDLE*5 // Disconnect after last receved packet time older than this constant (14.39 sec)
 #define KEEPALIVE_PING_DELAY (10*1000000) // Send trudp ping every 10 sec
 #define MAP_SIZE_DEFAULT 107 // Default map size; map stored connected channels and can auto resize
-#define RTT 30000 // This constant used in send queue expected time calculation
-#define MAX_RTT 500000 // This constant used in send queue expected time calculation
+#define RTT 30000 // Default minimum retransmit timeout (usec)
+#define MAX_RTT 500000 // Default maximum retransmit timeout (usec)
+#define INITIAL_RTO 130000 // Retransmit timeout before first round trip time measurement (usec)
+#define TLP_MIN_TIMEOUT 10000 // Minimum tail loss probe timeout (usec)
 #define RESET_AT_LONG_RETRANSMIT 0 // Send rest at long retransmit retrives time
 #define NORMAL_S_SIZE 40 //48 // Normal size of send queue
+#define PACING_BURST_SIZE 3000 // Send pacing token bucket size (bytes)
+#define WRITE_QUEUE_QUANTUM 4107 // Default write queue scheduler quantum (bytes, not less than maximum packet length)
+#define WRITE_QUEUE_PRIORITIES 8 // Number of write queue scheduler priority classes (0 is the highest)
+#define CHANNEL_NUMBERS 16 // Number of TR-UDP channel numbers of one address (4 bit header field)
+#define RECV_BATCH_MAX_SIZE 64 // Maximum number of datagrams received in one batch
+#define RECV_BATCH_BUFFER_SIZE 4096 // Receive buffer size of one datagram in batch
+#define RECV_BATCH_GRO_SIZE 16 // Maximum number of datagrams received in one batch with UDP GRO
+#define RECV_BATCH_GRO_BUFFER_SIZE 65536 // Receive buffer size of one datagram coalesced by UDP GRO
+#define SHARD_POLL_TIMEOUT 100000 // Shard worker thread maximum wait time (usec)
+#define SHARD_RECV_BATCHES 16 // Maximum number of receive batches per shard loop
+#define SHARD_SEND_BATCH_SIZE 64 // Shard egress batch size
+#define SHARD_SEND_BATCH_DELAY 1000 // Shard egress batch maximum delay (usec)
+#define SHARD_SUBMIT_QUEUE_SIZE 4096 // Shard submit queue size (messages sent by other threads)
 
 /// Sequential packetId limit wraps like 1,2,3,...,PACKET_ID_LIMIT-1,1,2,...
 /// we avoiding zero value as it used at connection init
@@ -0,0 +1,183 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_group.c
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Peer groups: named sets of channels to send the same data to.
+ *
+ * Created on October 18, 2026, 2:10 AM
+ */
+
+#include <string.h>
+
+#include "trudp_group.h"
+
+#include "trudp.h"
+
+// Local functions
+static trudpChannelIndex *_trudpGroupGet(trudpData *td, const char *name);
+
+/**
+ * Get group members index
+ *
+ * @param td Pointer to trudpData
+ * @param name Group name
+ *
+ * @return Pointer to trudpChannelIndex of group members or NULL if group
+ *         does not exist
+ */
+static trudpChannelIndex *_trudpGroupGet(trudpData *td, const char *name) {
+
+    if (td->groups == NULL) return NULL;
+
+    size_t data_len;
+    uint8_t *data = teoMapGet(td->groups, (uint8_t *)name, strlen(name) + 1,
+            &data_len);
+    if (data == (uint8_t *)-1) return NULL;
+    return *((trudpChannelIndex **)data);
+}
+
+/**
+ * Add channel to group (create group if it does not exist). Group keeps
+ * channel key, so destroyed channel is skipped by trudpSendDataToGroup and
+ * new channel with the same address and channel number becomes the member
+ *
+ * @param td Pointer to trudpData
+ * @param name Group name
+ * @param tcd Pointer to trudpChannelData
+ *
+ * @return Zero at success
+ */
+int trudpGroupAdd(trudpData *td, const char *name, trudpChannelData *tcd) {
+
+    trudpChannelIndex *members = _trudpGroupGet(td, name);
+    if (members == NULL) {
+        if (td->groups == NULL) td->groups = teoMapNew(MAP_SIZE_DEFAULT, 1);
+        members = trudpChannelIndexNew(MAP_SIZE_DEFAULT);
+        teoMapAdd(td->groups, (uint8_t *)name, strlen(name) + 1,
+                (uint8_t *)&members, sizeof(members));
+    }
+
+    return trudpChannelIndexAdd(members, &tcd->key, tcd);
+}
+
+/**
+ * Remove channel from group
+ *
+ * @param td Pointer to trudpData
+ * @param name Group name
+ * @param tcd Pointer to trudpChannelData
+ *
+ * @return Zero at success or -1 if channel is not in group
+ */
+int trudpGroupRemove(trudpData *td, const char *name, trudpChannelData *tcd) {
+
+    trudpChannelIndex *members = _trudpGroupGet(td, name);
+    if (members == NULL) return -1;
+
+    return trudpChannelIndexDelete(members, &tcd->key);
+}
+
+/**
+ * Destroy group
+ *
+ * @param td Pointer to trudpData
+ * @param name Group name
+ */
+void trudpGroupDestroy(trudpData *td, const char *name) {
+
+    trudpChannelIndex *members = _trudpGroupGet(td, name);
+    if (members == NULL) return;
+
+    teoMapDelete(td->groups, (uint8_t *)name, strlen(name) + 1);
+    trudpChannelIndexDestroy(members);
+}
+
+/**
+ * Destroy all groups
+ *
+ * @param td Pointer to trudpData
+ */
+void trudpGroupDestroyAll(trudpData *td) {
+
+    if (td->groups == NULL) return;
+
+    teoMapElementData *el;
+    teoMapIterator it;
+    teoMapIteratorReset(&it, td->groups);
+    while((el = teoMapIteratorNext(&it))) {
+        trudpChannelIndexDestroy(
+                *((trudpChannelIndex **)teoMapIteratorElementData(el, NULL)));
+    }
+    teoMapDestroy(td->groups);
+    td->groups = NULL;
+}
+
+/**
+ * Get number of group members
+ *
+ * @param td Pointer to trudpData
+ * @param name Group name
+ *
+ * @return Number of channels in group (zero if group does not exist)
+ */
+size_t trudpGroupSize(trudpData *td, const char *name) {
+
+    trudpChannelIndex *members = _trudpGroupGet(td, name);
+    return members ? trudpChannelIndexSize(members) : 0;
+}
+
+/**
+ * Send the same data to connected channels of group. Data is copied once to
+ * shared payload, packets of all channels keep their headers only
+ *
+ * @param td Pointer to trudpData
+ * @param name Group name
+ * @param data Pointer to data
+ * @param data_length Data length
+ *
+ * @return Number of channels the data was sent to
+ */
+size_t trudpSendDataToGroup(trudpData *td, const char *name, void *data,
+        size_t data_length) {
+
+    trudpChannelIndex *members = _trudpGroupGet(td, name);
+    if (members == NULL || data_length > TRUDP_MAX_DATA_LENGTH) return 0;
+
+    size_t rv = 0, i;
+    trudpPayload *payload = trudpPayloadNew(data, data_length);
+    for (i = 0; i <= members->mask; i++) {
+        if (members->slots[i].tcd == NULL) continue;
+        // Member channel may be destroyed, find it by key
+        trudpChannelData *tcd =
+                trudpChannelIndexGet(td->idx, &members->slots[i].key);
+        if(!tcd || !tcd->connected_f) continue;
+        size_t sent = trudpChannelSendPayload(tcd, payload);
+        if(sent && sent != TRUDP_SEND_WOULD_BLOCK) rv++;
+    }
+    trudpPayloadRelease(payload);
+    trudpSendBatchFlush(td);
+
+    return rv;
+}
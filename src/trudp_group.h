@@ -0,0 +1,59 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_group.h
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Created on October 18, 2026, 2:10 AM
+ */
+
+#ifndef TRUDP_GROUP_H
+#define TRUDP_GROUP_H
+
+#include <stdlib.h>
+
+#include "trudp_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Forward declare trudpData and trudpChannelData to use it in group functions.
+struct trudpData;
+struct trudpChannelData;
+
+TRUDP_API int trudpGroupAdd(struct trudpData *td, const char *name,
+        struct trudpChannelData *tcd);
+TRUDP_API int trudpGroupRemove(struct trudpData *td, const char *name,
+        struct trudpChannelData *tcd);
+TRUDP_API void trudpGroupDestroy(struct trudpData *td, const char *name);
+TRUDP_API size_t trudpGroupSize(struct trudpData *td, const char *name);
+TRUDP_API size_t trudpSendDataToGroup(struct trudpData *td, const char *name,
+        void *data, size_t data_length);
+void trudpGroupDestroyAll(struct trudpData *td);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRUDP_GROUP_H */
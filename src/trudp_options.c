@@ -94,6 +94,53 @@ void trudpSetOption_CORE_disconnectTimeoutDelayMs(int64_t timeout_ms) {
              trudpOpt_CORE_disconnectTimeoutDelay_us / 1000000.0f);
 }
 
+// Retransmit timeout limits
+enum {
+    minRetransmitTimeoutDefault_us = RTT,
+    maxRetransmitTimeoutDefault_us = MAX_RTT,
+};
+
+extern int64_t trudpOpt_CORE_minRetransmitTimeout_us;
+int64_t trudpOpt_CORE_minRetransmitTimeout_us = minRetransmitTimeoutDefault_us;
+
+void trudpSetOption_CORE_minRetransmitTimeoutMs(int64_t timeout_ms) {
+    if (timeout_ms < 0) {
+        LTRACK_E("Trudp", "Retransmit timeout argument must be non-negative");
+        abort();
+    }
+
+    trudpOpt_CORE_minRetransmitTimeout_us =
+        (timeout_ms == 0) ? minRetransmitTimeoutDefault_us : timeout_ms * 1000;
+
+    LTRACK_I("Trudp", "Changed minimum retransmit timeout to %fsec",
+             trudpOpt_CORE_minRetransmitTimeout_us / 1000000.0f);
+}
+
+extern int64_t trudpOpt_CORE_maxRetransmitTimeout_us;
+int64_t trudpOpt_CORE_maxRetransmitTimeout_us = maxRetransmitTimeoutDefault_us;
+
+void trudpSetOption_CORE_maxRetransmitTimeoutMs(int64_t timeout_ms) {
+    if (timeout_ms < 0) {
+        LTRACK_E("Trudp", "Retransmit timeout argument must be non-negative");
+        abort();
+    }
+
+    trudpOpt_CORE_maxRetransmitTimeout_us =
+        (timeout_ms == 0) ? maxRetransmitTimeoutDefault_us : timeout_ms * 1000;
+
+    LTRACK_I("Trudp", "Changed maximum retransmit timeout to %fsec",
+             trudpOpt_CORE_maxRetransmitTimeout_us / 1000000.0f);
+}
+
+extern bool trudpOpt_CORE_selectiveAck;
+bool trudpOpt_CORE_selectiveAck = true;
+
+void trudpSetOption_CORE_selectiveAck(bool enable) {
+    trudpOpt_CORE_selectiveAck = enable;
+    LTRACK_I("Trudp", "Set selective acknowledgements to %s",
+             trudpOpt_CORE_selectiveAck ? "enabled" : "disabled");
+}
+
 extern bool trudpOpt_DBG_dumpUdpData;
 bool trudpOpt_DBG_dumpUdpData = false;
 
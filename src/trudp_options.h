@@ -63,6 +63,37 @@ TRUDP_API void trudpSetOption_CORE_keepaliveNextPingDelayMs(int64_t delay);
  */
 TRUDP_API void trudpSetOption_CORE_disconnectTimeoutDelayMs(int64_t timeout_ms);
 
+/**
+ * Set core trudp minimum retransmit timeout: retransmit timeout is smoothed
+ * round trip time plus four round trip time variations, but not less than
+ * smoothed round trip time plus this value
+ * by default 30 milliseconds
+ *
+ * @param timeout_ms - milliseconds, must be non-negative, zero value sets to
+ * default
+ */
+TRUDP_API void trudpSetOption_CORE_minRetransmitTimeoutMs(int64_t timeout_ms);
+
+/**
+ * Set core trudp maximum retransmit timeout: retransmit timeout is doubled at
+ * every retransmit up to this value
+ * by default 500 milliseconds
+ *
+ * @param timeout_ms - milliseconds, must be non-negative, zero value sets to
+ * default
+ */
+TRUDP_API void trudpSetOption_CORE_maxRetransmitTimeoutMs(int64_t timeout_ms);
+
+/**
+ * Enable selective acknowledgements: ACK to DATA packet carries receiver
+ * expected id and ranges of received packets, so sender releases all
+ * received packets and retransmits not received ones at once
+ * by default enabled
+ *
+ * @param enable - boolean
+ */
+TRUDP_API void trudpSetOption_CORE_selectiveAck(bool enable);
+
 /**
  * Enable dumping of received and sent packets.
  *
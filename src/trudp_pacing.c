@@ -0,0 +1,113 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ * \file   trudp_pacing.c
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Send pacing token bucket: channels and trudpData use it to spread packets
+ * in time instead of sending them back to back (trudpSetPacing).
+ *
+ * Created on October 17, 2026, 11:40 PM
+ */
+
+#include "trudp_pacing.h"
+
+// Local functions
+static void _trudpTokenBucketFill(trudpTokenBucket *tb, uint64_t ts);
+
+/**
+ * Initialize token bucket, bucket is full after initialization
+ *
+ * @param tb Pointer to trudpTokenBucket
+ * @param rate Fill rate (bytes per second), zero if not limited
+ * @param size Bucket size (bytes)
+ */
+void trudpTokenBucketInit(trudpTokenBucket *tb, uint64_t rate, size_t size) {
+
+    tb->rate = rate;
+    tb->size = size;
+    tb->tokens = size;
+    tb->last = 0;
+}
+
+/**
+ * Fill bucket with tokens for time passed since last fill
+ *
+ * @param tb Pointer to trudpTokenBucket
+ * @param ts Current time (usec)
+ */
+static void _trudpTokenBucketFill(trudpTokenBucket *tb, uint64_t ts) {
+
+    if (ts > tb->last) {
+        if (!tb->last || !tb->rate) tb->tokens = tb->size;
+        else tb->tokens += (double)(ts - tb->last) * tb->rate / 1000000.0;
+        if (tb->tokens > tb->size) tb->tokens = tb->size;
+        tb->last = ts;
+    }
+}
+
+/**
+ * Set token bucket fill rate. Tokens for time passed before the call are
+ * added with previous rate
+ *
+ * @param tb Pointer to trudpTokenBucket
+ * @param rate Fill rate (bytes per second), zero if not limited
+ * @param ts Current time (usec)
+ */
+void trudpTokenBucketSetRate(trudpTokenBucket *tb, uint64_t rate,
+        uint64_t ts) {
+
+    if (tb->rate == rate) return;
+    _trudpTokenBucketFill(tb, ts);
+    tb->rate = rate;
+}
+
+/**
+ * Get time when next packet may be sent
+ *
+ * @param tb Pointer to trudpTokenBucket
+ * @param ts Current time (usec)
+ *
+ * @return Time when bucket has tokens (usec), ts if packet may be sent now
+ */
+uint64_t trudpTokenBucketGetTime(trudpTokenBucket *tb, uint64_t ts) {
+
+    _trudpTokenBucketFill(tb, ts);
+    if (!tb->rate || tb->tokens >= 0) return ts;
+
+    return ts + (uint64_t)(-tb->tokens * 1000000.0 / tb->rate) + 1;
+}
+
+/**
+ * Take sent packet length from bucket
+ *
+ * @param tb Pointer to trudpTokenBucket
+ * @param bytes Packet length
+ * @param ts Current time (usec)
+ */
+void trudpTokenBucketConsume(trudpTokenBucket *tb, size_t bytes, uint64_t ts) {
+
+    _trudpTokenBucketFill(tb, ts);
+    if (tb->rate) tb->tokens -= bytes;
+}
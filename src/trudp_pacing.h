@@ -0,0 +1,67 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ *
+ * \file   trudp_pacing.h
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Created on October 17, 2026, 11:40 PM
+ */
+
+#ifndef TRUDP_PACING_H
+#define TRUDP_PACING_H
+
+#include <stdlib.h>
+
+#include "teobase/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Token bucket: bucket is filled with rate bytes per second up to its size,
+ * sent packet takes its length from bucket. Token count may become negative
+ * (packet larger than available tokens is sent), next packet waits until it
+ * is positive again
+ */
+typedef struct trudpTokenBucket {
+
+    uint64_t rate;  ///< Fill rate (bytes per second), zero if not limited
+    size_t size;    ///< Bucket size (bytes)
+    double tokens;  ///< Available bytes
+    uint64_t last;  ///< Last fill time (usec)
+
+} trudpTokenBucket;
+
+void trudpTokenBucketInit(trudpTokenBucket *tb, uint64_t rate, size_t size);
+void trudpTokenBucketSetRate(trudpTokenBucket *tb, uint64_t rate,
+        uint64_t ts);
+uint64_t trudpTokenBucketGetTime(trudpTokenBucket *tb, uint64_t ts);
+void trudpTokenBucketConsume(trudpTokenBucket *tb, size_t bytes, uint64_t ts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRUDP_PACING_H */
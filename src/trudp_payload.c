@@ -0,0 +1,77 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_payload.c
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Reference counted packet payload.
+ *
+ * Created on October 18, 2026, 0:40 AM
+ */
+
+#include <string.h>
+
+#include "trudp_payload.h"
+
+#include "teoccl/memory.h"
+
+/**
+ * Create payload with copy of data
+ *
+ * @param data Pointer to data
+ * @param length Data length
+ *
+ * @return Pointer to trudpPayload with one reference, release it with
+ *         trudpPayloadRelease
+ */
+trudpPayload *trudpPayloadNew(const void *data, size_t length) {
+
+    trudpPayload *payload = (trudpPayload *)ccl_malloc(
+            sizeof(trudpPayload) + length);
+    payload->refs = 1;
+    payload->length = length;
+    if (length) memcpy(payload->data, data, length);
+
+    return payload;
+}
+
+/**
+ * Add payload reference
+ *
+ * @param payload Pointer to trudpPayload
+ *
+ * @return Pointer to trudpPayload
+ */
+trudpPayload *trudpPayloadRef(trudpPayload *payload) {
+    payload->refs++;
+    return payload;
+}
+
+/**
+ * Release payload reference, the last one frees the payload
+ *
+ * @param payload Pointer to trudpPayload or NULL
+ */
+void trudpPayloadRelease(trudpPayload *payload) {
+    if (payload && !--payload->refs) free(payload);
+}
@@ -0,0 +1,65 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_payload.h
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Created on October 18, 2026, 0:40 AM
+ */
+
+#ifndef TRUDP_PAYLOAD_H
+#define TRUDP_PAYLOAD_H
+
+#include <stdlib.h>
+
+#include "teobase/types.h"
+
+#include "trudp_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Reference counted packet payload shared by packets of many channels. Only
+ * packet header is kept per channel, the payload is sent after it by scatter
+ * gather I/O. Payload is not thread safe: it should be used with one
+ * trudpData
+ */
+typedef struct trudpPayload {
+
+    size_t refs;    ///< Number of references
+    size_t length;  ///< Data length
+    char data[];    ///< Data
+
+} trudpPayload;
+
+TRUDP_API trudpPayload *trudpPayloadNew(const void *data, size_t length);
+TRUDP_API trudpPayload *trudpPayloadRef(trudpPayload *payload);
+TRUDP_API void trudpPayloadRelease(trudpPayload *payload);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRUDP_PAYLOAD_H */
@@ -0,0 +1,177 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_peer.c
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Peer: channels of one remote address sharing congestion state.
+ *
+ * Created on October 17, 2026, 11:55 PM
+ */
+
+#include <stddef.h>
+
+#include "trudp_peer.h"
+
+#include "teoccl/memory.h"
+
+#include "trudp.h"
+
+/**
+ * Get channel by its node in peer channels list
+ *
+ * @param node Pointer to trudpChannelData.peer_node
+ *
+ * @return Pointer to trudpChannelData
+ */
+static inline trudpChannelData *_trudpPeerChannel(trudpTimerWheelNode *node) {
+    return (trudpChannelData *)((char *)node -
+            offsetof(trudpChannelData, peer_node));
+}
+
+/**
+ * Add channel to peer of channels with the same remote address (create
+ * peer if channel is the first one). New peer takes congestion controller
+ * state of the channel
+ *
+ * @param tcd Pointer to trudpChannelData
+ */
+void trudpPeerAttach(trudpChannelData *tcd) {
+
+    if (tcd->peer) return;
+
+    // Find peer of other channel number of this address
+    trudpPeer *peer = NULL;
+    trudpChannelKey key = tcd->key;
+    uint32_t channel;
+    for(channel = 0; channel < CHANNEL_NUMBERS && peer == NULL; channel++) {
+        if (channel == tcd->key.channel) continue;
+        key.channel = channel;
+        trudpChannelData *sibling = trudpChannelIndexGet(tcd->td->idx, &key);
+        if (sibling) peer = sibling->peer;
+    }
+
+    if (peer == NULL) {
+        peer = (trudpPeer *)ccl_malloc(sizeof(trudpPeer));
+        peer->channels_num = 0;
+        trudpTimerWheelListInit(&peer->channels);
+        peer->cc = tcd->cc;
+        peer->recovery_tcd = NULL;
+    }
+
+    tcd->peer = peer;
+    peer->channels_num++;
+    trudpPeerMoveLast(tcd);
+}
+
+/**
+ * Remove channel from its peer, the last channel frees the peer. Channel
+ * continues with its own congestion controller
+ *
+ * @param tcd Pointer to trudpChannelData
+ */
+void trudpPeerDetach(trudpChannelData *tcd) {
+
+    trudpPeer *peer = tcd->peer;
+    if (peer == NULL) return;
+
+    trudpPeerEndRecovery(tcd);
+    trudpTimerWheelRemove(&tcd->peer_node);
+    tcd->peer = NULL;
+    if (!--peer->channels_num) free(peer);
+}
+
+/**
+ * Move channel to the end of peer channels with its priority. Used when
+ * channel priority is changed and to rotate channels of the same priority
+ *
+ * @param tcd Pointer to trudpChannelData
+ */
+void trudpPeerMoveLast(trudpChannelData *tcd) {
+
+    trudpPeer *peer = tcd->peer;
+    if (peer == NULL) return;
+
+    trudpTimerWheelRemove(&tcd->peer_node);
+    trudpTimerWheelNode *node;
+    for(node = peer->channels.next; node != &peer->channels;
+            node = node->next) {
+        if (_trudpPeerChannel(node)->priority > tcd->priority) break;
+    }
+    // Adding to the end of list started at node inserts before node
+    trudpTimerWheelListAdd(node, &tcd->peer_node, 0);
+}
+
+/**
+ * End peer congestion controller loss recovery started by channel. Recovery
+ * end is checked by channel packet id, so it ends when the channel send queue
+ * is cleared or the channel leaves the peer
+ *
+ * @param tcd Pointer to trudpChannelData
+ */
+void trudpPeerEndRecovery(trudpChannelData *tcd) {
+
+    trudpPeer *peer = tcd->peer;
+    if (peer == NULL || peer->recovery_tcd != tcd) return;
+
+    peer->cc.in_recovery = 0;
+    peer->recovery_tcd = NULL;
+}
+
+/**
+ * Get number of packets in send queues of all peer channels
+ *
+ * @param peer Pointer to trudpPeer
+ *
+ * @return Number of packets
+ */
+size_t trudpPeerSendQueueSize(trudpPeer *peer) {
+
+    size_t size = 0;
+    trudpTimerWheelNode *node;
+    for(node = peer->channels.next; node != &peer->channels;
+            node = node->next) {
+        size += trudpSendQueueSize(_trudpPeerChannel(node)->sendQueue);
+    }
+
+    return size;
+}
+
+/**
+ * Get peer channel with the highest priority which write queue is not empty
+ *
+ * @param peer Pointer to trudpPeer
+ *
+ * @return Pointer to trudpChannelData or NULL if all write queues are empty
+ */
+trudpChannelData *trudpPeerGetWriteChannel(trudpPeer *peer) {
+
+    trudpTimerWheelNode *node;
+    for(node = peer->channels.next; node != &peer->channels;
+            node = node->next) {
+        trudpChannelData *tcd = _trudpPeerChannel(node);
+        if (trudpWriteQueueSize(tcd->writeQueue)) return tcd;
+    }
+
+    return NULL;
+}
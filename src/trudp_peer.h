@@ -0,0 +1,73 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_peer.h
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Created on October 17, 2026, 11:55 PM
+ */
+
+#ifndef TRUDP_PEER_H
+#define TRUDP_PEER_H
+
+#include <stdlib.h>
+
+#include "teobase/types.h"
+
+#include "trudp_cc.h"
+#include "trudp_timer_wheel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Forward declare trudpChannelData to use it in trudpPeer.
+struct trudpChannelData;
+
+/**
+ * Peer: TR-UDP channels with the same remote address and different channel
+ * numbers. Peer channels share one congestion controller, their send queues
+ * sum is limited by its window, and their write queues are sent in priority
+ * order
+ */
+typedef struct trudpPeer {
+
+    size_t channels_num;          ///< Number of peer channels
+    trudpTimerWheelNode channels; ///< Peer channels list in priority order
+    trudpCc cc;                   ///< Congestion controller of peer channels
+    struct trudpChannelData *recovery_tcd; ///< Channel which packet loss started congestion controller recovery
+
+} trudpPeer;
+
+void trudpPeerAttach(struct trudpChannelData *tcd);
+void trudpPeerDetach(struct trudpChannelData *tcd);
+void trudpPeerMoveLast(struct trudpChannelData *tcd);
+void trudpPeerEndRecovery(struct trudpChannelData *tcd);
+size_t trudpPeerSendQueueSize(trudpPeer *peer);
+struct trudpChannelData *trudpPeerGetWriteChannel(trudpPeer *peer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRUDP_PEER_H */
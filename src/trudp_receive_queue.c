@@ -29,14 +29,21 @@
 
 #include "trudp_receive_queue.h"
 
+#include <string.h>
+
+#include "teoccl/memory.h"
+
+#define SLOT(id) ((id) & (RECEIVE_QUEUE_SIZE - 1))
+#define BIT_IS_SET(rq, i) (((rq)->bitmap[(i) / 64] >> ((i) % 64)) & 1)
+
 /**
  * Create new Receive queue
  *
- * @return Pointer to trudpPacketQueue
+ * @return Pointer to trudpReceiveQueue
  */
 
 trudpReceiveQueue *trudpReceiveQueueNew() {
-    return trudpPacketQueueNew();
+    return (trudpReceiveQueue *)ccl_calloc(sizeof(trudpReceiveQueue));
 }
 
 /**
@@ -46,7 +53,10 @@ trudpReceiveQueue *trudpReceiveQueueNew() {
  */
 
 void trudpReceiveQueueDestroy(trudpReceiveQueue *rq) {
-    trudpPacketQueueDestroy((trudpPacketQueue *)rq);
+    if (rq) {
+        trudpReceiveQueueFree(rq);
+        free(rq);
+    }
 }
 
 /**
@@ -57,7 +67,17 @@ void trudpReceiveQueueDestroy(trudpReceiveQueue *rq) {
  */
 
 int trudpReceiveQueueFree(trudpReceiveQueue *rq) {
-    return trudpPacketQueueFree(rq);
+
+    if (rq->slots) {
+        size_t i;
+        for (i = 0; i < RECEIVE_QUEUE_SIZE; i++) free(rq->slots[i].packet);
+        free(rq->slots);
+        rq->slots = NULL;
+    }
+    memset(rq->bitmap, 0, sizeof(rq->bitmap));
+    rq->size = 0;
+
+    return 0;
 }
 
 /**
@@ -68,24 +88,44 @@ int trudpReceiveQueueFree(trudpReceiveQueue *rq) {
  * @return Number of elements in TR-UPD send queue
  */
 
-size_t trudpReceiveQueueSize(trudpReceiveQueue *sq) {
-    return trudpPacketQueueSize(sq);
+size_t trudpReceiveQueueSize(trudpReceiveQueue *rq) {
+    return rq->size;
 }
 
 /**
- * Add packet to Receive queue
+ * Add packet to Receive queue. Caller checks that packet id is inside
+ * receive window (less than RECEIVE_QUEUE_SIZE ahead of expected id)
  *
  * @param sq Pointer to trudpReceiveQueue
  * @param packet Packet to add to queue
  * @param packet_length Packet length
- * @param expected_time Packet expected time
  *
  * @return Pointer to added trudpReceiveQueueData
  */
 
-trudpReceiveQueueData *trudpReceiveQueueAdd(trudpReceiveQueue *sq, void *packet,
-        size_t packet_length, uint64_t expected_time) {
-    return trudpPacketQueueAdd(sq, packet, packet_length, expected_time);
+trudpReceiveQueueData *trudpReceiveQueueAdd(trudpReceiveQueue *rq,
+        void *packet, size_t packet_length) {
+
+    if (rq->slots == NULL) {
+        rq->slots = (trudpReceiveQueueData *)ccl_calloc(
+                RECEIVE_QUEUE_SIZE * sizeof(trudpReceiveQueueData));
+    }
+
+    uint32_t i = SLOT(trudpPacketGetId((trudpPacket *)packet));
+    trudpReceiveQueueData *rqd = &rq->slots[i];
+    if (rqd->packet_size < packet_length) {
+        rqd->packet = (char *)ccl_realloc(rqd->packet, packet_length);
+        rqd->packet_size = (uint32_t)packet_length;
+    }
+    memcpy(rqd->packet, packet, packet_length);
+    rqd->packet_length = (uint32_t)packet_length;
+
+    if (!BIT_IS_SET(rq, i)) {
+        rq->bitmap[i / 64] |= (uint64_t)1 << (i % 64);
+        rq->size++;
+    }
+
+    return rqd;
 }
 
 /**
@@ -97,9 +137,25 @@ trudpReceiveQueueData *trudpReceiveQueueAdd(trudpReceiveQueue *sq, void *packet,
  * @return Zero at success
  */
 
-int trudpReceiveQueueDelete(trudpReceiveQueue *tq,
-        trudpReceiveQueueData *tqd) {
-    return trudpPacketQueueDelete(tq, tqd);
+int trudpReceiveQueueDelete(trudpReceiveQueue *rq,
+        trudpReceiveQueueData *rqd) {
+
+    if (rq->slots == NULL || rqd == NULL) return -1;
+
+    uint32_t i = (uint32_t)(rqd - rq->slots);
+    if (!BIT_IS_SET(rq, i)) return -1;
+
+    // Packet buffer stays in the slot and is reused by next packets, large
+    // buffers are freed to limit memory kept by receive window
+    rq->bitmap[i / 64] &= ~((uint64_t)1 << (i % 64));
+    rq->size--;
+    if (rqd->packet_size > RECEIVE_QUEUE_BUFFER_SIZE) {
+        free(rqd->packet);
+        rqd->packet = NULL;
+        rqd->packet_size = 0;
+    }
+
+    return 0;
 }
 
 /**
@@ -111,7 +167,44 @@ int trudpReceiveQueueDelete(trudpReceiveQueue *tq,
  * @return Pointer to trudpReceiveQueueData or NULL if not found
  */
 
-trudpReceiveQueueData *trudpReceiveQueueFindById(trudpReceiveQueue *sq,
+trudpReceiveQueueData *trudpReceiveQueueFindById(trudpReceiveQueue *rq,
         uint32_t id) {
-    return trudpPacketQueueFindById(sq, id);
+
+    uint32_t i = SLOT(id);
+    if (!BIT_IS_SET(rq, i)) return NULL;
+
+    trudpReceiveQueueData *rqd = &rq->slots[i];
+    return trudpPacketGetId((trudpPacket *)rqd->packet) == id ? rqd : NULL;
+}
+
+/**
+ * Find first packet in Receive queue with id starting from id in receive
+ * window order
+ *
+ * @param rq Pointer to trudpReceiveQueue
+ * @param id [in,out] Id to start search from, returns id of found packet
+ *
+ * @return Pointer to trudpReceiveQueueData or NULL if not found
+ */
+
+trudpReceiveQueueData *trudpReceiveQueueFindNext(trudpReceiveQueue *rq,
+        uint32_t *id) {
+
+    uint32_t i = SLOT(*id), n = 0;
+    while (n < RECEIVE_QUEUE_SIZE) {
+        // Skip empty bitmap words
+        if (!(rq->bitmap[i / 64] >> (i % 64))) {
+            n += 64 - i % 64;
+            i = SLOT(i + 64 - i % 64);
+            continue;
+        }
+        if (BIT_IS_SET(rq, i)) {
+            *id = trudpPacketGetId((trudpPacket *)rq->slots[i].packet);
+            return &rq->slots[i];
+        }
+        n++;
+        i = SLOT(i + 1);
+    }
+
+    return NULL;
 }
@@ -33,88 +33,66 @@
 
 #include <stdlib.h>
 
-#include "packet_queue.h"
+#include "teobase/types.h"
 
-/**
- * Receive queue type
- */
-typedef trudpPacketQueue trudpReceiveQueue;
+#include "packet.h"
 
 /**
- * Receive queue data type
+ * Receive window size (number of packets which may be received before
+ * expected one), power of two
  */
-typedef trudpPacketQueueData trudpReceiveQueueData;
-
-#ifdef __cplusplus
-extern "C" {
-#endif
+#define RECEIVE_QUEUE_SIZE 512
 
 /**
- * Create new Receive queue
- *
- * @return Pointer to trudpPacketQueue
+ * Maximum size of packet buffer kept in free slot for next packets
  */
+#define RECEIVE_QUEUE_BUFFER_SIZE 1024
 
-trudpReceiveQueue *trudpReceiveQueueNew();
 /**
- * Destroy Receive queue
- *
- * @param rq Pointer to trudpReceiveQueue
+ * Receive queue data type: one slot of receive window
  */
+typedef struct trudpReceiveQueueData {
 
-void trudpReceiveQueueDestroy(trudpReceiveQueue *rq);
-/**
- * Remove all elements from Receive queue
- *
- * @param rq Pointer to Receive Queue (trudpReceiveQueue)
- * @return Zero at success
- */
+    uint32_t packet_length; ///< Packet length
+    uint32_t packet_size;   ///< Size of allocated packet buffer
+    char *packet;           ///< Packet buffer (reused by next packets)
 
-int trudpReceiveQueueFree(trudpReceiveQueue *rq);
-/**
- * Get number of elements in Receive queue
- *
- * @param sq Pointer to trudpReceiveQueue
- *
- * @return Number of elements in TR-UPD send queue
- */
+} trudpReceiveQueueData;
 
-size_t trudpReceiveQueueSize(trudpReceiveQueue *sq);
 /**
- * Add packet to Receive queue
- *
- * @param sq Pointer to trudpReceiveQueue
- * @param packet Packet to add to queue
- * @param packet_length Packet length
- * @param expected_time Packet expected time
- *
- * @return Pointer to added trudpReceiveQueueData
+ * Receive queue type: reorder window of outrunning packets. Packet is stored
+ * in slot (id % RECEIVE_QUEUE_SIZE) and marked in presence bitmap
  */
+typedef struct trudpReceiveQueue {
 
-trudpReceiveQueueData *trudpReceiveQueueAdd(trudpReceiveQueue *sq, void *packet,
-        size_t packet_length, uint64_t expected_time);
-/**
- * Remove element from Receive queue
- *
- * @param tq Pointer to trudpReceiveQueue
- * @param tqd Pointer to trudpReceiveQueueData to delete it
- *
- * @return Zero at success
- */
+    trudpReceiveQueueData *slots; ///< Slots, allocated at first add
+    uint64_t bitmap[RECEIVE_QUEUE_SIZE / 64]; ///< Presence bitmap
+    size_t size; ///< Number of packets in queue
 
-int trudpReceiveQueueDelete(trudpReceiveQueue *tq,
-        trudpReceiveQueueData *tqd);
-/**
- * Find Receive queue data by Id
- *
- * @param sq Pointer to trudpReceiveQueue
- * @param id Id to find in send queue
- *
- * @return Pointer to trudpReceiveQueueData or NULL if not found
- */
+} trudpReceiveQueue;
 
-trudpReceiveQueueData *trudpReceiveQueueFindById(trudpReceiveQueue *sq,
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+trudpReceiveQueue *trudpReceiveQueueNew();
+void trudpReceiveQueueDestroy(trudpReceiveQueue *rq);
+int trudpReceiveQueueFree(trudpReceiveQueue *rq);
+size_t trudpReceiveQueueSize(trudpReceiveQueue *rq);
+trudpReceiveQueueData *trudpReceiveQueueAdd(trudpReceiveQueue *rq,
+        void *packet, size_t packet_length);
+int trudpReceiveQueueDelete(trudpReceiveQueue *rq,
+        trudpReceiveQueueData *rqd);
+trudpReceiveQueueData *trudpReceiveQueueFindById(trudpReceiveQueue *rq,
         uint32_t id);
+trudpReceiveQueueData *trudpReceiveQueueFindNext(trudpReceiveQueue *rq,
+        uint32_t *id);
+
+static inline trudpPacket* trudpReceiveQueueDataGetPacket(
+        trudpReceiveQueueData* rqd) {
+    return (trudpPacket*)(rqd->packet);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -29,8 +29,21 @@
 
 #include "trudp_send_queue.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "teobase/types.h"
 
+#include "teoccl/memory.h"
+
+#define SEND_QUEUE_MIN_SIZE 64
+
+// Local functions
+static int _trudpSendQueueReserve(trudpSendQueue *sq, uint32_t span);
+static trudpSendQueueData *_trudpSendQueueSlot(trudpSendQueue *sq,
+        uint32_t id);
+static void _trudpSendQueueTrim(trudpSendQueue *sq);
+
 /**
  * Create new Send queue
  *
@@ -38,7 +51,14 @@
  */
 
 trudpSendQueue *trudpSendQueueNew() {
-    return trudpPacketQueueNew();
+
+    trudpSendQueue *sq = (trudpSendQueue *)ccl_calloc(sizeof(trudpSendQueue));
+    sq->ring = (trudpSendQueueData *)ccl_calloc(
+            SEND_QUEUE_MIN_SIZE * sizeof(trudpSendQueueData));
+    sq->mask = SEND_QUEUE_MIN_SIZE - 1;
+    sq->expected_time = UINT64_MAX;
+
+    return sq;
 }
 
 /**
@@ -49,7 +69,19 @@ trudpSendQueue *trudpSendQueueNew() {
  */
 
 int trudpSendQueueFree(trudpSendQueue *sq) {
-    return trudpPacketQueueFree(sq);
+
+    uint32_t i;
+    for (i = 0; i <= sq->mask; i++) {
+        free(sq->ring[i].packet);
+        trudpPayloadRelease(sq->ring[i].payload);
+    }
+    memset(sq->ring, 0, (sq->mask + 1) * sizeof(trudpSendQueueData));
+    sq->head = 0;
+    sq->span = 0;
+    sq->size = 0;
+    sq->expected_time = UINT64_MAX;
+
+    return 0;
 }
 
 /**
@@ -59,7 +91,11 @@ int trudpSendQueueFree(trudpSendQueue *sq) {
  */
 
 void trudpSendQueueDestroy(trudpSendQueue *sq) {
-    trudpPacketQueueDestroy(sq);
+    if (sq) {
+        trudpSendQueueFree(sq);
+        free(sq->ring);
+        free(sq);
+    }
 }
 
 /**
@@ -71,7 +107,138 @@ void trudpSendQueueDestroy(trudpSendQueue *sq) {
  */
 
 size_t trudpSendQueueSize(trudpSendQueue *sq) {
-    return trudpPacketQueueSize(sq);
+    return sq->size;
+}
+
+/**
+ * Grow ring so it can hold span slots. Slots keep their order (and packet
+ * buffers) and first slot moves to ring index 0
+ *
+ * @param sq Pointer to trudpSendQueue
+ * @param span Number of slots needed
+ *
+ * @return Zero at success
+ */
+static int _trudpSendQueueReserve(trudpSendQueue *sq, uint32_t span) {
+
+    uint32_t size = sq->mask + 1;
+    if (span <= size) return 0;
+
+    uint32_t new_size = size;
+    while (new_size < span) {
+        if (new_size > UINT32_MAX / 2) return -1;
+        new_size <<= 1;
+    }
+
+    trudpSendQueueData *ring = (trudpSendQueueData *)ccl_calloc(
+            new_size * sizeof(trudpSendQueueData));
+    if (ring == NULL) return -1;
+
+    uint32_t i;
+    for (i = 0; i < size; i++) {
+        ring[i] = sq->ring[(sq->head + i) & sq->mask];
+    }
+    free(sq->ring);
+    sq->ring = ring;
+    sq->mask = new_size - 1;
+    sq->head = 0;
+
+    return 0;
+}
+
+/**
+ * Remove empty slots from the beginning and from the end of queue
+ *
+ * @param sq Pointer to trudpSendQueue
+ */
+static void _trudpSendQueueTrim(trudpSendQueue *sq) {
+
+    while (sq->span && !sq->ring[sq->head].packet_length) {
+        sq->head = (sq->head + 1) & sq->mask;
+        sq->base_id++;
+        sq->span--;
+    }
+    while (sq->span &&
+            !sq->ring[(sq->head + sq->span - 1) & sq->mask].packet_length) {
+        sq->span--;
+    }
+}
+
+/**
+ * Get Send queue slot for packet id, move or grow the window if needed
+ *
+ * @param sq Pointer to trudpSendQueue
+ * @param id Packet id
+ *
+ * @return Pointer to trudpSendQueueData slot or NULL at error
+ */
+static trudpSendQueueData *_trudpSendQueueSlot(trudpSendQueue *sq,
+        uint32_t id) {
+
+    uint32_t offset;
+
+    if (!sq->span) {
+        // Empty queue: start new window from this packet
+        sq->base_id = id;
+        sq->span = 1;
+        offset = 0;
+    } else if ((offset = id - sq->base_id) < UINT32_MAX / 2) {
+        // Packet inside or after current window
+        if (offset >= sq->span) {
+            if (_trudpSendQueueReserve(sq, offset + 1)) return NULL;
+            sq->span = offset + 1;
+        }
+    } else {
+        // Packet before current window: move window start back
+        uint32_t back = sq->base_id - id;
+        if (_trudpSendQueueReserve(sq, sq->span + back)) return NULL;
+        sq->head = (sq->head - back) & sq->mask;
+        sq->base_id = id;
+        sq->span += back;
+        offset = 0;
+    }
+
+    trudpSendQueueData *sqd = &sq->ring[(sq->head + offset) & sq->mask];
+    if (!sqd->packet_length) {
+        sq->size++;
+        sqd->expected_time = UINT64_MAX;
+    }
+    trudpPayloadRelease(sqd->payload);
+    sqd->payload = NULL;
+    sqd->retrieves = 0;
+    sqd->retrieves_start = 0;
+    sqd->deadline = 0;
+
+    return sqd;
+}
+
+/**
+ * Allocate packet in Send queue, the packet should be created in returned
+ * trudpSendQueueData packet buffer
+ *
+ * @param sq Pointer to trudpSendQueue
+ * @param id Packet id
+ * @param packet_length Packet length
+ * @param expected_time Packet expected time
+ *
+ * @return Pointer to added trudpSendQueueData. The pointer is valid until
+ *         next trudpSendQueueAdd call
+ */
+
+trudpSendQueueData *trudpSendQueueAlloc(trudpSendQueue *sq, uint32_t id,
+        size_t packet_length, uint64_t expected_time) {
+
+    trudpSendQueueData *sqd = _trudpSendQueueSlot(sq, id);
+    if (sqd == NULL) return NULL;
+
+    if (sqd->packet_size < packet_length) {
+        sqd->packet = (char *)ccl_realloc(sqd->packet, packet_length);
+        sqd->packet_size = (uint32_t)packet_length;
+    }
+    sqd->packet_length = (uint32_t)packet_length;
+    trudpSendQueueSetExpectedTime(sq, sqd, expected_time);
+
+    return sqd;
 }
 
 /**
@@ -82,13 +249,123 @@ size_t trudpSendQueueSize(trudpSendQueue *sq) {
  * @param packet_length Packet length
  * @param expected_time Packet expected time
  *
- * @return Pointer to added trudpSendQueueData
+ * @return Pointer to added trudpSendQueueData. The pointer is valid until
+ *         next trudpSendQueueAdd call
  */
 
 trudpSendQueueData *trudpSendQueueAdd(trudpSendQueue *sq, void *packet,
         size_t packet_length, uint64_t expected_time) {
 
-    return trudpPacketQueueAdd(sq, packet, packet_length, expected_time);
+    trudpSendQueueData *sqd = trudpSendQueueAlloc(sq,
+            trudpPacketGetId((trudpPacket *)packet), packet_length,
+            expected_time);
+    if (sqd != NULL) memcpy(sqd->packet, packet, packet_length);
+
+    return sqd;
+}
+
+/**
+ * Add packet buffer to Send queue without copy. Send queue takes the buffer
+ * ownership and frees it
+ *
+ * @param sq Pointer to trudpSendQueue
+ * @param packet Packet buffer allocated with ccl_malloc
+ * @param packet_length Packet length
+ * @param expected_time Packet expected time
+ *
+ * @return Pointer to added trudpSendQueueData. The pointer is valid until
+ *         next trudpSendQueueAdd call
+ */
+
+trudpSendQueueData *trudpSendQueueAddBuffer(trudpSendQueue *sq, void *packet,
+        size_t packet_length, uint64_t expected_time) {
+
+    trudpSendQueueData *sqd = _trudpSendQueueSlot(sq,
+            trudpPacketGetId((trudpPacket *)packet));
+    if (sqd == NULL) {
+        free(packet);
+        return NULL;
+    }
+
+    free(sqd->packet);
+    sqd->packet = (char *)packet;
+    sqd->packet_size = (uint32_t)packet_length;
+    sqd->packet_length = (uint32_t)packet_length;
+    trudpSendQueueSetExpectedTime(sq, sqd, expected_time);
+
+    return sqd;
+}
+
+/**
+ * Add packet with shared payload to Send queue: packet buffer keeps header
+ * only. Send queue takes the payload reference and releases it
+ *
+ * @param sq Pointer to trudpSendQueue
+ * @param packet Packet header
+ * @param payload Pointer to trudpPayload
+ * @param expected_time Packet expected time
+ *
+ * @return Pointer to added trudpSendQueueData. The pointer is valid until
+ *         next trudpSendQueueAdd call
+ */
+
+trudpSendQueueData *trudpSendQueueAddPayload(trudpSendQueue *sq, void *packet,
+        trudpPayload *payload, uint64_t expected_time) {
+
+    trudpSendQueueData *sqd = trudpSendQueueAlloc(sq,
+            trudpPacketGetId((trudpPacket *)packet), TRUDP_HEADER_LENGTH,
+            expected_time);
+    if (sqd == NULL) {
+        trudpPayloadRelease(payload);
+        return NULL;
+    }
+
+    memcpy(sqd->packet, packet, TRUDP_HEADER_LENGTH);
+    sqd->payload = payload;
+    sqd->packet_length = (uint32_t)(TRUDP_HEADER_LENGTH + payload->length);
+
+    return sqd;
+}
+
+/**
+ * Replace expired packet of Send queue by SKIP packet with the same id. The
+ * packet data (or shared payload) is dropped, SKIP packet header is created
+ * in the slot packet buffer
+ *
+ * @param sqd Pointer to trudpSendQueueData
+ */
+
+void trudpSendQueueDataSkip(trudpSendQueueData *sqd) {
+
+    trudpPacket *packet = (trudpPacket *)sqd->packet;
+    trudpPacketSKIPcreate(sqd->packet, trudpPacketGetId(packet),
+            trudpPacketGetChannel(packet));
+    trudpPayloadRelease(sqd->payload);
+    sqd->payload = NULL;
+    sqd->packet_length = TRUDP_HEADER_LENGTH;
+    sqd->deadline = 0;
+}
+
+/**
+ * Set expected time of Send queue packet. Minimal expected time of queue is
+ * updated at once when it decreases and is recalculated by
+ * trudpSendQueueGetExpectedTime when packet with minimal time moves later
+ *
+ * @param sq Pointer to trudpSendQueue
+ * @param sqd Pointer to trudpSendQueueData
+ * @param expected_time Packet expected time
+ */
+
+void trudpSendQueueSetExpectedTime(trudpSendQueue *sq,
+        trudpSendQueueData *sqd, uint64_t expected_time) {
+
+    if (expected_time < sq->expected_time) {
+        sq->expected_time = expected_time;
+    } else if (sqd->expected_time <= sq->expected_time &&
+            expected_time > sqd->expected_time) {
+        sq->expected_time = 0;
+    }
+    sqd->expected_time = expected_time;
 }
 
 /**
@@ -101,7 +378,18 @@ trudpSendQueueData *trudpSendQueueAdd(trudpSendQueue *sq, void *packet,
  */
 
 int trudpSendQueueDelete(trudpSendQueue *sq, trudpSendQueueData *sqd) {
-    return trudpPacketQueueDelete(sq, sqd);
+
+    if (sqd == NULL || !sqd->packet_length) return -1;
+
+    // Packet buffer stays in the slot and is reused by next packets
+    sqd->packet_length = 0;
+    trudpPayloadRelease(sqd->payload);
+    sqd->payload = NULL;
+    if (!--sq->size) sq->expected_time = UINT64_MAX;
+    else if (sqd->expected_time <= sq->expected_time) sq->expected_time = 0;
+    _trudpSendQueueTrim(sq);
+
+    return 0;
 }
 
 /**
@@ -114,7 +402,12 @@ int trudpSendQueueDelete(trudpSendQueue *sq, trudpSendQueueData *sqd) {
  */
 
 trudpSendQueueData *trudpSendQueueFindById(trudpSendQueue *sq, uint32_t id) {
-    return trudpPacketQueueFindById(sq, id);
+
+    uint32_t offset = id - sq->base_id;
+    if (offset >= sq->span) return NULL;
+
+    trudpSendQueueData *sqd = &sq->ring[(sq->head + offset) & sq->mask];
+    return sqd->packet_length ? sqd : NULL;
 }
 
 /**
@@ -126,9 +419,41 @@ trudpSendQueueData *trudpSendQueueFindById(trudpSendQueue *sq, uint32_t id) {
  */
 
 trudpSendQueueData *trudpSendQueueGetFirst(trudpSendQueue *sq) {
-    return trudpPacketQueueGetFirst(sq);
+    return sq->span ? &sq->ring[sq->head] : NULL;
+}
+
+/**
+ * Get last element from Send Queue
+ *
+ * @param sq Pointer to trudpSendQueue
+
+ * @return Pointer to trudpSendQueueData or NULL if not found
+ */
+
+trudpSendQueueData *trudpSendQueueGetLast(trudpSendQueue *sq) {
+    return sq->span ? &sq->ring[(sq->head + sq->span - 1) & sq->mask] : NULL;
 }
 
+/**
+ * Get next element of Send Queue in packet id order
+ *
+ * @param sq Pointer to trudpSendQueue
+ * @param sqd Pointer to current trudpSendQueueData
+
+ * @return Pointer to next trudpSendQueueData or NULL at the end of queue
+ */
+
+trudpSendQueueData *trudpSendQueueGetNext(trudpSendQueue *sq,
+        trudpSendQueueData *sqd) {
+
+    uint32_t offset = ((uint32_t)(sqd - sq->ring) - sq->head) & sq->mask;
+    while (++offset < sq->span) {
+        sqd = &sq->ring[(sq->head + offset) & sq->mask];
+        if (sqd->packet_length) return sqd;
+    }
+
+    return NULL;
+}
 
 /**
  * Get send queue timeout
@@ -142,21 +467,35 @@ uint32_t trudpSendQueueGetTimeout(trudpSendQueue *sq, uint64_t current_t) {
 
     // Get sendQueue timeout
     uint32_t timeout_sq = UINT32_MAX;
-    if(sq->q->first) {
-        trudpPacketQueueData *pqd = (trudpPacketQueueData *) sq->q->first->data;
-        timeout_sq = pqd->expected_time > current_t ? pqd->expected_time - current_t : 0;
+    uint64_t expected_time = trudpSendQueueGetExpectedTime(sq);
+    if(expected_time != UINT64_MAX) {
+        timeout_sq = expected_time > current_t ? expected_time - current_t : 0;
     }
 
     return timeout_sq;
 }
 
+/**
+ * Get minimal expected time of Send queue packets. Retransmitted packets
+ * move later, so the first packet of queue may expire after next ones
+ *
+ * @param sq Pointer to trudpSendQueue
+ *
+ * @return Minimal expected time or UINT64_MAX if send queue is empty
+ */
 uint64_t trudpSendQueueGetExpectedTime(trudpSendQueue *sq) {
-        // Get sendQueue timeout
-    uint64_t channel_expected_time = UINT64_MAX;
-    if(sq->q->first) {
-        trudpPacketQueueData *pqd = (trudpPacketQueueData *) sq->q->first->data;
-        channel_expected_time = pqd->expected_time;
+
+    if (!sq->expected_time) {
+        uint64_t expected_time = UINT64_MAX;
+        trudpSendQueueData *sqd;
+        for (sqd = trudpSendQueueGetFirst(sq); sqd;
+                sqd = trudpSendQueueGetNext(sq, sqd)) {
+            if (sqd->expected_time < expected_time) {
+                expected_time = sqd->expected_time;
+            }
+        }
+        sq->expected_time = expected_time;
     }
 
-    return channel_expected_time;
+    return sq->expected_time;
 }
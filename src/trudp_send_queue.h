@@ -32,21 +32,43 @@
 
 #include "teobase/types.h"
 
-#include "packet_queue.h"
+#include "packet.h"
+#include "trudp_payload.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * Send queue type
+ * Send queue data type: one slot of send queue ring
  */
-typedef trudpPacketQueue trudpSendQueue;
+typedef struct trudpSendQueueData {
+
+    uint64_t expected_time;  ///< Packet expected time
+    uint32_t packet_length;  ///< Packet length or zero if slot is empty
+    uint32_t retrieves;      ///< Number of retransmits
+    uint32_t retrieves_start;///< Time of first retransmit
+    uint32_t packet_size;    ///< Size of allocated packet buffer
+    char *packet;            ///< Packet buffer (reused by next packets)
+    trudpPayload *payload;   ///< Shared payload sent after header in packet buffer or NULL
+    uint64_t deadline;       ///< Time when packet is replaced by SKIP packet instead of resend, zero if packet does not expire
+
+} trudpSendQueueData;
 
 /**
- * Send queue data type
+ * Send queue type: ring of slots indexed by packet id offset from base_id
  */
-typedef trudpPacketQueueData trudpSendQueueData;
+typedef struct trudpSendQueue {
+
+    trudpSendQueueData *ring; ///< Slots array, size is power of two
+    uint32_t mask;            ///< Number of slots minus one
+    uint32_t head;            ///< Ring index of packet with base_id
+    uint32_t base_id;         ///< Id of first packet in queue
+    uint32_t span;            ///< Number of slots from first to last packet
+    size_t size;              ///< Number of packets in queue
+    uint64_t expected_time;   ///< Minimal expected time of packets, UINT64_MAX if queue is empty or zero if it should be recalculated
+
+} trudpSendQueue;
 
 /**
  * Create new Send queue
@@ -87,11 +109,74 @@ size_t trudpSendQueueSize(trudpSendQueue *sq);
  * @param packet_length Packet length
  * @param expected_time Packet expected time
  *
- * @return Pointer to added trudpSendQueueData
+ * @return Pointer to added trudpSendQueueData. The pointer is valid until
+ *         next trudpSendQueueAdd call
  */
 
 trudpSendQueueData *trudpSendQueueAdd(trudpSendQueue *sq, void *packet,
         size_t packet_length, uint64_t expected_time);
+/**
+ * Allocate packet in Send queue, the packet should be created in returned
+ * trudpSendQueueData packet buffer
+ *
+ * @param sq Pointer to trudpSendQueue
+ * @param id Packet id
+ * @param packet_length Packet length
+ * @param expected_time Packet expected time
+ *
+ * @return Pointer to added trudpSendQueueData. The pointer is valid until
+ *         next trudpSendQueueAdd call
+ */
+
+trudpSendQueueData *trudpSendQueueAlloc(trudpSendQueue *sq, uint32_t id,
+        size_t packet_length, uint64_t expected_time);
+/**
+ * Add packet buffer to Send queue without copy. Send queue takes the buffer
+ * ownership and frees it
+ *
+ * @param sq Pointer to trudpSendQueue
+ * @param packet Packet buffer allocated with ccl_malloc
+ * @param packet_length Packet length
+ * @param expected_time Packet expected time
+ *
+ * @return Pointer to added trudpSendQueueData. The pointer is valid until
+ *         next trudpSendQueueAdd call
+ */
+
+trudpSendQueueData *trudpSendQueueAddBuffer(trudpSendQueue *sq, void *packet,
+        size_t packet_length, uint64_t expected_time);
+/**
+ * Add packet with shared payload to Send queue: packet buffer keeps header
+ * only. Send queue takes the payload reference and releases it
+ *
+ * @param sq Pointer to trudpSendQueue
+ * @param packet Packet header
+ * @param payload Pointer to trudpPayload
+ * @param expected_time Packet expected time
+ *
+ * @return Pointer to added trudpSendQueueData. The pointer is valid until
+ *         next trudpSendQueueAdd call
+ */
+
+trudpSendQueueData *trudpSendQueueAddPayload(trudpSendQueue *sq, void *packet,
+        trudpPayload *payload, uint64_t expected_time);
+/**
+ * Replace expired packet of Send queue by SKIP packet with the same id
+ *
+ * @param sqd Pointer to trudpSendQueueData
+ */
+
+void trudpSendQueueDataSkip(trudpSendQueueData *sqd);
+/**
+ * Set expected time of Send queue packet
+ *
+ * @param sq Pointer to trudpSendQueue
+ * @param sqd Pointer to trudpSendQueueData
+ * @param expected_time Packet expected time
+ */
+
+void trudpSendQueueSetExpectedTime(trudpSendQueue *sq,
+        trudpSendQueueData *sqd, uint64_t expected_time);
 /**
  * Remove element from Send queue
  *
@@ -121,9 +206,34 @@ trudpSendQueueData *trudpSendQueueFindById(trudpSendQueue *sq, uint32_t id);
  */
 
 trudpSendQueueData *trudpSendQueueGetFirst(trudpSendQueue *sq);
+/**
+ * Get last element from Send Queue
+ *
+ * @param sq Pointer to trudpSendQueue
+
+ * @return Pointer to trudpSendQueueData or NULL if not found
+ */
+
+trudpSendQueueData *trudpSendQueueGetLast(trudpSendQueue *sq);
+/**
+ * Get next element of Send Queue in packet id order
+ *
+ * @param sq Pointer to trudpSendQueue
+ * @param sqd Pointer to current trudpSendQueueData
+
+ * @return Pointer to next trudpSendQueueData or NULL at the end of queue
+ */
+
+trudpSendQueueData *trudpSendQueueGetNext(trudpSendQueue *sq,
+        trudpSendQueueData *sqd);
 
 uint32_t trudpSendQueueGetTimeout(trudpSendQueue *sq, uint64_t current_t);
 uint64_t trudpSendQueueGetExpectedTime(trudpSendQueue *sq);
+
+static inline trudpPacket* trudpSendQueueDataGetPacket(trudpSendQueueData* sqd) {
+    return (trudpPacket*)(sqd->packet);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,379 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_shards.c
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Sharded runtime: each worker thread owns SO_REUSEPORT socket bound to the
+ * same port and trudpData with its own channels, so threads share nothing.
+ * On Linux classic BPF reuseport program hashes peer address and port to
+ * select socket, so a peer always lands on the same shard and
+ * trudpShardsGetIndex tells which shard it is.
+ *
+ * Created on October 17, 2026, 7:20 PM
+ */
+
+#include "trudp_shards.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "teoccl/memory.h"
+#include "teobase/socket.h"
+
+#include "udp.h"
+
+#if !defined(TEONET_OS_WINDOWS)
+
+#include <poll.h>
+#include <pthread.h>
+
+#if defined(TEONET_OS_LINUX)
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+#endif
+
+// Local functions
+static void *_trudpShardThread(void *arg);
+static int _trudpShardsAttachSteering(int fd, size_t num);
+static uint32_t _trudpShardsHash(uint32_t a);
+
+/**
+ * Create shards: bind num SO_REUSEPORT sockets to port and create trudpData
+ * for each of them. Worker threads are started by trudpShardsStart. Shards
+ * send packets themselves (egress batch), so event callback does not need
+ * to process PROCESS_SEND event. Event callback of each shard is called from
+ * its worker thread, the shard trudpData may be used in this thread only,
+ * other threads send data with trudpShardsSubmitSendData
+ *
+ * @param port UDP port
+ * @param num Number of shards (worker threads)
+ * @param event_cb Event callback
+ * @param user_data User data which will send to event callback
+ *
+ * @return Pointer to trudpShards or NULL at error
+ */
+trudpShards *trudpShardsNew(int port, size_t num, trudpEventCb event_cb,
+        void *user_data) {
+
+    if (num == 0) return NULL;
+
+    trudpShards *shards = (trudpShards *)ccl_calloc(sizeof(trudpShards));
+    shards->shard = (trudpShard *)ccl_calloc(num * sizeof(trudpShard));
+    shards->threads = ccl_calloc(num * sizeof(pthread_t));
+    shards->port = port;
+
+    size_t i;
+    for (i = 0; i < num; i++) {
+        int fd = trudpUdpBindReuseport(port);
+        if (fd < 0) {
+            trudpShardsDestroy(shards);
+            return NULL;
+        }
+        trudpUdpSetNonblock(fd);
+
+        trudpShard *shard = &shards->shard[i];
+        shard->shards = shards;
+        shard->idx = i;
+        shard->td = trudpInit(fd, port, event_cb, user_data);
+        trudpSetSendBatch(shard->td, SHARD_SEND_BATCH_SIZE,
+                SHARD_SEND_BATCH_DELAY);
+        trudpSetSubmitQueue(shard->td, SHARD_SUBMIT_QUEUE_SIZE);
+        shards->num++;
+    }
+
+    // Steering program is shared by reuseport group
+    shards->steering = !_trudpShardsAttachSteering(shards->shard[0].td->fd,
+            num);
+
+    return shards;
+}
+
+/**
+ * Start shards worker threads
+ *
+ * @param shards Pointer to trudpShards
+ *
+ * @return Zero at success or -1 at error
+ */
+int trudpShardsStart(trudpShards *shards) {
+
+    pthread_t *threads = (pthread_t *)shards->threads;
+    __atomic_store_n(&shards->stop, 0, __ATOMIC_RELEASE);
+    while (shards->started < shards->num) {
+        if (pthread_create(&threads[shards->started], NULL,
+                _trudpShardThread, &shards->shard[shards->started])) {
+            return -1;
+        }
+        shards->started++;
+    }
+
+    return 0;
+}
+
+/**
+ * Stop shards worker threads and wait them finished
+ *
+ * @param shards Pointer to trudpShards
+ */
+void trudpShardsStop(trudpShards *shards) {
+
+    pthread_t *threads = (pthread_t *)shards->threads;
+    __atomic_store_n(&shards->stop, 1, __ATOMIC_RELEASE);
+    while (shards->started > 0) {
+        pthread_join(threads[--shards->started], NULL);
+    }
+}
+
+/**
+ * Stop shards, destroy their channels and trudpData and close sockets
+ *
+ * @param shards Pointer to trudpShards
+ */
+void trudpShardsDestroy(trudpShards *shards) {
+
+    if (shards == NULL) return;
+
+    trudpShardsStop(shards);
+
+    size_t i;
+    for (i = 0; i < shards->num; i++) {
+        trudpData *td = shards->shard[i].td;
+        int fd = td->fd;
+        trudpChannelDestroyAll(td);
+        trudpDestroy(td);
+        teosockClose(fd);
+    }
+    free(shards->threads);
+    free(shards->shard);
+    free(shards);
+}
+
+/**
+ * Get index of shard which receives datagrams from peer. Create channel to
+ * this peer in the same shard, or answers would be received by other shard
+ *
+ * @param shards Pointer to trudpShards
+ * @param addr Peer address
+ * @param addr_len Peer address length
+ *
+ * @return Shard index or -1 if steering program is not attached (kernel
+ *         selects shard by its own hash)
+ */
+int trudpShardsGetIndex(trudpShards *shards, __CONST_SOCKADDR_ARG addr,
+        socklen_t addr_len) {
+
+    if (!shards->steering) return -1;
+
+    trudpChannelKey key;
+    if (trudpChannelKeyMake(&key, addr, addr_len, 0)) return -1;
+
+    // Must be the same as steering program calculates
+    uint32_t a, w[4];
+    memcpy(w, key.addr, sizeof(w));
+    if (key.family == AF_INET) {
+        a = ntohl(w[0]);
+    } else if (w[0] == 0 && w[1] == 0 && w[2] == htonl(0xffff)) {
+        a = ntohl(w[3]); // IPv4 mapped IPv6 address is received as IPv4
+    } else {
+        a = ntohl(w[0]) ^ ntohl(w[1]) ^ ntohl(w[2]) ^ ntohl(w[3]);
+    }
+    a ^= ntohs(key.port);
+
+    return (int)(_trudpShardsHash(a) % shards->num);
+}
+
+/**
+ * Send data to peer from any thread: data is added to submit queue of the
+ * shard which receives datagrams from this peer and sent by its worker thread
+ *
+ * @param shards Pointer to trudpShards
+ * @param addr Peer address
+ * @param addr_len Peer address length
+ * @param channel TR-UDP channel number
+ * @param data Pointer to data
+ * @param data_length Data length
+ *
+ * @return Zero at success or -1 at error: submit queue is full or steering
+ *         program is not attached (shards->steering is not set), so shard of
+ *         peer is unknown and data can't be sent by shard which has channel
+ *         to this peer
+ */
+int trudpShardsSubmitSendData(trudpShards *shards, __CONST_SOCKADDR_ARG addr,
+        socklen_t addr_len, int channel, void *data, size_t data_length) {
+
+    int idx = trudpShardsGetIndex(shards, addr, addr_len);
+    if (idx < 0) return -1;
+
+    return trudpSubmitSendData(shards->shard[idx].td, addr, addr_len, channel,
+            data, data_length);
+}
+
+/**
+ * Mix peer address and port hash (the same in steering program)
+ *
+ * @param a Peer address words and port xor
+ *
+ * @return Hash
+ */
+static uint32_t _trudpShardsHash(uint32_t a) {
+    a *= 0x9e3779b1;
+    return a ^ (a >> 16);
+}
+
+/**
+ * Attach classic BPF reuseport program which selects socket by peer address
+ * and port hash. IPv4 header length is taken from packet, IPv6 packets are
+ * expected without extension headers
+ *
+ * @param fd Socket of reuseport group
+ * @param num Number of sockets in group
+ *
+ * @return Zero at success or -1 if not supported
+ */
+static int _trudpShardsAttachSteering(int fd, size_t num) {
+
+    #if defined(TEONET_OS_LINUX)
+    struct sock_filter code[] = {
+        // Network protocol
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, SKF_AD_OFF + SKF_AD_PROTOCOL),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IPV6, 0, 14),
+
+        // IPv6: xor of source address words and source port
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 8),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 12),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 16),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 20),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, SKF_NET_OFF + 40),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_JMP | BPF_JA, 5),
+
+        // IPv4: source address xor source port
+        BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, SKF_NET_OFF),
+        BPF_STMT(BPF_LD | BPF_H | BPF_IND, SKF_NET_OFF),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + 12),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+
+        // Hash (_trudpShardsHash) modulo number of sockets
+        BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, 0x9e3779b1),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 16),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (uint32_t)num),
+        BPF_STMT(BPF_RET | BPF_A, 0),
+    };
+    struct sock_fprog prog = { sizeof(code) / sizeof(code[0]), code };
+
+    return setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog,
+            sizeof(prog)) ? -1 : 0;
+    #else
+    (void)fd;
+    (void)num;
+    return -1;
+    #endif
+}
+
+/**
+ * Shard worker thread: receive, retransmit, write queue and keepalive loop
+ *
+ * @param arg Pointer to trudpShard
+ *
+ * @return NULL
+ */
+static void *_trudpShardThread(void *arg) {
+
+    trudpShard *shard = (trudpShard *)arg;
+    trudpData *td = shard->td;
+
+    while (!__atomic_load_n(&shard->shards->stop, __ATOMIC_ACQUIRE)) {
+
+        // Wait for data up to next retransmit time
+        uint32_t timeout = trudpGetSendQueueTimeout(td, teoGetTimestampFull());
+        if (timeout > SHARD_POLL_TIMEOUT) timeout = SHARD_POLL_TIMEOUT;
+        struct pollfd pfd[2] = {
+            { td->fd, POLLIN, 0 },
+            { trudpGetSubmitQueueFd(td), POLLIN, 0 }
+        };
+        if (poll(pfd, 2, (timeout + 999) / 1000) > 0 &&
+                (pfd[0].revents & POLLIN)) {
+            int i = 0;
+            while (trudpProcessReceivedBatch(td, 0) > 0 &&
+                    ++i < SHARD_RECV_BATCHES);
+        }
+
+        trudpProcessSubmitQueue(td);
+        trudpProcessSendQueue(td, NULL);
+        trudpProcessWriteQueue(td);
+        trudpProcessKeepConnection(td);
+    }
+
+    return NULL;
+}
+
+#else
+
+trudpShards *trudpShardsNew(int port, size_t num, trudpEventCb event_cb,
+        void *user_data) {
+    (void)port; (void)num; (void)event_cb; (void)user_data;
+    return NULL; // Not supported
+}
+
+int trudpShardsStart(trudpShards *shards) {
+    (void)shards;
+    return -1;
+}
+
+void trudpShardsStop(trudpShards *shards) {
+    (void)shards;
+}
+
+void trudpShardsDestroy(trudpShards *shards) {
+    (void)shards;
+}
+
+int trudpShardsGetIndex(trudpShards *shards, __CONST_SOCKADDR_ARG addr,
+        socklen_t addr_len) {
+    (void)shards; (void)addr; (void)addr_len;
+    return -1;
+}
+
+int trudpShardsSubmitSendData(trudpShards *shards, __CONST_SOCKADDR_ARG addr,
+        socklen_t addr_len, int channel, void *data, size_t data_length) {
+    (void)shards; (void)addr; (void)addr_len; (void)channel; (void)data;
+    (void)data_length;
+    return -1;
+}
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_shards.h
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Created on October 17, 2026, 7:20 PM
+ */
+
+#ifndef TRUDP_SHARDS_H
+#define TRUDP_SHARDS_H
+
+#include "teobase/types.h"
+
+#include "trudp_api.h"
+#include "trudp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct trudpShards;
+
+/**
+ * Shard: worker thread with own SO_REUSEPORT socket and own trudpData
+ */
+typedef struct trudpShard {
+
+    struct trudpShards *shards; ///< Pointer to parent trudpShards
+    size_t idx;                 ///< Shard index (socket index in reuseport group)
+    trudpData *td;              ///< Shard TR-UDP data: socket, channels and statistic
+
+} trudpShard;
+
+/**
+ * Sharded runtime: N worker threads bound to the same UDP port
+ */
+typedef struct trudpShards {
+
+    trudpShard *shard;          ///< Shards array
+    size_t num;                 ///< Number of shards
+    int port;                   ///< UDP port
+    int steering;               ///< Peer address steering program attached
+    int stop;                   ///< Stop flag (set by trudpShardsStop)
+    void *threads;              ///< Worker threads (pthread_t array)
+    size_t started;             ///< Number of started worker threads
+
+} trudpShards;
+
+TRUDP_API trudpShards *trudpShardsNew(int port, size_t num,
+        trudpEventCb event_cb, void *user_data);
+TRUDP_API int trudpShardsStart(trudpShards *shards);
+TRUDP_API void trudpShardsStop(trudpShards *shards);
+TRUDP_API void trudpShardsDestroy(trudpShards *shards);
+TRUDP_API int trudpShardsGetIndex(trudpShards *shards,
+        __CONST_SOCKADDR_ARG addr, socklen_t addr_len);
+TRUDP_API int trudpShardsSubmitSendData(trudpShards *shards,
+        __CONST_SOCKADDR_ARG addr, socklen_t addr_len, int channel, void *data,
+        size_t data_length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRUDP_SHARDS_H */
@@ -330,7 +330,7 @@ static char* trimLeadingZerro(char *str) {
 static char* showTime(double t) {
 
     #define T_STR_LEN 64
-    static char t_str[T_STR_LEN];
+    static TRUDP_THREAD_LOCAL char t_str[T_STR_LEN];
 
     double seconds;
     int days, hours, minutes;
@@ -560,11 +560,11 @@ char *trudpStatShowQueueStr(trudpChannelData *tcd, int type) {
 //       trudpPacketQueueSize(tcd->receiveQueue) > MAX_QUELEN_SHOW)
 //    exit(-1);
 
-    teoQueueIterator it;
+    trudpSendQueueData *sqd = NULL;
+    trudpReceiveQueueData *rqd = NULL;
+    uint32_t rq_id = tcd->receiveExpectedId;
     if (!type) {
-        teoQueueIteratorReset(&it, tcd->sendQueue->q);
-    } else {
-        teoQueueIteratorReset(&it, tcd->receiveQueue->q);
+        sqd = trudpSendQueueGetFirst(tcd->sendQueue);
     }
 
     int i = 0;
@@ -580,16 +580,27 @@ char *trudpStatShowQueueStr(trudpChannelData *tcd, int type) {
         , !type ? "next id: " : "expected id: "
         , !type ? tcd->sendId : tcd->receiveExpectedId
     );
-    while(teoQueueIteratorNext(&it)) {
-
-        trudpPacketQueueData *tqd = (trudpPacketQueueData *)
-                ((teoQueueData *)teoQueueIteratorElement(&it))->data;
-
-        long timeout_sq = current_t < tqd->expected_time ?
-            (long)(tqd->expected_time - current_t) :
-            -1 * (long)(current_t - tqd->expected_time);
-
-        trudpPacket* tq_packet = trudpPacketQueueDataGetPacket(tqd);
+    for(;;) {
+
+        trudpPacket* tq_packet;
+        long timeout_sq = 0;
+        uint32_t retrieves = 0;
+        if (!type) {
+            if (!sqd) break;
+            timeout_sq = current_t < sqd->expected_time ?
+                (long)(sqd->expected_time - current_t) :
+                -1 * (long)(current_t - sqd->expected_time);
+            retrieves = sqd->retrieves;
+            tq_packet = trudpSendQueueDataGetPacket(sqd);
+            sqd = trudpSendQueueGetNext(tcd->sendQueue, sqd);
+        } else {
+            if (i >= (int)trudpReceiveQueueSize(tcd->receiveQueue) ||
+                !(rqd = trudpReceiveQueueFindNext(tcd->receiveQueue, &rq_id))) {
+                break;
+            }
+            tq_packet = trudpReceiveQueueDataGetPacket(rqd);
+            rq_id++;
+        }
 
         str = sformatMessage(str,
         "%s"
@@ -597,8 +608,8 @@ char *trudpStatShowQueueStr(trudpChannelData *tcd, int type) {
         , str
         , i++
         , trudpPacketGetId(tq_packet)
-        , !type ? timeout_sq / 1000.0 : 0
-        , (uint32_t)(!type ? tqd->retrieves : 0)
+        , timeout_sq / 1000.0
+        , retrieves
         );
         if(i > MAX_QUELEN_SHOW) { str = sformatMessage(str, "%s...\n", str); break; }
     }
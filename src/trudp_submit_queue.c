@@ -0,0 +1,223 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_submit_queue.c
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Submit queue: bounded lock-free ring (each cell has sequence number which
+ * tells producers and consumer whose turn it is), so application threads
+ * send data without taking I/O thread lock. Producers wake I/O thread with
+ * eventfd (pipe where eventfd is absent) once per drain.
+ *
+ * Created on October 17, 2026, 8:10 PM
+ */
+
+#include "trudp_submit_queue.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "teoccl/memory.h"
+
+#if defined(TEONET_OS_LINUX)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#elif !defined(TEONET_OS_WINDOWS)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define SUBMIT_QUEUE_MIN_SIZE 16
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#define _trudpAtomicLoad(p) (MemoryBarrier(), *(volatile size_t *)(p))
+#define _trudpAtomicStore(p, v) do { MemoryBarrier(); *(volatile size_t *)(p) = (v); } while (0)
+#define _trudpAtomicCas(p, expected, desired) \
+    (InterlockedCompareExchangePointer((PVOID volatile *)(p), \
+        (PVOID)(desired), (PVOID)(expected)) == (PVOID)(expected))
+#define _trudpAtomicExchangeInt(p, v) InterlockedExchange((volatile LONG *)(p), (v))
+#else
+#define _trudpAtomicLoad(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define _trudpAtomicStore(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define _trudpAtomicCas(p, expected, desired) \
+    __atomic_compare_exchange_n(p, &(size_t){ expected }, desired, 0, \
+        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)
+#define _trudpAtomicExchangeInt(p, v) __atomic_exchange_n(p, v, __ATOMIC_ACQ_REL)
+#endif
+
+/**
+ * Create new submit queue
+ *
+ * @param size Number of cells (rounded up to power of two)
+ *
+ * @return Pointer to trudpSubmitQueue or NULL at error
+ */
+trudpSubmitQueue *trudpSubmitQueueNew(size_t size) {
+
+    trudpSubmitQueue *q = (trudpSubmitQueue *)ccl_calloc(
+            sizeof(trudpSubmitQueue));
+
+    size_t cells = SUBMIT_QUEUE_MIN_SIZE, i;
+    while (cells < size) cells <<= 1;
+    q->cells = (trudpSubmitQueueCell *)ccl_calloc(
+            cells * sizeof(trudpSubmitQueueCell));
+    q->mask = cells - 1;
+    for (i = 0; i < cells; i++) q->cells[i].seq = i;
+
+    // Wakeup event
+    q->event_fd[0] = q->event_fd[1] = -1;
+    #if defined(TEONET_OS_LINUX)
+    q->event_fd[0] = q->event_fd[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    #elif !defined(TEONET_OS_WINDOWS)
+    if (!pipe(q->event_fd)) {
+        fcntl(q->event_fd[0], F_SETFL, O_NONBLOCK);
+        fcntl(q->event_fd[1], F_SETFL, O_NONBLOCK);
+    }
+    #endif
+
+    return q;
+}
+
+/**
+ * Destroy submit queue and free data of not processed messages
+ *
+ * @param q Pointer to trudpSubmitQueue
+ */
+void trudpSubmitQueueDestroy(trudpSubmitQueue *q) {
+
+    if (q == NULL) return;
+
+    trudpSubmitQueueData d;
+    while (!trudpSubmitQueuePop(q, &d)) free(d.data);
+
+    #if !defined(TEONET_OS_WINDOWS)
+    if (q->event_fd[0] >= 0) close(q->event_fd[0]);
+    if (q->event_fd[1] >= 0 && q->event_fd[1] != q->event_fd[0]) {
+        close(q->event_fd[1]);
+    }
+    #endif
+    free(q->cells);
+    free(q);
+}
+
+/**
+ * Add message to submit queue. May be called from any thread
+ *
+ * @param q Pointer to trudpSubmitQueue
+ * @param addr Peer address
+ * @param addr_len Peer address length
+ * @param channel TR-UDP channel number
+ * @param data Message data (copied)
+ * @param data_length Message data length
+ *
+ * @return Zero at success or -1 if queue is full
+ */
+int trudpSubmitQueuePush(trudpSubmitQueue *q, __CONST_SOCKADDR_ARG addr,
+        socklen_t addr_len, int channel, void *data, size_t data_length) {
+
+    if (addr_len > (socklen_t)sizeof(struct sockaddr_storage)) return -1;
+
+    // Reserve cell
+    trudpSubmitQueueCell *cell;
+    size_t pos = _trudpAtomicLoad(&q->head);
+    for (;;) {
+        cell = &q->cells[pos & q->mask];
+        size_t seq = _trudpAtomicLoad(&cell->seq);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0) {
+            if (_trudpAtomicCas(&q->head, pos, pos + 1)) break;
+        }
+        else if (dif < 0) return -1; // Full
+        pos = _trudpAtomicLoad(&q->head);
+    }
+
+    // Fill and publish cell
+    memcpy(&cell->d.addr, addr, addr_len);
+    cell->d.addr_len = addr_len;
+    cell->d.channel = channel;
+    cell->d.data = ccl_malloc(data_length ? data_length : 1);
+    memcpy(cell->d.data, data, data_length);
+    cell->d.data_length = data_length;
+    _trudpAtomicStore(&cell->seq, pos + 1);
+
+    // Wake up I/O thread if it was not woken up yet
+    if (!_trudpAtomicExchangeInt(&q->wakeup, 1) && q->event_fd[1] >= 0) {
+        #if !defined(TEONET_OS_WINDOWS)
+        uint64_t one = 1;
+        ssize_t rv = write(q->event_fd[1], &one, sizeof(one));
+        (void)rv;
+        #endif
+    }
+
+    return 0;
+}
+
+/**
+ * Get message from submit queue. Must be called from one (I/O) thread only
+ *
+ * @param q Pointer to trudpSubmitQueue
+ * @param d [out] Message descriptor, caller frees d->data
+ *
+ * @return Zero at success or -1 if queue is empty
+ */
+int trudpSubmitQueuePop(trudpSubmitQueue *q, trudpSubmitQueueData *d) {
+
+    trudpSubmitQueueCell *cell = &q->cells[q->tail & q->mask];
+    if (_trudpAtomicLoad(&cell->seq) != q->tail + 1) return -1;
+
+    *d = cell->d;
+    _trudpAtomicStore(&cell->seq, q->tail + q->mask + 1);
+    q->tail++;
+
+    return 0;
+}
+
+/**
+ * Get submit queue wakeup event fd to watch it in I/O thread event loop
+ *
+ * @param q Pointer to trudpSubmitQueue
+ *
+ * @return File descriptor readable when messages were added or -1 if not
+ *         supported (process queue every loop iteration)
+ */
+int trudpSubmitQueueGetFd(trudpSubmitQueue *q) {
+    return q->event_fd[0];
+}
+
+/**
+ * Clear wakeup event. Called by I/O thread before it processes queue so
+ * messages added during processing wake it up again
+ *
+ * @param q Pointer to trudpSubmitQueue
+ */
+void trudpSubmitQueueClearEvent(trudpSubmitQueue *q) {
+
+    _trudpAtomicExchangeInt(&q->wakeup, 0);
+    #if !defined(TEONET_OS_WINDOWS)
+    if (q->event_fd[0] >= 0) {
+        uint64_t buf[8];
+        while (read(q->event_fd[0], buf, sizeof(buf)) > 0);
+    }
+    #endif
+}
@@ -0,0 +1,94 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_submit_queue.h
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Created on October 17, 2026, 8:10 PM
+ */
+
+#ifndef TRUDP_SUBMIT_QUEUE_H
+#define TRUDP_SUBMIT_QUEUE_H
+
+#include "teobase/types.h"
+
+#include "trudp_api.h"
+#include "udp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Submit queue message descriptor
+ */
+typedef struct trudpSubmitQueueData {
+
+    struct sockaddr_storage addr; ///< Peer address
+    socklen_t addr_len;           ///< Peer address length
+    int channel;                  ///< TR-UDP channel number
+    void *data;                   ///< Message data (owned by queue element)
+    size_t data_length;           ///< Message data length
+
+} trudpSubmitQueueData;
+
+/**
+ * Submit queue cell
+ */
+typedef struct trudpSubmitQueueCell {
+
+    size_t seq;                   ///< Cell sequence (position of next push or pop)
+    trudpSubmitQueueData d;       ///< Message descriptor
+
+} trudpSubmitQueueCell;
+
+/**
+ * Submit queue: lock-free bounded multi-producer single-consumer ring of
+ * messages sent by application threads and processed by I/O thread
+ */
+typedef struct trudpSubmitQueue {
+
+    trudpSubmitQueueCell *cells;  ///< Cells array, size is power of two
+    size_t mask;                  ///< Number of cells minus one
+    char pad0[64];                ///< Keep producers and consumer positions in different cache lines
+    size_t head;                  ///< Next push position (producers)
+    char pad1[64];
+    size_t tail;                  ///< Next pop position (consumer)
+    int wakeup;                   ///< Wakeup event is pending
+    int event_fd[2];              ///< Wakeup event read and write fd (eventfd or pipe), -1 if not supported
+
+} trudpSubmitQueue;
+
+trudpSubmitQueue *trudpSubmitQueueNew(size_t size);
+void trudpSubmitQueueDestroy(trudpSubmitQueue *q);
+int trudpSubmitQueuePush(trudpSubmitQueue *q, __CONST_SOCKADDR_ARG addr,
+        socklen_t addr_len, int channel, void *data, size_t data_length);
+int trudpSubmitQueuePop(trudpSubmitQueue *q, trudpSubmitQueueData *d);
+int trudpSubmitQueueGetFd(trudpSubmitQueue *q);
+void trudpSubmitQueueClearEvent(trudpSubmitQueue *q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRUDP_SUBMIT_QUEUE_H */
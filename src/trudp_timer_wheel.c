@@ -0,0 +1,193 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_timer_wheel.c
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Timer wheel: keeps channel keepalive timers so that processing visits
+ * expired timers only.
+ *
+ * Created on October 17, 2026, 4:40 PM
+ */
+
+#include "trudp_timer_wheel.h"
+
+#include "teoccl/memory.h"
+
+// Local functions
+static void _trudpTimerWheelLink(trudpTimerWheelNode *list,
+        trudpTimerWheelNode *node);
+
+/**
+ * Create new timer wheel
+ *
+ * @param ts Current time
+ *
+ * @return Pointer to trudpTimerWheel
+ */
+trudpTimerWheel *trudpTimerWheelNew(uint64_t ts) {
+
+    trudpTimerWheel *tw = (trudpTimerWheel *)ccl_malloc(
+            sizeof(trudpTimerWheel));
+
+    size_t i;
+    for (i = 0; i < TIMER_WHEEL_SIZE; i++) {
+        trudpTimerWheelListInit(&tw->slots[i]);
+    }
+    tw->current = ts / TIMER_WHEEL_TICK;
+
+    return tw;
+}
+
+/**
+ * Destroy timer wheel. Nodes linked to the wheel are not changed
+ *
+ * @param tw Pointer to trudpTimerWheel
+ */
+void trudpTimerWheelDestroy(trudpTimerWheel *tw) {
+    free(tw);
+}
+
+/**
+ * Initialize empty node list
+ *
+ * @param list Pointer to list head
+ */
+void trudpTimerWheelListInit(trudpTimerWheelNode *list) {
+    list->next = list;
+    list->prev = list;
+    list->deadline = 0;
+}
+
+/**
+ * Link node to the end of list
+ *
+ * @param list Pointer to list head
+ * @param node Pointer to trudpTimerWheelNode
+ */
+static void _trudpTimerWheelLink(trudpTimerWheelNode *list,
+        trudpTimerWheelNode *node) {
+
+    node->next = list;
+    node->prev = list->prev;
+    list->prev->next = node;
+    list->prev = node;
+}
+
+/**
+ * Add node to timer wheel or move it to new deadline
+ *
+ * @param tw Pointer to trudpTimerWheel
+ * @param node Pointer to trudpTimerWheelNode
+ * @param deadline Timer deadline
+ */
+void trudpTimerWheelAdd(trudpTimerWheel *tw, trudpTimerWheelNode *node,
+        uint64_t deadline) {
+
+    trudpTimerWheelRemove(node);
+
+    uint64_t tick = deadline / TIMER_WHEEL_TICK;
+    if (tick < tw->current) tick = tw->current;
+    node->deadline = deadline;
+    _trudpTimerWheelLink(&tw->slots[tick & (TIMER_WHEEL_SIZE - 1)], node);
+}
+
+/**
+ * Remove node from timer wheel (or from expired list)
+ *
+ * @param node Pointer to trudpTimerWheelNode
+ */
+void trudpTimerWheelRemove(trudpTimerWheelNode *node) {
+
+    if (node->next == NULL) return;
+
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next = NULL;
+    node->prev = NULL;
+}
+
+/**
+ * Move all nodes with deadline came to expired list
+ *
+ * @param tw Pointer to trudpTimerWheel
+ * @param ts Current time
+ * @param expired Pointer to initialized list head to add expired nodes to
+ */
+void trudpTimerWheelExpire(trudpTimerWheel *tw, uint64_t ts,
+        trudpTimerWheelNode *expired) {
+
+    uint64_t tick = ts / TIMER_WHEEL_TICK, t = tw->current;
+    if (tick < t) return;
+
+    // Visit each slot once even if more than one revolution passed
+    if (tick - t >= TIMER_WHEEL_SIZE) t = tick - TIMER_WHEEL_SIZE + 1;
+
+    for (; t <= tick; t++) {
+        trudpTimerWheelNode *list = &tw->slots[t & (TIMER_WHEEL_SIZE - 1)];
+        trudpTimerWheelNode *node = list->next;
+        while (node != list) {
+            trudpTimerWheelNode *next = node->next;
+            if (node->deadline <= ts) {
+                trudpTimerWheelRemove(node);
+                _trudpTimerWheelLink(expired, node);
+            }
+            node = next;
+        }
+    }
+
+    // Current tick slot may keep nodes with deadline later in this tick
+    tw->current = tick;
+}
+
+/**
+ * Remove first node from list
+ *
+ * @param list Pointer to list head
+ *
+ * @return Pointer to trudpTimerWheelNode or NULL if list is empty
+ */
+trudpTimerWheelNode *trudpTimerWheelListPop(trudpTimerWheelNode *list) {
+
+    trudpTimerWheelNode *node = list->next;
+    if (node == list) return NULL;
+    trudpTimerWheelRemove(node);
+
+    return node;
+}
+
+/**
+ * Add node to the end of list. List of timers with the same delay keeps
+ * nodes in deadline order, so first node expires first
+ *
+ * @param list Pointer to list head
+ * @param node Pointer to trudpTimerWheelNode
+ * @param deadline Timer deadline
+ */
+void trudpTimerWheelListAdd(trudpTimerWheelNode *list,
+        trudpTimerWheelNode *node, uint64_t deadline) {
+
+    trudpTimerWheelRemove(node);
+    node->deadline = deadline;
+    _trudpTimerWheelLink(list, node);
+}
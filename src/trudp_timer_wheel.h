@@ -0,0 +1,83 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   trudp_timer_wheel.h
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Created on October 17, 2026, 4:40 PM
+ */
+
+#ifndef TRUDP_TIMER_WHEEL_H
+#define TRUDP_TIMER_WHEEL_H
+
+#include <stdlib.h>
+
+#include "teobase/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TIMER_WHEEL_SIZE 256 // Number of timer wheel slots, power of two
+#define TIMER_WHEEL_TICK 100000 // Timer wheel slot duration in microseconds
+
+/**
+ * Timer wheel node, embedded into the object which owns the timer
+ */
+typedef struct trudpTimerWheelNode {
+
+    struct trudpTimerWheelNode *next; ///< Next node or NULL if not linked
+    struct trudpTimerWheelNode *prev; ///< Previous node
+    uint64_t deadline;                ///< Timer deadline
+
+} trudpTimerWheelNode;
+
+/**
+ * Hashed timer wheel: node with deadline D is linked to slot
+ * (D / TIMER_WHEEL_TICK) % TIMER_WHEEL_SIZE. Deadlines longer than one
+ * wheel revolution stay in their slot until the deadline comes
+ */
+typedef struct trudpTimerWheel {
+
+    trudpTimerWheelNode slots[TIMER_WHEEL_SIZE]; ///< Slot list heads
+    uint64_t current; ///< Last processed tick
+
+} trudpTimerWheel;
+
+trudpTimerWheel *trudpTimerWheelNew(uint64_t ts);
+void trudpTimerWheelDestroy(trudpTimerWheel *tw);
+void trudpTimerWheelListInit(trudpTimerWheelNode *list);
+void trudpTimerWheelAdd(trudpTimerWheel *tw, trudpTimerWheelNode *node,
+        uint64_t deadline);
+void trudpTimerWheelRemove(trudpTimerWheelNode *node);
+void trudpTimerWheelExpire(trudpTimerWheel *tw, uint64_t ts,
+        trudpTimerWheelNode *expired);
+trudpTimerWheelNode *trudpTimerWheelListPop(trudpTimerWheelNode *list);
+void trudpTimerWheelListAdd(trudpTimerWheelNode *list,
+        trudpTimerWheelNode *node, uint64_t deadline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRUDP_TIMER_WHEEL_H */
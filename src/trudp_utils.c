@@ -47,19 +47,20 @@
 #endif
 
 /**
- * Make TR-UDP map key
+ * Make TR-UDP map key in buffer
  *
+ * @param buf Buffer to make key in, MAX_KEY_LENGTH bytes
  * @param addr String with IP address
  * @param port Port number
  * @param channel Cannel number 0-15
  * @param key_length [out] Pointer to keys length (may be NULL)
  *
- * @return Static buffer with key ip:port:channel
+ * @return Pointer to buf with key ip:port:channel
  */
-const char *trudpMakeKey(const char *addr, int port, int channel, size_t *key_length)
+const char *trudpMakeKeyBuf(char *buf, const char *addr, int port, int channel,
+        size_t *key_length)
 {
 
-    static char buf[MAX_KEY_LENGTH];
     memset(buf, 0, MAX_KEY_LENGTH);
     size_t kl = snprintf(buf, MAX_KEY_LENGTH, "%s:%u:%u", addr, (uint32_t)port,
                          (uint32_t)channel);
@@ -68,6 +69,23 @@ const char *trudpMakeKey(const char *addr, int port, int channel, size_t *key_le
     return buf;
 }
 
+/**
+ * Make TR-UDP map key
+ *
+ * @param addr String with IP address
+ * @param port Port number
+ * @param channel Cannel number 0-15
+ * @param key_length [out] Pointer to keys length (may be NULL)
+ *
+ * @return Static (thread local) buffer with key ip:port:channel
+ */
+const char *trudpMakeKey(const char *addr, int port, int channel, size_t *key_length)
+{
+
+    static TRUDP_THREAD_LOCAL char buf[MAX_KEY_LENGTH];
+    return trudpMakeKeyBuf(buf, addr, port, channel, key_length);
+}
+
 // \todo vformatMessage does not work under MinGW
 #define KSN_BUFFER_SM_SIZE 256; //2048;//256
 
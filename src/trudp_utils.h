@@ -38,11 +38,20 @@
 
 #include "teobase/types.h"
 
+// Thread local storage for static buffers (each thread may run own trudpData)
+#if defined(_MSC_VER)
+#define TRUDP_THREAD_LOCAL __declspec(thread)
+#else
+#define TRUDP_THREAD_LOCAL __thread
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 const char *trudpMakeKey(const char *addr, int port, int channel, size_t *key_length);
+const char *trudpMakeKeyBuf(char *buf, const char *addr, int port, int channel,
+        size_t *key_length);
 char *formatMessage(const char *fmt, ...);
 char *sformatMessage(char *str_to_free, const char *fmt, ...);
 struct timeval *usecToTv(struct timeval *tv, uint32_t usec);
@@ -66,6 +66,8 @@ extern trudpUdpDataReceivedCallback_t trudpOpt_STAT_udpDataReceivedCallback;
 // Local functions
 static void _trudpCallUdpDataSentCallback(int bytes_sent);
 static void _trudpCallUdpDataReceivedCallback(int bytes_received);
+static int _trudpUdpBindRaw(int *port, int allow_port_increment_f,
+        int reuseport);
 #ifdef RESERVED
 static int  _trudpUdpIsReadable(int sd, uint32_t timeOut);
 static int  _trudpUdpIsWritable(int sd, uint32_t timeOut);
@@ -278,6 +280,38 @@ success_bind:
  *         -1 - cannot create socket; -2 - can't bind on port
  */
 int trudpUdpBindRaw(int *port, int allow_port_increment_f) {
+    return _trudpUdpBindRaw(port, allow_port_increment_f, 0);
+}
+
+/**
+ * Create and bind UDP socket with SO_REUSEPORT option. Sockets bound to the
+ * same port with this function make reuseport group: kernel distributes
+ * received datagrams between them
+ *
+ * @param[in] port Port number
+ * @return File descriptor or error if return value < 0:
+ *         -1 - cannot create socket; -2 - can't bind on port
+ */
+int trudpUdpBindReuseport(int port) {
+    #if defined(SO_REUSEPORT)
+    return _trudpUdpBindRaw(&port, 0, 1);
+    #else
+    (void)port;
+    return -1;
+    #endif
+}
+
+/**
+ * Create and bind UDP socket
+ *
+ * @param[in,out] port Pointer to Port number
+ * @param[in] allow_port_increment_f Allow port increment flag
+ * @param[in] reuseport Set SO_REUSEPORT option before bind
+ * @return File descriptor or error if return value < 0:
+ *         -1 - cannot create socket; -2 - can't bind on port
+ */
+static int _trudpUdpBindRaw(int *port, int allow_port_increment_f,
+        int reuseport) {
     struct addrinfo hints;
     struct addrinfo *rp;
     struct addrinfo *res;
@@ -309,6 +343,15 @@ int trudpUdpBindRaw(int *port, int allow_port_increment_f) {
             fd = _trudpUdpSocket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
             if (fd == -1) continue;
 
+            #if defined(SO_REUSEPORT)
+            if (reuseport) {
+                int on = 1;
+                setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (void *)&on, sizeof(on));
+            }
+            #else
+            (void)reuseport;
+            #endif
+
             if (_trudpUdpBind(fd, rp->ai_addr, rp->ai_addrlen) == 0) {
 
                 int off = 0;
@@ -355,23 +398,61 @@ teosockRecvfromResult trudpUdpRecvfrom(
     teosockRecvfromResult recvfrom_result = teosockRecvfrom(fd, buffer, buffer_size, remaddr, addr_length, received_length, error);
 
     if (recvfrom_result == TEOSOCK_RECVFROM_DATA_RECEIVED) {
-        if (trudpOpt_DBG_dumpUdpData) {
-            char hexdump[32];
-            if (buffer != NULL && buffer_size > 0) {
-                dump_bytes(hexdump, sizeof(hexdump), buffer, *received_length);
-            } else {
-                strcpy(hexdump, "(null)");
-            }
+        trudpUdpDataReceived(buffer, *received_length, "recvfrom");
+    }
+
+    return recvfrom_result;
+}
+
+/**
+ * Dump received data (if enabled) and call received data statistic callback
+ *
+ * @param buffer Received data
+ * @param length Received data length
+ * @param func Name of receive function used in dump
+ */
+void trudpUdpDataReceived(const uint8_t *buffer, size_t length,
+        const char *func) {
 
-            LTRACK("TrUdp",
-                   "Received %u bytes using recvfrom() starting with %s",
-                   (uint32_t)(*received_length), hexdump);
+    if (trudpOpt_DBG_dumpUdpData) {
+        char hexdump[32];
+        if (buffer != NULL && length > 0) {
+            dump_bytes(hexdump, sizeof(hexdump), buffer, length);
+        } else {
+            strcpy(hexdump, "(null)");
         }
 
-        _trudpCallUdpDataReceivedCallback(*received_length);
+        LTRACK("TrUdp",
+               "Received %u bytes using %s() starting with %s",
+               (uint32_t)length, func, hexdump);
     }
 
-    return recvfrom_result;
+    _trudpCallUdpDataReceivedCallback(length);
+}
+
+/**
+ * Dump sent data (if enabled) and call sent data statistic callback
+ *
+ * @param buffer Sent data
+ * @param length Sent data length
+ * @param func Name of send function used in dump
+ */
+void trudpUdpDataSent(const uint8_t *buffer, size_t length,
+        const char *func) {
+
+    if (trudpOpt_DBG_dumpUdpData) {
+        char hexdump[32];
+        if (buffer != NULL && length > 0) {
+            dump_bytes(hexdump, sizeof(hexdump), buffer, length);
+        } else {
+            strcpy(hexdump, "(null)");
+        }
+
+        LTRACK("TrUdp", "Sent %u bytes using %s() starting with %s",
+               (uint32_t)length, func, hexdump);
+    }
+
+    _trudpCallUdpDataSentCallback(length);
 }
 
 #ifdef RESERVED
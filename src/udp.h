@@ -62,20 +62,92 @@
 #include "teobase/types.h"
 
 #include "trudp_api.h"
+#include "trudp_payload.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * Reusable buffers to receive batch of datagrams
+ */
+typedef struct trudpUdpRecvBatch {
+
+    size_t size;         ///< Number of buffers
+    size_t buffer_size;  ///< Size of each buffer
+    size_t count;        ///< Number of datagrams received by last call
+    uint8_t *buffers;    ///< Buffers, size * buffer_size bytes
+    size_t *lengths;     ///< Received datagrams lengths
+    struct sockaddr_storage *addrs; ///< Received datagrams remote addresses
+    socklen_t *addr_lengths; ///< Remote addresses lengths
+    size_t *segment_sizes; ///< UDP GRO segment size of coalesced datagrams (zero if not coalesced)
+    void *msgs;          ///< Message headers (struct mmsghdr on Linux)
+    void *iovs;          ///< Message buffers (struct iovec on Linux)
+    void *cmsgs;         ///< Control messages buffers (Linux)
+    int no_mmsg;         ///< Set if recvmmsg is not supported by kernel
+
+} trudpUdpRecvBatch;
+
+/**
+ * Buffers to collect outgoing datagrams and send them at once
+ */
+typedef struct trudpUdpSendBatch {
+
+    size_t size;         ///< Number of buffers
+    size_t buffer_size;  ///< Size of each buffer
+    size_t count;        ///< Number of datagrams in batch
+    uint64_t started;    ///< Time when first datagram was added to batch
+    uint8_t *buffers;    ///< Buffers, size * buffer_size bytes
+    size_t *lengths;     ///< Datagrams lengths
+    trudpPayload **payloads; ///< Shared payloads sent after buffers data (NULL if whole datagram is in buffer)
+    struct sockaddr_storage *addrs; ///< Datagrams remote addresses
+    socklen_t *addr_lengths; ///< Remote addresses lengths
+    void *msgs;          ///< Message headers (struct mmsghdr on Linux)
+    void *iovs;          ///< Message buffers (struct iovec on Linux, two per datagram)
+    size_t *msg_datagrams; ///< Number of datagrams in each message (Linux)
+    void *cmsgs;         ///< Control messages buffers (Linux)
+    int gso;             ///< Coalesce same size datagrams for one peer with UDP GSO
+    int no_mmsg;         ///< Set if sendmmsg is not supported by kernel
+
+} trudpUdpSendBatch;
+
 TRUDP_API ssize_t trudpUdpSendto(int fd, const uint8_t* buffer, size_t buffer_size,
         __CONST_SOCKADDR_ARG remaddr, socklen_t addr_length);
 TRUDP_API int trudpUdpBindRaw(int *port, int allow_port_increment_f);
+TRUDP_API int trudpUdpBindReuseport(int port);
 TRUDP_API int trudpUdpBindRaw_cli(const char* addr, int *port, int allow_port_increment_f);
 TRUDP_API const char *trudpUdpGetAddr(__CONST_SOCKADDR_ARG remaddr, socklen_t remaddr_len, int *port);
 
 TRUDP_API teosockRecvfromResult trudpUdpRecvfrom(
     int fd, uint8_t *buffer, size_t buffer_size, __SOCKADDR_ARG remaddr,
     socklen_t *addr_length, size_t *received_length, int *error);
+void trudpUdpDataReceived(const uint8_t *buffer, size_t length,
+    const char *func);
+TRUDP_API int trudpUdpSetGRO(int fd, int enable);
+TRUDP_API int trudpUdpCheckGSO(int fd);
+TRUDP_API trudpUdpRecvBatch *trudpUdpRecvBatchNew(size_t size,
+    size_t buffer_size);
+TRUDP_API void trudpUdpRecvBatchDestroy(trudpUdpRecvBatch *batch);
+TRUDP_API int trudpUdpRecvBatchReceive(int fd, trudpUdpRecvBatch *batch,
+    size_t max_packets);
+void trudpUdpDataSent(const uint8_t *buffer, size_t length,
+    const char *func);
+TRUDP_API trudpUdpSendBatch *trudpUdpSendBatchNew(size_t size,
+    size_t buffer_size);
+TRUDP_API void trudpUdpSendBatchDestroy(trudpUdpSendBatch *batch);
+TRUDP_API int trudpUdpSendBatchAdd(trudpUdpSendBatch *batch,
+    const uint8_t *buffer, size_t buffer_size, const struct sockaddr *remaddr,
+    socklen_t addr_length, uint64_t ts);
+TRUDP_API int trudpUdpSendBatchAddPayload(trudpUdpSendBatch *batch,
+    const uint8_t *buffer, size_t buffer_size, trudpPayload *payload,
+    const struct sockaddr *remaddr, socklen_t addr_length, uint64_t ts);
+TRUDP_API int trudpUdpSendBatchFlush(int fd, trudpUdpSendBatch *batch);
+#if defined(TEONET_OS_LINUX)
+#define UDP_GSO_MAX_SEGMENTS 64 // Kernel UDP_MAX_SEGMENTS
+#define UDP_GSO_MAX_LENGTH 65000 // Maximum length of coalesced datagram
+unsigned int trudpUdpSendBatchMakeMsgs(trudpUdpSendBatch *batch,
+    size_t first, size_t count);
+#endif
 TRUDP_API int trudpUdpMakeAddr(const char *addr, int port, __SOCKADDR_ARG remaddr, socklen_t *len);
 TRUDP_API void trudpUdpSetNonblock(int fd); // deprecated
 
@@ -0,0 +1,562 @@
+/*
+ * The MIT License
+ *
+ * Copyright 2016-2020 Kirill Scherba <kirill@scherba.ru>.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * \file   udp_batch.c
+ * \author Kirill Scherba <kirill@scherba.ru>
+ *
+ * Receive and send batches of UDP datagrams with one recvmmsg / sendmmsg
+ * call (Linux) or with recvfrom / sendto loop on other platforms. On Linux
+ * same size datagrams for one peer may be coalesced with UDP GSO and
+ * coalesced datagrams may be received with UDP GRO.
+ *
+ * Created on October 17, 2026, 6:05 PM
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+// For recvmmsg
+#define _GNU_SOURCE
+#endif
+
+#include "teobase/platform.h" // For TEONET_OS_x
+
+#include "udp.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "teobase/socket.h"
+
+#if defined(TEONET_OS_LINUX)
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103 // Set GSO segmentation size
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104 // Receive coalesced datagrams with GRO
+#endif
+
+#define UDP_BATCH_CMSG_SIZE CMSG_SPACE(sizeof(int)) // UDP_SEGMENT / UDP_GRO
+#endif
+
+/**
+ * Enable or disable receiving coalesced datagrams (UDP GRO) on socket.
+ * Coalesced datagrams are split back by trudpUdpRecvBatchReceive only, so
+ * GRO should be enabled on sockets read with it
+ *
+ * @param fd Socket descriptor
+ * @param enable Enable if true
+ *
+ * @return Zero at success or -1 if GRO is not supported
+ */
+int trudpUdpSetGRO(int fd, int enable) {
+    #if defined(TEONET_OS_LINUX)
+    int val = enable ? 1 : 0;
+    return setsockopt(fd, SOL_UDP, UDP_GRO, &val, sizeof(val)) ? -1 : 0;
+    #else
+    (void)fd;
+    return enable ? -1 : 0;
+    #endif
+}
+
+/**
+ * Check that socket supports sending coalesced datagrams (UDP GSO)
+ *
+ * @param fd Socket descriptor
+ *
+ * @return Zero if GSO is supported or -1 if not
+ */
+int trudpUdpCheckGSO(int fd) {
+    #if defined(TEONET_OS_LINUX)
+    int val = 0;
+    socklen_t len = sizeof(val);
+    return getsockopt(fd, SOL_UDP, UDP_SEGMENT, &val, &len) ? -1 : 0;
+    #else
+    (void)fd;
+    return -1;
+    #endif
+}
+
+/**
+ * Create batch of receive buffers
+ *
+ * @param size Number of buffers
+ * @param buffer_size Size of each buffer
+ *
+ * @return Pointer to trudpUdpRecvBatch or NULL at error
+ */
+trudpUdpRecvBatch *trudpUdpRecvBatchNew(size_t size, size_t buffer_size) {
+
+    trudpUdpRecvBatch *batch = (trudpUdpRecvBatch *)calloc(1,
+            sizeof(trudpUdpRecvBatch));
+    if (batch == NULL) return NULL;
+
+    batch->size = size;
+    batch->buffer_size = buffer_size;
+    batch->buffers = (uint8_t *)malloc(size * buffer_size);
+    batch->lengths = (size_t *)calloc(size, sizeof(size_t));
+    batch->addrs = (struct sockaddr_storage *)calloc(size,
+            sizeof(struct sockaddr_storage));
+    batch->addr_lengths = (socklen_t *)calloc(size, sizeof(socklen_t));
+    batch->segment_sizes = (size_t *)calloc(size, sizeof(size_t));
+    #if defined(TEONET_OS_LINUX)
+    batch->msgs = calloc(size, sizeof(struct mmsghdr));
+    batch->iovs = calloc(size, sizeof(struct iovec));
+    batch->cmsgs = calloc(size, UDP_BATCH_CMSG_SIZE);
+    if (batch->msgs == NULL || batch->iovs == NULL || batch->cmsgs == NULL) {
+        trudpUdpRecvBatchDestroy(batch);
+        return NULL;
+    }
+    #endif
+    if (batch->buffers == NULL || batch->lengths == NULL ||
+            batch->addrs == NULL || batch->addr_lengths == NULL ||
+            batch->segment_sizes == NULL) {
+        trudpUdpRecvBatchDestroy(batch);
+        return NULL;
+    }
+
+    return batch;
+}
+
+/**
+ * Destroy batch of receive buffers
+ *
+ * @param batch Pointer to trudpUdpRecvBatch
+ */
+void trudpUdpRecvBatchDestroy(trudpUdpRecvBatch *batch) {
+    if (batch) {
+        free(batch->buffers);
+        free(batch->lengths);
+        free(batch->addrs);
+        free(batch->addr_lengths);
+        free(batch->segment_sizes);
+        free(batch->msgs);
+        free(batch->iovs);
+        free(batch->cmsgs);
+        free(batch);
+    }
+}
+
+/**
+ * Receive up to max_packets datagrams to batch buffers. Uses one recvmmsg
+ * call on Linux and falls back to recvfrom loop on other platforms or if
+ * recvmmsg is not supported by kernel. If datagram was coalesced by UDP GRO
+ * its segment size is stored in batch->segment_sizes
+ *
+ * @param fd Socket descriptor
+ * @param batch Pointer to trudpUdpRecvBatch
+ * @param max_packets Maximum number of datagrams to receive (limited by
+ *        batch size)
+ *
+ * @return Number of received datagrams (stored in batch->count), zero if
+ *         there is no data or -1 on error
+ */
+int trudpUdpRecvBatchReceive(int fd, trudpUdpRecvBatch *batch,
+        size_t max_packets) {
+
+    size_t i;
+    if (max_packets == 0 || max_packets > batch->size) {
+        max_packets = batch->size;
+    }
+    batch->count = 0;
+
+    #if defined(TEONET_OS_LINUX)
+    if (!batch->no_mmsg) {
+        struct mmsghdr *msgs = (struct mmsghdr *)batch->msgs;
+        struct iovec *iovs = (struct iovec *)batch->iovs;
+        for (i = 0; i < max_packets; i++) {
+            iovs[i].iov_base = batch->buffers + i * batch->buffer_size;
+            iovs[i].iov_len = batch->buffer_size;
+            memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &batch->addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(batch->addrs[i]);
+            msgs[i].msg_hdr.msg_control =
+                    (char *)batch->cmsgs + i * UDP_BATCH_CMSG_SIZE;
+            msgs[i].msg_hdr.msg_controllen = UDP_BATCH_CMSG_SIZE;
+        }
+
+        int rv = recvmmsg(fd, msgs, (unsigned int)max_packets, MSG_DONTWAIT,
+                NULL);
+        if (rv < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                return 0;
+            }
+            if (errno != ENOSYS) return -1;
+            batch->no_mmsg = 1; // Use recvfrom from now on
+        }
+        else {
+            for (i = 0; i < (size_t)rv; i++) {
+                batch->lengths[i] = msgs[i].msg_len;
+                batch->addr_lengths[i] = msgs[i].msg_hdr.msg_namelen;
+                batch->segment_sizes[i] = 0;
+                struct cmsghdr *cmsg;
+                for (cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg;
+                        cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg)) {
+                    if (cmsg->cmsg_level == SOL_UDP &&
+                            cmsg->cmsg_type == UDP_GRO) {
+                        int segment_size;
+                        memcpy(&segment_size, CMSG_DATA(cmsg),
+                                sizeof(segment_size));
+                        if (segment_size > 0 &&
+                                (size_t)segment_size < msgs[i].msg_len) {
+                            batch->segment_sizes[i] = segment_size;
+                        }
+                    }
+                }
+                trudpUdpDataReceived(batch->buffers + i * batch->buffer_size,
+                        msgs[i].msg_len, "recvmmsg");
+            }
+            batch->count = (size_t)rv;
+            return rv;
+        }
+    }
+    #endif
+
+    for (i = 0; i < max_packets; i++) {
+        int error_code = 0;
+        batch->addr_lengths[i] = sizeof(batch->addrs[i]);
+        batch->segment_sizes[i] = 0;
+        teosockRecvfromResult result = trudpUdpRecvfrom(fd,
+                batch->buffers + i * batch->buffer_size, batch->buffer_size,
+                (struct sockaddr *)&batch->addrs[i], &batch->addr_lengths[i],
+                &batch->lengths[i], &error_code);
+        if (result == TEOSOCK_RECVFROM_TRY_AGAIN) break;
+        if (result != TEOSOCK_RECVFROM_DATA_RECEIVED) {
+            if (i == 0) return -1;
+            break;
+        }
+    }
+    batch->count = i;
+
+    return (int)i;
+}
+
+/**
+ * Create batch of send buffers
+ *
+ * @param size Number of buffers
+ * @param buffer_size Size of each buffer
+ *
+ * @return Pointer to trudpUdpSendBatch or NULL at error
+ */
+trudpUdpSendBatch *trudpUdpSendBatchNew(size_t size, size_t buffer_size) {
+
+    trudpUdpSendBatch *batch = (trudpUdpSendBatch *)calloc(1,
+            sizeof(trudpUdpSendBatch));
+    if (batch == NULL) return NULL;
+
+    batch->size = size;
+    batch->buffer_size = buffer_size;
+    batch->buffers = (uint8_t *)malloc(size * buffer_size);
+    batch->lengths = (size_t *)calloc(size, sizeof(size_t));
+    batch->payloads = (trudpPayload **)calloc(size, sizeof(trudpPayload *));
+    batch->addrs = (struct sockaddr_storage *)calloc(size,
+            sizeof(struct sockaddr_storage));
+    batch->addr_lengths = (socklen_t *)calloc(size, sizeof(socklen_t));
+    #if defined(TEONET_OS_LINUX)
+    batch->msgs = calloc(size, sizeof(struct mmsghdr));
+    batch->iovs = calloc(2 * size, sizeof(struct iovec));
+    batch->msg_datagrams = (size_t *)calloc(size, sizeof(size_t));
+    batch->cmsgs = calloc(size, UDP_BATCH_CMSG_SIZE);
+    if (batch->msgs == NULL || batch->iovs == NULL ||
+            batch->msg_datagrams == NULL || batch->cmsgs == NULL) {
+        trudpUdpSendBatchDestroy(batch);
+        return NULL;
+    }
+    #endif
+    if (batch->buffers == NULL || batch->lengths == NULL ||
+            batch->payloads == NULL || batch->addrs == NULL ||
+            batch->addr_lengths == NULL) {
+        trudpUdpSendBatchDestroy(batch);
+        return NULL;
+    }
+
+    return batch;
+}
+
+/**
+ * Destroy batch of send buffers. Datagrams which were not flushed are
+ * dropped
+ *
+ * @param batch Pointer to trudpUdpSendBatch
+ */
+void trudpUdpSendBatchDestroy(trudpUdpSendBatch *batch) {
+    if (batch) {
+        size_t i;
+        for (i = 0; batch->payloads && i < batch->count; i++) {
+            trudpPayloadRelease(batch->payloads[i]);
+        }
+        free(batch->buffers);
+        free(batch->lengths);
+        free(batch->payloads);
+        free(batch->addrs);
+        free(batch->addr_lengths);
+        free(batch->msgs);
+        free(batch->iovs);
+        free(batch->msg_datagrams);
+        free(batch->cmsgs);
+        free(batch);
+    }
+}
+
+/**
+ * Copy datagram to send batch
+ *
+ * @param batch Pointer to trudpUdpSendBatch
+ * @param buffer Datagram to send
+ * @param buffer_size Datagram length
+ * @param remaddr Remote address to send to
+ * @param addr_length The length of @a remaddr argument
+ * @param ts Current time (used to set batch started time)
+ *
+ * @return Zero at success or -1 if batch is full or datagram does not fit
+ *         batch buffer (datagram is not added)
+ */
+int trudpUdpSendBatchAdd(trudpUdpSendBatch *batch, const uint8_t *buffer,
+        size_t buffer_size, const struct sockaddr *remaddr,
+        socklen_t addr_length, uint64_t ts) {
+
+    return trudpUdpSendBatchAddPayload(batch, buffer, buffer_size, NULL,
+            remaddr, addr_length, ts);
+}
+
+/**
+ * Add datagram which data is in buffer followed by shared payload to send
+ * batch. Buffer is copied, payload is referenced and sent by sendmmsg scatter
+ * gather I/O without copy (it is copied if sendmmsg is not available)
+ *
+ * @param batch Pointer to trudpUdpSendBatch
+ * @param buffer Datagram beginning (packet header)
+ * @param buffer_size Length of datagram beginning
+ * @param payload Pointer to trudpPayload sent after buffer or NULL
+ * @param remaddr Remote address to send to
+ * @param addr_length The length of @a remaddr argument
+ * @param ts Current time (used to set batch started time)
+ *
+ * @return Zero at success or -1 if batch is full or datagram does not fit
+ *         batch buffer (datagram is not added)
+ */
+int trudpUdpSendBatchAddPayload(trudpUdpSendBatch *batch,
+        const uint8_t *buffer, size_t buffer_size, trudpPayload *payload,
+        const struct sockaddr *remaddr, socklen_t addr_length, uint64_t ts) {
+
+    size_t length = buffer_size + (payload ? payload->length : 0);
+    if (batch->count >= batch->size || length > batch->buffer_size ||
+            addr_length > (socklen_t)sizeof(struct sockaddr_storage)) {
+        return -1;
+    }
+
+    size_t i = batch->count++;
+    uint8_t *datagram = batch->buffers + i * batch->buffer_size;
+    memcpy(datagram, buffer, buffer_size);
+    batch->payloads[i] = NULL;
+    if (payload) {
+        #if defined(TEONET_OS_LINUX)
+        if (!batch->no_mmsg) batch->payloads[i] = trudpPayloadRef(payload);
+        #endif
+        if (batch->payloads[i] == NULL) {
+            memcpy(datagram + buffer_size, payload->data, payload->length);
+        }
+    }
+    memcpy(&batch->addrs[i], remaddr, addr_length);
+    batch->lengths[i] = length;
+    batch->addr_lengths[i] = addr_length;
+    if (i == 0) batch->started = ts;
+
+    return 0;
+}
+
+#if defined(TEONET_OS_LINUX)
+/**
+ * Fill sendmmsg message headers (batch->msgs) for datagrams from first to
+ * count. If GSO is enabled consecutive datagrams for the same peer with the
+ * same length (the last one may be shorter) are coalesced to one message
+ *
+ * @param batch Pointer to trudpUdpSendBatch
+ * @param first First datagram
+ * @param count Number of datagrams in batch
+ *
+ * @return Number of messages
+ */
+unsigned int trudpUdpSendBatchMakeMsgs(trudpUdpSendBatch *batch,
+        size_t first, size_t count) {
+
+    struct mmsghdr *msgs = (struct mmsghdr *)batch->msgs;
+    struct iovec *iovs = (struct iovec *)batch->iovs;
+    unsigned int m = 0;
+    size_t i = first, j, k, n = 0;
+
+    while (i < count) {
+        size_t length = batch->lengths[i], total = length;
+
+        // Find datagrams to coalesce
+        for (j = i + 1; batch->gso && j < count &&
+                j - i < UDP_GSO_MAX_SEGMENTS &&
+                total + batch->lengths[j] <= UDP_GSO_MAX_LENGTH &&
+                batch->lengths[j] <= length &&
+                batch->addr_lengths[j] == batch->addr_lengths[i] &&
+                !memcmp(&batch->addrs[j], &batch->addrs[i],
+                        batch->addr_lengths[i]); j++) {
+            total += batch->lengths[j];
+            if (batch->lengths[j] < length) { j++; break; } // Last segment
+        }
+
+        // Shared payload is the second buffer of datagram
+        struct iovec *iov = &iovs[n];
+        for (k = i; k < j; k++) {
+            trudpPayload *payload = batch->payloads[k];
+            size_t payload_length = payload ? payload->length : 0;
+            iovs[n].iov_base = batch->buffers + k * batch->buffer_size;
+            iovs[n++].iov_len = batch->lengths[k] - payload_length;
+            if (payload) {
+                iovs[n].iov_base = payload->data;
+                iovs[n++].iov_len = payload_length;
+            }
+        }
+        memset(&msgs[m], 0, sizeof(msgs[m]));
+        msgs[m].msg_hdr.msg_iov = iov;
+        msgs[m].msg_hdr.msg_iovlen = &iovs[n] - iov;
+        batch->msg_datagrams[m] = j - i;
+        msgs[m].msg_hdr.msg_name = &batch->addrs[i];
+        msgs[m].msg_hdr.msg_namelen = batch->addr_lengths[i];
+        if (j - i > 1) {
+            msgs[m].msg_hdr.msg_control =
+                    (char *)batch->cmsgs + m * UDP_BATCH_CMSG_SIZE;
+            msgs[m].msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msgs[m].msg_hdr);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t segment_size = (uint16_t)length;
+            memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+        }
+        m++;
+        i = j;
+    }
+
+    return m;
+}
+#endif
+
+/**
+ * Send datagrams of batch
+ *
+ * @param fd Socket descriptor
+ * @param batch Pointer to trudpUdpSendBatch
+ * @param count Number of datagrams in batch
+ *
+ * @return Number of sent datagrams or -1 on error
+ */
+static int _trudpUdpSendBatchSend(int fd, trudpUdpSendBatch *batch,
+        size_t count) {
+
+    size_t i = 0;
+    int sent = 0;
+
+    #if defined(TEONET_OS_LINUX)
+    if (!batch->no_mmsg) {
+        struct mmsghdr *msgs = (struct mmsghdr *)batch->msgs;
+
+        // Send rest of batch after partial send
+        i = 0;
+        while (i < count) {
+            unsigned int m = trudpUdpSendBatchMakeMsgs(batch, i, count);
+            int rv = sendmmsg(fd, msgs, m, MSG_DONTWAIT);
+            if (rv < 0 && errno == ENOSYS && i == 0) {
+                batch->no_mmsg = 1; // Use sendto from now on
+                break;
+            }
+            if (rv < 0 && batch->gso && (errno == EIO || errno == EINVAL)) {
+                batch->gso = 0; // Kernel or device can't segment, resend
+                continue;
+            }
+            if (rv <= 0) {
+                // Drop rest of batch
+                return sent > 0 ? sent : (rv < 0 ? -1 : 0);
+            }
+            int k;
+            for (k = 0; k < rv; k++) {
+                size_t n;
+                for (n = 0; n < msgs[k].msg_hdr.msg_iovlen; n++) {
+                    struct iovec *iov = &msgs[k].msg_hdr.msg_iov[n];
+                    trudpUdpDataSent(iov->iov_base, iov->iov_len,
+                            "sendmmsg");
+                }
+                i += batch->msg_datagrams[k];
+                sent += (int)batch->msg_datagrams[k];
+            }
+        }
+        if (!batch->no_mmsg) return sent;
+    }
+    #endif
+
+    for (i = 0; i < count; i++) {
+        trudpPayload *payload = batch->payloads[i];
+        if (payload) {
+            // Join shared payload to datagram buffer
+            memcpy(batch->buffers + i * batch->buffer_size +
+                    batch->lengths[i] - payload->length, payload->data,
+                    payload->length);
+        }
+        ssize_t rv = trudpUdpSendto(fd,
+                batch->buffers + i * batch->buffer_size, batch->lengths[i],
+                (const struct sockaddr *)&batch->addrs[i],
+                batch->addr_lengths[i]);
+        if (rv >= 0) sent++;
+    }
+
+    return sent;
+}
+
+/**
+ * Send all datagrams collected in batch and empty the batch. Datagrams which
+ * can't be sent now (socket buffer is full) are dropped as UDP does
+ *
+ * @param fd Socket descriptor
+ * @param batch Pointer to trudpUdpSendBatch
+ *
+ * @return Number of sent datagrams or -1 on error
+ */
+int trudpUdpSendBatchFlush(int fd, trudpUdpSendBatch *batch) {
+
+    size_t i, count = batch->count;
+    batch->count = 0;
+    if (count == 0) return 0;
+
+    int sent = _trudpUdpSendBatchSend(fd, batch, count);
+
+    // Release payloads of sent and dropped datagrams
+    for (i = 0; i < count; i++) {
+        trudpPayloadRelease(batch->payloads[i]);
+        batch->payloads[i] = NULL;
+    }
+
+    return sent;
+}
@@ -40,6 +40,7 @@
 trudpWriteQueue *trudpWriteQueueNew() {
     trudpWriteQueue *wq = (trudpWriteQueue *)malloc(sizeof(trudpWriteQueue));
     wq->q = teoQueueNew();
+    wq->bytes = 0;
     return wq;
 }
 
@@ -51,6 +52,7 @@ trudpWriteQueue *trudpWriteQueueNew() {
 
 void trudpWriteQueueDestroy(trudpWriteQueue *wq) {
     if(wq) {
+        trudpWriteQueueFree(wq);
         teoQueueDestroy(wq->q);
         free(wq);
     }
@@ -64,7 +66,17 @@ void trudpWriteQueueDestroy(trudpWriteQueue *wq) {
  */
 
 int trudpWriteQueueFree(trudpWriteQueue *wq) {
-    return wq && wq->q ? teoQueueFree(wq->q) : -1;
+    if(!wq || !wq->q) return -1;
+
+    // Free packets buffers and payloads owned by queue
+    trudpWriteQueueData *wqd;
+    while((wqd = trudpWriteQueueGetFirst(wq))) {
+        free(wqd->packet_ptr);
+        trudpPayloadRelease(wqd->payload);
+        trudpWriteQueueDeleteFirst(wq);
+    }
+
+    return 0;
 }
 
 /**
@@ -79,6 +91,18 @@ size_t trudpWriteQueueSize(trudpWriteQueue *wq) {
     return wq ? teoQueueSize(wq->q) : -1;
 }
 
+/**
+ * Get length of all packets in Write queue
+ *
+ * @param wq Pointer to trudpWriteQueue
+ *
+ * @return Length of all packets in Write queue (bytes)
+ */
+
+size_t trudpWriteQueueBytes(trudpWriteQueue *wq) {
+    return wq ? wq->bytes : 0;
+}
+
 /**
  * Get pointer to first element data
  *
@@ -99,6 +123,8 @@ trudpWriteQueueData *trudpWriteQueueGetFirst(trudpWriteQueue *wq) {
  * @return Zero at success
  */
 int trudpWriteQueueDeleteFirst(trudpWriteQueue *wq) {
+    trudpWriteQueueData *wqd = trudpWriteQueueGetFirst(wq);
+    if (wqd) wq->bytes -= wqd->packet_length;
     return teoQueueDeleteFirst(wq->q);
 }
 
@@ -127,7 +153,33 @@ trudpWriteQueueData *trudpWriteQueueAdd(trudpWriteQueue *wq, void *packet,
         memset(wqd->packet, 0, MAX_HEADER_SIZE);
         wqd->packet_ptr = packet_ptr;
     }
+    wqd->payload = NULL;
+    wqd->deadline = 0;
     wqd->packet_length = packet_length;
+    wq->bytes += packet_length;
+
+    return wqd;
+}
+
+/**
+ * Add packet with shared payload to Write queue: element keeps packet header
+ * and takes the payload reference
+ *
+ * @param wq Pointer to trudpWriteQueue
+ * @param packet Pointer to packet header
+ * @param header_length Packet header length
+ * @param payload Pointer to trudpPayload
+ *
+ * @return Pointer to added trudpWriteQueueData
+ */
+trudpWriteQueueData *trudpWriteQueueAddPayload(trudpWriteQueue *wq,
+        void *packet, size_t header_length, trudpPayload *payload) {
+
+    trudpWriteQueueData *wqd = trudpWriteQueueAdd(wq, packet, NULL,
+            header_length);
+    wqd->payload = payload;
+    wqd->packet_length += payload->length;
+    wq->bytes += payload->length;
 
     return wqd;
 }
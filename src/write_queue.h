@@ -34,6 +34,8 @@
 
 #include "teoccl/queue.h"
 
+#include "trudp_payload.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -43,6 +45,7 @@ extern "C" {
 typedef struct trudpWriteQueue {
 
     teoQueue *q;
+    size_t bytes; ///< Length of all packets in queue
 
 } trudpWriteQueue;
 
@@ -51,6 +54,8 @@ typedef struct trudpWriteQueueData {
     char packet[MAX_HEADER_SIZE];
     uint16_t packet_length;
     void *packet_ptr;
+    trudpPayload *payload; ///< Shared payload sent after header in packet or NULL
+    uint64_t deadline; ///< Time when packet expires, zero if packet does not expire
 
 } trudpWriteQueueData;
 
@@ -89,8 +94,20 @@ int trudpWriteQueueFree(trudpWriteQueue *wq);
 
 size_t trudpWriteQueueSize(trudpWriteQueue *wq);
 
+/**
+ * Get length of all packets in Write queue
+ *
+ * @param wq Pointer to trudpWriteQueue
+ *
+ * @return Length of all packets in Write queue (bytes)
+ */
+
+size_t trudpWriteQueueBytes(trudpWriteQueue *wq);
+
 trudpWriteQueueData *trudpWriteQueueAdd(trudpWriteQueue *wq, void *packet,
         void *packet_ptr, size_t packet_length);
+trudpWriteQueueData *trudpWriteQueueAddPayload(trudpWriteQueue *wq,
+        void *packet, size_t header_length, trudpPayload *payload);
 /**
  * Get pointer to first element data
  *
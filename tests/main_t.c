@@ -32,8 +32,13 @@
 #include "packet.h"
 #include "packet_queue.h"
 #include "trudp.h"
+#include "trudp_channel_index.h"
 #include "trudp_stat.h"
 
+#if defined(TEONET_OS_LINUX)
+#include "trudp_shards.h"
+#endif
+
 CHEAT_DECLARE(
     static void CheckPacketIsCorrect(uint8_t *packet_data,
                                                size_t packet_data_length,
@@ -113,6 +118,66 @@ CHEAT_TEST(create_ack_packet,
     trudpPacketCreatedFree(packet); trudpPacketCreatedFree(ack_packet);
 )
 
+CHEAT_TEST(create_packet_in_buffer,
+    // Packet test data.
+    char *packet_payload_string = "Header with Hello!";
+    size_t packet_payload_size = strlen(packet_payload_string) + 1;
+    uint32_t packet_id = 7; unsigned int channel = 3;
+
+    // Create DATA packet in buffer.
+    char packet_buffer[TRUDP_MAX_PACKET_LENGTH];
+    size_t packet_size = trudpPacketDATAcreate(packet_buffer, packet_id,
+                                               channel, packet_payload_string,
+                                               packet_payload_size);
+    cheat_assert(packet_size == TRUDP_HEADER_LENGTH + packet_payload_size);
+    CheckPacketIsCorrect((uint8_t *)packet_buffer, packet_size, packet_id);
+    cheat_yield(); // Exit test if packet is not correct.
+
+    // Create DATA packet with payload already placed in buffer.
+    trudpPacket *packet = (trudpPacket *)packet_buffer;
+    size_t packet_in_place_size = trudpPacketDATAcreate(packet_buffer,
+                                                        packet_id + 1, channel,
+                                                        trudpPacketGetData(packet),
+                                                        packet_payload_size);
+    cheat_assert(packet_in_place_size == packet_size);
+    CheckPacketIsCorrect((uint8_t *)packet_buffer, packet_size, packet_id + 1);
+    cheat_assert(!strcmp(trudpPacketGetData(packet), packet_payload_string));
+
+    // Create ACK packet in buffer.
+    char ack_packet_buffer[TRUDP_HEADER_LENGTH];
+    size_t ack_packet_size = trudpPacketACKcreate(ack_packet_buffer, packet);
+    cheat_assert(ack_packet_size == trudpPacketACKlength());
+    CheckPacketIsCorrect((uint8_t *)ack_packet_buffer, ack_packet_size,
+                         packet_id + 1);
+    cheat_assert(trudpPacketGetType((trudpPacket *)ack_packet_buffer) ==
+                 TRU_ACK);
+
+    // Plain ACK has not selective acknowledgement
+    trudpSack sack, sack_got;
+    cheat_assert(trudpPacketACKgetSack((trudpPacket *)ack_packet_buffer,
+                                       &sack_got) == -1);
+
+    // Create ACK with selective acknowledgement in buffer.
+    char sack_packet_buffer[TRUDP_SACK_MAX_LENGTH];
+    sack.cumulative = 5;
+    sack.num = 2;
+    sack.range[0].first = 7; sack.range[0].last = 9;
+    sack.range[1].first = 12; sack.range[1].last = 12;
+    size_t sack_packet_size = trudpPacketACKcreateSack(sack_packet_buffer,
+                                                       packet, &sack);
+    cheat_assert(sack_packet_size == TRUDP_HEADER_LENGTH + 4 + 2 * 8);
+    CheckPacketIsCorrect((uint8_t *)sack_packet_buffer, sack_packet_size,
+                         packet_id + 1);
+    cheat_assert(trudpPacketGetType((trudpPacket *)sack_packet_buffer) ==
+                 TRU_ACK);
+    cheat_assert(!trudpPacketACKgetSack((trudpPacket *)sack_packet_buffer,
+                                        &sack_got));
+    cheat_assert(sack_got.cumulative == 5 && sack_got.num == 2);
+    cheat_assert(sack_got.range[0].first == 7 && sack_got.range[0].last == 9);
+    cheat_assert(sack_got.range[1].first == 12 &&
+                 sack_got.range[1].last == 12);
+)
+
 CHEAT_TEST(create_reset_packet,
     // Packet test data.
     uint32_t packet_id = 2;
@@ -215,6 +280,1463 @@ CHEAT_TEST(packet_queue,
     trudpPacketQueueDestroy(tq);
 )
 
+CHEAT_TEST(send_queue,
+    // Create send queue
+    trudpSendQueue *sq = trudpSendQueueNew();
+
+    // Add packets with id gap, enough to grow the ring
+    uint32_t id, first_id = 0xFFFFFF00;
+    size_t packet_size;
+    for (id = first_id; id != 200; id++) {
+        if (id == first_id + 10 || id == 0) continue; // Not sent ids
+        trudpPacket *packet = trudpPacketDATAcreateNew(id, 0,
+                (void *)"Hello", 6, &packet_size);
+        cheat_assert(trudpSendQueueAdd(sq, packet, packet_size, id) != NULL);
+        trudpPacketCreatedFree(packet);
+    }
+    cheat_assert(trudpSendQueueSize(sq) == 454);
+    cheat_assert(trudpSendQueueFindById(sq, first_id + 10) == NULL);
+    cheat_assert(trudpSendQueueFindById(sq, 0) == NULL);
+    cheat_assert(trudpSendQueueFindById(sq, 200) == NULL);
+
+    // Acknowledge every odd packet
+    for (id = first_id; id != 200; id++) {
+        trudpSendQueueData *sqd = trudpSendQueueFindById(sq, id);
+        if (id == first_id + 10 || id == 0) continue;
+        cheat_assert(sqd != NULL);
+        cheat_yield();
+        cheat_assert(trudpPacketGetId(trudpSendQueueDataGetPacket(sqd)) == id);
+        if (id % 2) cheat_assert(trudpSendQueueDelete(sq, sqd) == 0);
+    }
+    cheat_assert(trudpSendQueueSize(sq) == 226);
+
+    // Rest packets are iterated in id order
+    size_t n = 0;
+    trudpSendQueueData *sqd = trudpSendQueueGetFirst(sq);
+    for (; sqd; sqd = trudpSendQueueGetNext(sq, sqd), n++) {
+        cheat_assert(sqd->expected_time % 2 == 0);
+    }
+    cheat_assert(n == 226);
+
+    // Queue expected time is minimal expected time of its packets
+    cheat_assert(trudpSendQueueGetExpectedTime(sq) == 2);
+    trudpSendQueueSetExpectedTime(sq, trudpSendQueueFindById(sq, 2), 1000);
+    cheat_assert(trudpSendQueueGetExpectedTime(sq) == 4);
+    trudpSendQueueSetExpectedTime(sq, trudpSendQueueGetFirst(sq), 3);
+    cheat_assert(trudpSendQueueGetExpectedTime(sq) == 3);
+    trudpSendQueueDelete(sq, trudpSendQueueGetFirst(sq));
+    cheat_assert(trudpSendQueueGetExpectedTime(sq) == 4);
+
+    // Free send queue
+    trudpSendQueueFree(sq);
+    cheat_assert(trudpSendQueueSize(sq) == 0);
+    cheat_assert(trudpSendQueueGetFirst(sq) == NULL);
+
+    // Create packet in send queue slot and move packet buffer to send queue
+    sqd = trudpSendQueueAlloc(sq, 1,
+            TRUDP_HEADER_LENGTH + 6, 100);
+    cheat_assert(sqd != NULL);
+    trudpPacketDATAcreate(sqd->packet, 1, 0, (void *)"Hello", 6);
+    trudpPacket *packet = trudpPacketDATAcreateNew(2, 0, (void *)"World", 6,
+            &packet_size);
+    sqd = trudpSendQueueAddBuffer(sq, packet, packet_size, 200);
+    cheat_assert(sqd != NULL && sqd->packet == (char *)packet);
+    cheat_assert(trudpSendQueueSize(sq) == 2);
+    sqd = trudpSendQueueFindById(sq, 1);
+    cheat_assert(sqd != NULL && !strcmp(trudpPacketGetData(
+            (trudpPacket *)sqd->packet), "Hello"));
+
+    // Destroy send queue (frees moved packet buffer)
+    trudpSendQueueDestroy(sq);
+)
+
+CHEAT_TEST(receive_queue,
+    // Create receive queue
+    trudpReceiveQueue *rq = trudpReceiveQueueNew();
+
+    // Add outrunning packets 5, 7 and RECEIVE_QUEUE_SIZE + 3
+    uint32_t ids[] = { 7, 5, RECEIVE_QUEUE_SIZE + 3 };
+    size_t i, packet_size;
+    for (i = 0; i < sizeof(ids) / sizeof(ids[0]); i++) {
+        trudpPacket *packet = trudpPacketDATAcreateNew(ids[i], 0,
+                (void *)"Hello", 6, &packet_size);
+        cheat_assert(trudpReceiveQueueAdd(rq, packet, packet_size) != NULL);
+        trudpPacketCreatedFree(packet);
+    }
+    cheat_assert(trudpReceiveQueueSize(rq) == 3);
+    cheat_assert(trudpReceiveQueueFindById(rq, 6) == NULL);
+
+    // Packet in the same slot with other id is not found
+    cheat_assert(trudpReceiveQueueFindById(rq, 3) == NULL);
+    cheat_assert(trudpReceiveQueueFindById(rq, RECEIVE_QUEUE_SIZE + 3) != NULL);
+
+    // Find next packets starting from expected id 4
+    uint32_t id = 4;
+    trudpReceiveQueueData *rqd = trudpReceiveQueueFindNext(rq, &id);
+    cheat_assert(rqd != NULL && id == 5);
+    cheat_yield();
+    cheat_assert(trudpPacketGetId(trudpReceiveQueueDataGetPacket(rqd)) == 5);
+    cheat_assert(trudpReceiveQueueDelete(rq, rqd) == 0);
+    cheat_assert(trudpReceiveQueueDelete(rq, rqd) == -1);
+    id = 6;
+    cheat_assert(trudpReceiveQueueFindNext(rq, &id) != NULL && id == 7);
+    cheat_assert(trudpReceiveQueueSize(rq) == 2);
+
+    // Slots and small buffers are kept when queue becomes empty
+    cheat_assert(trudpReceiveQueueDelete(rq, rqd =
+            trudpReceiveQueueFindById(rq, 7)) == 0);
+    cheat_assert(trudpReceiveQueueDelete(rq,
+            trudpReceiveQueueFindById(rq, RECEIVE_QUEUE_SIZE + 3)) == 0);
+    cheat_assert(rq->slots != NULL && trudpReceiveQueueSize(rq) == 0);
+    cheat_assert(rqd->packet != NULL);
+    cheat_assert(trudpReceiveQueueDelete(rq, rqd) == -1);
+
+    // Large buffer is freed when its packet is deleted
+    char big[RECEIVE_QUEUE_BUFFER_SIZE] = { 0 };
+    trudpPacket *packet = trudpPacketDATAcreateNew(9, 0, big, sizeof(big),
+            &packet_size);
+    cheat_assert((rqd = trudpReceiveQueueAdd(rq, packet, packet_size)) != NULL);
+    trudpPacketCreatedFree(packet);
+    cheat_assert(rqd->packet_size > RECEIVE_QUEUE_BUFFER_SIZE);
+    cheat_assert(trudpReceiveQueueDelete(rq, rqd) == 0);
+    cheat_assert(rqd->packet == NULL && rqd->packet_size == 0);
+
+    // Free and destroy receive queue
+    trudpReceiveQueueFree(rq);
+    cheat_assert(trudpReceiveQueueSize(rq) == 0);
+    cheat_assert(trudpReceiveQueueFindById(rq, 7) == NULL);
+    trudpReceiveQueueDestroy(rq);
+)
+
+CHEAT_TEST(channel_index,
+    trudpChannelIndex *idx = trudpChannelIndexNew(0);
+    cheat_assert(idx != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    // Use channel index slots numbers as fake channel pointers
+    trudpChannelKey key[300];
+    for (int i = 0; i < 300; i++) {
+        struct sockaddr_in sin;
+        memset(&sin, 0, sizeof(sin));
+        sin.sin_family = AF_INET;
+        sin.sin_port = htons(8000 + i % 3);
+        sin.sin_addr.s_addr = htonl(0x7f000001 + i / 3);
+        int rv = trudpChannelKeyMake(&key[i], (__CONST_SOCKADDR_ARG)&sin,
+                                     sizeof(sin), 0);
+        cheat_assert(rv == 0);
+        rv = trudpChannelIndexAdd(idx, &key[i], (trudpChannelData *)&key[i]);
+        cheat_assert(rv == 0);
+    }
+    cheat_assert(trudpChannelIndexSize(idx) == 300);
+
+    // The same address with another channel number is another key
+    trudpChannelKey other = key[7];
+    other.channel = 1;
+    cheat_assert(trudpChannelIndexGet(idx, &other) == NULL);
+
+    // Delete every second key and check the rest is still found
+    for (int i = 0; i < 300; i += 2) {
+        cheat_assert(trudpChannelIndexDelete(idx, &key[i]) == 0);
+    }
+    cheat_assert(trudpChannelIndexSize(idx) == 150);
+    for (int i = 0; i < 300; i++) {
+        trudpChannelData *tcd = trudpChannelIndexGet(idx, &key[i]);
+        cheat_assert(tcd == (i % 2 ? (trudpChannelData *)&key[i] : NULL));
+    }
+
+    trudpChannelIndexDestroy(idx);
+)
+
+CHEAT_TEST(channel_heap,
+    // Create channel heap
+    trudpChannelHeap *heap = trudpChannelHeapNew(0);
+    static trudpChannelData tcd[200];
+    size_t i;
+
+    // Add channels with pseudo random expected time
+    for (i = 0; i < 200; i++) {
+        cheat_assert(trudpChannelHeapUpdate(heap, &tcd[i],
+                (i * 7919) % 1000 + 10) == 0);
+    }
+    cheat_assert(trudpChannelHeapSize(heap) == 200);
+
+    // Move first 10 channels to the top, remove next 10 channels
+    for (i = 0; i < 10; i++) trudpChannelHeapUpdate(heap, &tcd[i], i);
+    for (i = 10; i < 20; i++) trudpChannelHeapUpdate(heap, &tcd[i], UINT64_MAX);
+    cheat_assert(trudpChannelHeapSize(heap) == 190);
+    cheat_assert(trudpChannelHeapTop(heap, NULL) == &tcd[0]);
+
+    // Channels come out in expected time order
+    uint64_t expected_time, last_time = 0;
+    trudpChannelData *top;
+    while ((top = trudpChannelHeapTop(heap, &expected_time))) {
+        cheat_assert(expected_time >= last_time);
+        cheat_assert(top < &tcd[10] || top >= &tcd[20]);
+        last_time = expected_time;
+        trudpChannelHeapRemove(heap, top);
+        cheat_assert(top->heap_idx == 0);
+    }
+    cheat_assert(expected_time == UINT64_MAX);
+
+    // Destroy channel heap
+    trudpChannelHeapDestroy(heap);
+)
+
+CHEAT_TEST(timer_wheel,
+    // Create timer wheel
+    uint64_t ts = 1000 * TIMER_WHEEL_TICK;
+    trudpTimerWheel *tw = trudpTimerWheelNew(ts);
+    static trudpTimerWheelNode node[100];
+    trudpTimerWheelNode expired, *n;
+    size_t i, num;
+
+    // Add timers, half of them later than one wheel revolution
+    for (i = 0; i < 100; i++) {
+        uint64_t delay = (i % 2 ? TIMER_WHEEL_SIZE + i : i) * TIMER_WHEEL_TICK;
+        trudpTimerWheelAdd(tw, &node[i], ts + delay + 1);
+    }
+    trudpTimerWheelRemove(&node[0]);
+    cheat_assert(node[0].next == NULL);
+
+    // Timers expire at their deadline only
+    trudpTimerWheelListInit(&expired);
+    trudpTimerWheelExpire(tw, ts + 50 * TIMER_WHEEL_TICK, &expired);
+    for (num = 0; (n = trudpTimerWheelListPop(&expired)); num++) {
+        cheat_assert(n->deadline <= ts + 50 * TIMER_WHEEL_TICK);
+        cheat_assert(n != &node[0] && (n - node) % 2 == 0);
+    }
+    cheat_assert(num == 24);
+
+    // Long timers expire after wheel revolution
+    trudpTimerWheelExpire(tw, ts + 2 * TIMER_WHEEL_SIZE * TIMER_WHEEL_TICK,
+                          &expired);
+    for (num = 0; (n = trudpTimerWheelListPop(&expired)); num++);
+    cheat_assert(num == 75);
+
+    // Timers list keeps nodes in add order
+    trudpTimerWheelListAdd(&expired, &node[2], ts + 2);
+    trudpTimerWheelListAdd(&expired, &node[1], ts + 1);
+    trudpTimerWheelListAdd(&expired, &node[2], ts + 3);
+    cheat_assert(trudpTimerWheelListPop(&expired) == &node[1]);
+    cheat_assert(trudpTimerWheelListPop(&expired) == &node[2]);
+    cheat_assert(node[2].deadline == ts + 3);
+    cheat_assert(trudpTimerWheelListPop(&expired) == NULL);
+
+    // Destroy timer wheel
+    trudpTimerWheelDestroy(tw);
+)
+
+CHEAT_TEST(submit_queue,
+    // Create submit queue
+    trudpSubmitQueue *q = trudpSubmitQueueNew(16);
+    trudpSubmitQueueData d;
+    struct sockaddr_in addr;
+    uint32_t i;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(8000);
+    cheat_assert(trudpSubmitQueuePop(q, &d) == -1);
+
+    // Fill queue up to its size
+    for (i = 0; i < 16; i++) {
+        cheat_assert(!trudpSubmitQueuePush(q, (__CONST_SOCKADDR_ARG)&addr,
+                sizeof(addr), 1, &i, sizeof(i)));
+    }
+    cheat_assert(trudpSubmitQueuePush(q, (__CONST_SOCKADDR_ARG)&addr,
+            sizeof(addr), 1, &i, sizeof(i)) == -1);
+
+    // Messages are popped in push order, freed cells are reused
+    for (i = 0; i < 20; i++) {
+        cheat_assert(!trudpSubmitQueuePop(q, &d));
+        cheat_assert(d.channel == 1 && d.addr_len == sizeof(addr));
+        cheat_assert(d.data_length == sizeof(i) && *(uint32_t *)d.data == i);
+        free(d.data);
+        uint32_t v = i + 16;
+        cheat_assert(!trudpSubmitQueuePush(q, (__CONST_SOCKADDR_ARG)&addr,
+                sizeof(addr), 1, &v, sizeof(v)));
+    }
+
+    // Destroy frees not processed messages
+    trudpSubmitQueueDestroy(q);
+)
+
+CHEAT_TEST(retransmit_timeout,
+    trudpData *td = trudpInit(0, 0, NULL, NULL);
+    cheat_assert(td != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    trudpChannelData *tcd = trudpChannelNew(td, "0", 8000, 0);
+    cheat_assert(tcd != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+    cheat_assert(tcd->rto == INITIAL_RTO && tcd->triptimeMiddle == 0);
+
+    char ack[TRUDP_SACK_MAX_LENGTH];
+    char *data = "HelloTR-UDP!";
+    size_t ack_length;
+
+    // Retransmit doubles timeout, ACK to first transmission of retransmitted
+    // packet is not measured
+    trudpChannelSendData(tcd, data, strlen(data) + 1);
+    trudpSendQueueData *sqd = trudpSendQueueGetFirst(tcd->sendQueue);
+    ack_length = trudpPacketACKcreate(ack, trudpSendQueueDataGetPacket(sqd));
+    uint32_t sent_ts = trudpGetTimestamp();
+    while (trudpGetTimestamp() == sent_ts); // Retransmit has new timestamp
+    cheat_assert(trudpChannelSendQueueProcess(tcd,
+            sqd->expected_time, NULL) == 1);
+    cheat_assert(tcd->rto == 2 * INITIAL_RTO && sqd->retrieves == 1);
+    trudpChannelProcessReceivedPacket(tcd, (uint8_t *)ack, ack_length);
+    cheat_assert(trudpSendQueueSize(tcd->sendQueue) == 0);
+    cheat_assert(tcd->rto == 2 * INITIAL_RTO && tcd->triptimeMiddle == 0);
+
+    // ACK of packet sent once sets timeout to measured round trip time
+    trudpChannelSendData(tcd, data, strlen(data) + 1);
+    sqd = trudpSendQueueGetFirst(tcd->sendQueue);
+    ack_length = trudpPacketACKcreate(ack, trudpSendQueueDataGetPacket(sqd));
+    trudpChannelProcessReceivedPacket(tcd, (uint8_t *)ack, ack_length);
+    cheat_assert(tcd->triptimeMiddle > 0);
+    cheat_assert(tcd->rto >= RTT && tcd->rto < MAX_RTT);
+
+    // All expired packets are resent in one pass
+    trudpSetCongestionControl(td, trudpCcGetOps(TRUDP_CC_FIXED));
+    trudpChannelSendData(tcd, data, strlen(data) + 1);
+    trudpChannelSendData(tcd, data, strlen(data) + 1);
+    trudpChannelSendData(tcd, data, strlen(data) + 1);
+    sqd = trudpSendQueueGetLast(tcd->sendQueue);
+    cheat_assert(trudpChannelSendQueueProcess(tcd,
+            sqd->expected_time, NULL) == 3);
+
+    trudpChannelDestroy(tcd); trudpDestroy(td);
+)
+
+CHEAT_TEST(retransmit_expected_time,
+    trudpData *td = trudpInit(0, 0, NULL, NULL);
+    cheat_assert(td != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    trudpChannelData *tcd = trudpChannelNew(td, "0", 8000, 0);
+    cheat_assert(tcd != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    char ack[TRUDP_SACK_MAX_LENGTH];
+    char *data = "HelloTR-UDP!";
+    size_t ack_length;
+    uint64_t expected_time;
+
+    // Open congestion window
+    trudpChannelSendData(tcd, data, strlen(data) + 1);
+    trudpSendQueueData *sqd = trudpSendQueueGetFirst(tcd->sendQueue);
+    ack_length = trudpPacketACKcreate(ack, trudpSendQueueDataGetPacket(sqd));
+    trudpChannelProcessReceivedPacket(tcd, (uint8_t *)ack, ack_length);
+
+    // Send two packets, second one expires later
+    trudpChannelSendData(tcd, data, strlen(data) + 1);
+    uint64_t sent_ts = teoGetTimestampFull();
+    while (teoGetTimestampFull() == sent_ts);
+    trudpChannelSendData(tcd, data, strlen(data) + 1);
+    trudpSendQueueData *first = trudpSendQueueGetFirst(tcd->sendQueue);
+    trudpSendQueueData *second = trudpSendQueueGetLast(tcd->sendQueue);
+    cheat_assert(first->expected_time < second->expected_time);
+    tcd->tlp_time = 0; // No tail loss probe
+
+    // Retransmitted first packet expires after second one, channel wakes up
+    // at expected time of second packet
+    cheat_assert(trudpChannelSendQueueProcess(tcd,
+            first->expected_time, NULL) == 1);
+    cheat_assert(first->retrieves == 1 && second->retrieves == 0);
+    cheat_assert(first->expected_time > second->expected_time);
+    cheat_assert(trudpSendQueueGetExpectedTime(tcd->sendQueue) ==
+            second->expected_time);
+    cheat_assert(trudpChannelHeapTop(td->heap, &expected_time) == tcd);
+    cheat_assert(expected_time == second->expected_time);
+
+    // Second packet is resent though first packet did not expire
+    cheat_assert(trudpChannelSendQueueProcess(tcd,
+            second->expected_time, &expected_time) == 1);
+    cheat_assert(first->retrieves == 1 && second->retrieves == 1);
+    cheat_assert(expected_time == (first->expected_time <
+            second->expected_time ? first->expected_time :
+            second->expected_time));
+
+    trudpChannelDestroy(tcd); trudpDestroy(td);
+)
+
+CHEAT_TEST(retransmit_timeout_window,
+    trudpData *td = trudpInit(0, 0, NULL, NULL);
+    cheat_assert(td != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    trudpChannelData *tcd = trudpChannelNew(td, "0", 8000, 0);
+    cheat_assert(tcd != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    char ack[TRUDP_SACK_MAX_LENGTH];
+    char *data = "HelloTR-UDP!";
+    size_t ack_length;
+    uint64_t expected_time;
+    int i;
+
+    // Open congestion window
+    trudpChannelSendData(tcd, data, strlen(data) + 1);
+    trudpSendQueueData *sqd = trudpSendQueueGetFirst(tcd->sendQueue);
+    ack_length = trudpPacketACKcreate(ack, trudpSendQueueDataGetPacket(sqd));
+    trudpChannelProcessReceivedPacket(tcd, (uint8_t *)ack, ack_length);
+
+    // All sent packets expire together
+    for (i = 0; i < 8; i++) trudpChannelSendData(tcd, data, strlen(data) + 1);
+    cheat_assert(trudpSendQueueSize(tcd->sendQueue) == 8);
+    for (sqd = trudpSendQueueGetFirst(tcd->sendQueue); sqd;
+         sqd = trudpSendQueueGetNext(tcd->sendQueue, sqd)) {
+        trudpSendQueueSetExpectedTime(tcd->sendQueue, sqd, 1);
+    }
+    tcd->tlp_time = 0; // No tail loss probe
+    trudpChannelHeapUpdate(td->heap, tcd, 1);
+
+    // Packets resent after timeout are limited by congestion window, the
+    // channel is not due again until next timeout
+    uint64_t ts = teoGetTimestampFull();
+    uint32_t attempt = tcd->stat.packets_attempt;
+    int rv = trudpProcessSendQueue(td, NULL);
+    size_t cwnd = trudpCcGetWindow(tcd->peer ? &tcd->peer->cc : &tcd->cc);
+    cheat_assert(rv > 0 && (size_t)rv <= cwnd);
+    cheat_assert(tcd->stat.packets_attempt - attempt == (uint32_t)rv);
+    cheat_assert(trudpChannelHeapTop(td->heap, &expected_time) == tcd);
+    cheat_assert(expected_time > ts);
+
+    trudpProcessSendQueue(td, NULL);
+    cheat_assert(tcd->stat.packets_attempt - attempt == (uint32_t)rv);
+
+    trudpChannelDestroy(tcd); trudpDestroy(td);
+)
+
+CHEAT_TEST(loss_detection,
+    trudpData *td = trudpInit(0, 0, NULL, NULL);
+    cheat_assert(td != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    trudpChannelData *tcd = trudpChannelNew(td, "0", 8000, 0);
+    cheat_assert(tcd != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    char ack[TRUDP_SACK_MAX_LENGTH];
+    char *data = "HelloTR-UDP!";
+    size_t ack_length;
+    int i;
+
+    // Measure round trip time
+    trudpChannelSendData(tcd, data, strlen(data) + 1);
+    trudpSendQueueData *sqd = trudpSendQueueGetFirst(tcd->sendQueue);
+    ack_length = trudpPacketACKcreate(ack, trudpSendQueueDataGetPacket(sqd));
+    trudpChannelProcessReceivedPacket(tcd, (uint8_t *)ack, ack_length);
+    cheat_assert(trudpSendQueueSize(tcd->sendQueue) == 0);
+
+    // Packets sent before acknowledged one are lost after reordering window
+    for (i = 0; i < 3; i++) {
+        uint32_t sent_ts = trudpGetTimestamp();
+        while (trudpGetTimestamp() - sent_ts <= tcd->rack_min_rtt);
+        trudpChannelSendData(tcd, data, strlen(data) + 1);
+    }
+    sqd = trudpSendQueueGetLast(tcd->sendQueue);
+    ack_length = trudpPacketACKcreate(ack, trudpSendQueueDataGetPacket(sqd));
+    trudpChannelProcessReceivedPacket(tcd, (uint8_t *)ack, ack_length);
+    cheat_assert(trudpSendQueueSize(tcd->sendQueue) == 2);
+    cheat_assert(tcd->stat.packets_attempt == 2);
+
+    // Tail loss probe resends last packet before retransmit timeout
+    sqd = trudpSendQueueGetLast(tcd->sendQueue);
+    cheat_assert(tcd->tlp_time > 0 && tcd->tlp_time < sqd->expected_time);
+    cheat_assert(trudpChannelSendQueueProcess(tcd, tcd->tlp_time, NULL) == 1);
+    cheat_assert(sqd->retrieves == 2 && tcd->tlp_time == 0);
+
+    trudpChannelDestroy(tcd); trudpDestroy(td);
+)
+
+CHEAT_TEST(loss_detection_window,
+    trudpData *td = trudpInit(0, 0, NULL, NULL);
+    cheat_assert(td != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    trudpChannelData *tcd = trudpChannelNew(td, "0", 8000, 0);
+    cheat_assert(tcd != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    char ack[TRUDP_SACK_MAX_LENGTH];
+    char *data = "HelloTR-UDP!";
+    size_t ack_length;
+    int i;
+
+    // Measure round trip time
+    trudpChannelSendData(tcd, data, strlen(data) + 1);
+    trudpSendQueueData *sqd = trudpSendQueueGetFirst(tcd->sendQueue);
+    ack_length = trudpPacketACKcreate(ack, trudpSendQueueDataGetPacket(sqd));
+    trudpChannelProcessReceivedPacket(tcd, (uint8_t *)ack, ack_length);
+
+    // Lost packets are resent up to congestion window
+    for (i = 0; i < 8; i++) {
+        uint32_t sent_ts = trudpGetTimestamp();
+        while (trudpGetTimestamp() - sent_ts <= tcd->rack_min_rtt);
+        trudpChannelSendData(tcd, data, strlen(data) + 1);
+    }
+    sqd = trudpSendQueueGetLast(tcd->sendQueue);
+    ack_length = trudpPacketACKcreate(ack, trudpSendQueueDataGetPacket(sqd));
+    trudpChannelProcessReceivedPacket(tcd, (uint8_t *)ack, ack_length);
+    size_t cwnd = trudpCcGetWindow(&tcd->cc);
+    cheat_assert(trudpSendQueueSize(tcd->sendQueue) == 7);
+    cheat_assert(cwnd < 7 && tcd->stat.packets_attempt == cwnd);
+
+    // Other lost packets are resent when ACKs of resent ones come
+    while ((sqd = trudpSendQueueGetFirst(tcd->sendQueue)) && sqd->retrieves) {
+        ack_length = trudpPacketACKcreate(ack,
+                trudpSendQueueDataGetPacket(sqd));
+        trudpChannelProcessReceivedPacket(tcd, (uint8_t *)ack, ack_length);
+    }
+    cheat_assert(trudpSendQueueSize(tcd->sendQueue) == 0);
+    cheat_assert(tcd->stat.packets_attempt == 7);
+
+    trudpChannelDestroy(tcd); trudpDestroy(td);
+)
+
+CHEAT_DECLARE(
+    static trudpChannelData *dack_sender;
+    static uint8_t dack_data[8][TRUDP_HEADER_LENGTH + 8];
+    static size_t dack_data_length[8];
+    static int dack_acks = 0;
+
+    // Sender stores DATA packets by id, receiver sends ACKs to sender
+    static void DelayedAckSenderCb(void *tcd, int event, void *data,
+                                   size_t data_length, void *user_data) {
+        if (event == PROCESS_SEND &&
+                trudpPacketGetType((trudpPacket *)data) == TRU_DATA) {
+            uint32_t id = trudpPacketGetId((trudpPacket *)data) % 8;
+            memcpy(dack_data[id], data, data_length);
+            dack_data_length[id] = data_length;
+        }
+    }
+    static void DelayedAckReceiverCb(void *tcd, int event, void *data,
+                                     size_t data_length, void *user_data) {
+        if (event == PROCESS_SEND) {
+            dack_acks++;
+            trudpChannelProcessReceivedPacket(dack_sender, data, data_length);
+        }
+    }
+    static void DelayedAckReceive(trudpChannelData *tcd, uint32_t id) {
+        trudpChannelProcessReceivedPacket(tcd, dack_data[id],
+                                          dack_data_length[id]);
+    }
+)
+
+CHEAT_TEST(delayed_ack,
+    trudpData *td_s = trudpInit(0, 0, DelayedAckSenderCb, NULL);
+    trudpData *td_r = trudpInit(0, 0, DelayedAckReceiverCb, NULL);
+    cheat_assert(td_s != NULL && td_r != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    dack_sender = trudpChannelNew(td_s, "0", 8000, 0);
+    trudpChannelData *rcv = trudpChannelNew(td_r, "0", 8001, 0);
+    cheat_assert(dack_sender != NULL && rcv != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+    trudpSetDelayedAck(td_r, 2, 1000000);
+
+    // First packet is acknowledged at once
+    uint32_t i = 0;
+    trudpChannelSendData(dack_sender, &i, sizeof(i));
+    DelayedAckReceive(rcv, 0);
+    cheat_assert(dack_acks == 1);
+    cheat_assert(trudpSendQueueSize(dack_sender->sendQueue) == 0);
+    for (i = 1; i < 6; i++) trudpChannelSendData(dack_sender, &i, sizeof(i));
+    cheat_assert(trudpSendQueueSize(dack_sender->sendQueue) == 5);
+
+    // Two next in order packets are acknowledged by one ACK which releases
+    // both of them
+    DelayedAckReceive(rcv, 1);
+    cheat_assert(dack_acks == 1 && rcv->ack_pending == 1);
+    cheat_assert(trudpSendQueueSize(dack_sender->sendQueue) == 5);
+    DelayedAckReceive(rcv, 2);
+    cheat_assert(dack_acks == 2 && rcv->ack_pending == 0);
+    cheat_assert(trudpSendQueueSize(dack_sender->sendQueue) == 3);
+
+    // Outrunning packet is acknowledged at once
+    DelayedAckReceive(rcv, 4);
+    cheat_assert(dack_acks == 3);
+    DelayedAckReceive(rcv, 3);
+    cheat_assert(dack_acks == 4);
+    cheat_assert(trudpSendQueueSize(dack_sender->sendQueue) == 1);
+
+    // Pending ACK is sent when its deadline expires
+    DelayedAckReceive(rcv, 5);
+    cheat_assert(dack_acks == 4 && rcv->ack_pending == 1);
+    trudpProcessSendQueue(td_r, NULL);
+    cheat_assert(dack_acks == 4);
+    rcv->ack_timer.deadline = 1;
+    trudpProcessSendQueue(td_r, NULL);
+    cheat_assert(dack_acks == 5 && rcv->ack_pending == 0);
+    cheat_assert(trudpSendQueueSize(dack_sender->sendQueue) == 0);
+
+    trudpChannelDestroy(dack_sender); trudpChannelDestroy(rcv);
+    trudpDestroy(td_s); trudpDestroy(td_r);
+)
+
+CHEAT_DECLARE(
+    static int writable_events = 0;
+
+    static void WritableEventCb(void *tcd, int event, void *data,
+                                size_t data_length, void *user_data) {
+        if (event == WRITABLE) writable_events++;
+    }
+)
+
+CHEAT_TEST(write_queue_limits,
+    trudpData *td = trudpInit(0, 0, WritableEventCb, NULL);
+    cheat_assert(td != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    trudpChannelData *tcd = trudpChannelNew(td, "0", 8000, 0);
+    cheat_assert(tcd != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    char ack[TRUDP_SACK_MAX_LENGTH];
+    char *data = "HelloTR-UDP!";
+    size_t ack_length, rv;
+    int i;
+
+    // Packets wait in write queue until first packet is acknowledged, send
+    // would block at channel high watermark
+    trudpSetWriteQueueLimits(td, 200, 100, 0, 0);
+    for (i = 0; i < 20; i++) {
+        rv = trudpChannelSendData(tcd, data, strlen(data) + 1);
+        if (rv == TRUDP_SEND_WOULD_BLOCK) break;
+    }
+    cheat_assert(rv == TRUDP_SEND_WOULD_BLOCK && i > 1);
+    cheat_assert(trudpWriteQueueBytes(tcd->writeQueue) >= 200);
+    cheat_assert(td->write_queue_bytes ==
+                 trudpWriteQueueBytes(tcd->writeQueue));
+    cheat_assert(writable_events == 0);
+
+    // Channel becomes writable when write queue goes down to low watermark
+    trudpSendQueueData *sqd = trudpSendQueueGetFirst(tcd->sendQueue);
+    ack_length = trudpPacketACKcreate(ack, trudpSendQueueDataGetPacket(sqd));
+    trudpChannelProcessReceivedPacket(tcd, (uint8_t *)ack, ack_length);
+    cheat_assert(writable_events == 1);
+    cheat_assert(trudpWriteQueueBytes(tcd->writeQueue) <= 100);
+    cheat_assert(trudpChannelSendData(tcd, data, strlen(data) + 1) !=
+                 TRUDP_SEND_WOULD_BLOCK);
+
+    trudpChannelDestroy(tcd);
+    cheat_assert(td->write_queue_bytes == 0);
+    trudpDestroy(td);
+)
+
+CHEAT_TEST(write_queue_scheduler,
+    trudpData *td = trudpInit(0, 0, NULL, NULL);
+    cheat_assert(td != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+    trudpSetCongestionControl(td, trudpCcGetOps(TRUDP_CC_FIXED));
+
+    trudpChannelData *tcd[2] = { trudpChannelNew(td, "0", 8000, 0),
+                                 trudpChannelNew(td, "0", 8001, 0) };
+    cheat_assert(tcd[0] != NULL && tcd[1] != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    char ack[TRUDP_SACK_MAX_LENGTH];
+    char data[1000];
+    size_t ack_length;
+    int i, j;
+    memset(data, 'x', sizeof(data));
+
+    // Fill one packet congestion window after first packet is acknowledged,
+    // so next packets wait in write queue: 1000 bytes data in first
+    // channel, 100 bytes in second one
+    for (i = 0; i < 2; i++) {
+        trudpChannelSendData(tcd[i], data, 100);
+        trudpSendQueueData *sqd = trudpSendQueueGetFirst(tcd[i]->sendQueue);
+        ack_length = trudpPacketACKcreate(ack,
+                trudpSendQueueDataGetPacket(sqd));
+        trudpChannelProcessReceivedPacket(tcd[i], (uint8_t *)ack, ack_length);
+        tcd[i]->cc.cwnd = 1;
+        trudpChannelSendData(tcd[i], data, 100);
+        for (j = 0; j < 10; j++) {
+            trudpChannelSendData(tcd[i], data, i ? 100 : 1000);
+        }
+    }
+    cheat_assert(td->write_active_num == 2);
+    cheat_assert(trudpGetWriteQueueSize(td) == 20);
+    cheat_assert(trudpProcessWriteQueue(td) == 0);
+
+    // Every channel sends its quantum bytes per round, channel with empty
+    // write queue leaves the round
+    tcd[0]->cc.cwnd = tcd[1]->cc.cwnd = 100;
+    cheat_assert(trudpProcessWriteQueue(td) ==
+                 4 * (TRUDP_HEADER_LENGTH + 1000) +
+                 10 * (TRUDP_HEADER_LENGTH + 100));
+    cheat_assert(trudpWriteQueueSize(tcd[0]->writeQueue) == 6);
+    cheat_assert(td->write_active_num == 1);
+    while (trudpProcessWriteQueue(td));
+    cheat_assert(td->write_active_num == 0 && trudpGetWriteQueueSize(td) == 0);
+
+    // Quantum is not less than maximum packet length
+    trudpChannelSetWriteQuantum(tcd[0], 1);
+    cheat_assert(tcd[0]->write_quantum == WRITE_QUEUE_QUANTUM);
+
+    trudpChannelDestroy(tcd[0]); trudpChannelDestroy(tcd[1]);
+    trudpDestroy(td);
+)
+
+CHEAT_TEST(write_queue_priority,
+    trudpData *td = trudpInit(0, 0, NULL, NULL);
+    cheat_assert(td != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+    trudpSetCongestionControl(td, trudpCcGetOps(TRUDP_CC_FIXED));
+
+    trudpChannelData *tcd[2] = { trudpChannelNew(td, "0", 8000, 0),
+                                 trudpChannelNew(td, "0", 8001, 0) };
+    cheat_assert(tcd[0] != NULL && tcd[1] != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+    trudpChannelSetPriority(tcd[1], 1);
+
+    char ack[TRUDP_SACK_MAX_LENGTH];
+    char data[1000];
+    size_t ack_length;
+    int i, j;
+    memset(data, 'x', sizeof(data));
+
+    // Fill one packet congestion windows, next packets wait in write queues
+    for (i = 0; i < 2; i++) {
+        trudpChannelSendData(tcd[i], data, 100);
+        trudpSendQueueData *sqd = trudpSendQueueGetFirst(tcd[i]->sendQueue);
+        ack_length = trudpPacketACKcreate(ack,
+                trudpSendQueueDataGetPacket(sqd));
+        trudpChannelProcessReceivedPacket(tcd[i], (uint8_t *)ack, ack_length);
+        tcd[i]->cc.cwnd = 1;
+        trudpChannelSendData(tcd[i], data, 100);
+        for (j = 0; j < 10; j++) trudpChannelSendData(tcd[i], data, 1000);
+    }
+
+    // Lower priority channel waits while higher priority one may send
+    tcd[0]->cc.cwnd = tcd[1]->cc.cwnd = 100;
+    while (trudpWriteQueueSize(tcd[0]->writeQueue)) {
+        cheat_assert(trudpProcessWriteQueue(td) > 0);
+        cheat_assert(trudpWriteQueueSize(tcd[1]->writeQueue) == 10 ||
+                     !trudpWriteQueueSize(tcd[0]->writeQueue));
+    }
+
+    // Lower priority channel sends when higher priority one is limited by
+    // congestion window
+    tcd[0]->cc.cwnd = trudpSendQueueSize(tcd[0]->sendQueue);
+    for (j = 0; j < 10; j++) trudpChannelSendData(tcd[0], data, 1000);
+    cheat_assert(trudpWriteQueueSize(tcd[0]->writeQueue) == 10);
+    while (trudpProcessWriteQueue(td));
+    cheat_assert(trudpWriteQueueSize(tcd[0]->writeQueue) == 10);
+    cheat_assert(trudpWriteQueueSize(tcd[1]->writeQueue) == 0);
+
+    trudpChannelDestroy(tcd[0]); trudpChannelDestroy(tcd[1]);
+    trudpDestroy(td);
+)
+
+CHEAT_TEST(peer_priority,
+    trudpData *td = trudpInit(0, 0, NULL, NULL);
+    cheat_assert(td != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+    trudpSetCongestionControl(td, trudpCcGetOps(TRUDP_CC_FIXED));
+    trudpSetPeerCongestionControl(td, 1);
+
+    // Control channel 0 and bulk channel 5 of one address share peer
+    trudpChannelData *ctl = trudpChannelNew(td, "0", 8000, 0);
+    trudpChannelData *bulk = trudpChannelNew(td, "0", 8000, 5);
+    trudpChannelData *other = trudpChannelNew(td, "0", 8001, 5);
+    cheat_assert(ctl != NULL && bulk != NULL && other != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+    cheat_assert(ctl->peer != NULL && ctl->peer == bulk->peer);
+    cheat_assert(ctl->peer->channels_num == 2);
+    cheat_assert(other->peer != NULL && other->peer != ctl->peer);
+    trudpChannelSetPriority(bulk, 1);
+
+    char ack[TRUDP_SACK_MAX_LENGTH];
+    char data[100];
+    size_t ack_length;
+    trudpSendQueueData *sqd;
+    int i;
+    memset(data, 'x', sizeof(data));
+
+    // Acknowledge first packets, then fill one packet shared window by bulk
+    // channel
+    trudpChannelSendData(ctl, data, sizeof(data));
+    trudpChannelSendData(bulk, data, sizeof(data));
+    sqd = trudpSendQueueGetFirst(ctl->sendQueue);
+    ack_length = trudpPacketACKcreate(ack, trudpSendQueueDataGetPacket(sqd));
+    trudpChannelProcessReceivedPacket(ctl, (uint8_t *)ack, ack_length);
+    sqd = trudpSendQueueGetFirst(bulk->sendQueue);
+    ack_length = trudpPacketACKcreate(ack, trudpSendQueueDataGetPacket(sqd));
+    trudpChannelProcessReceivedPacket(bulk, (uint8_t *)ack, ack_length);
+    ctl->peer->cc.cwnd = 1;
+    trudpChannelSendData(bulk, data, sizeof(data));
+    cheat_assert(trudpPeerSendQueueSize(ctl->peer) == 1);
+
+    // Bulk data queued first waits while control message is sent
+    for (i = 0; i < 5; i++) trudpChannelSendData(bulk, data, sizeof(data));
+    trudpChannelSendData(ctl, data, sizeof(data));
+    cheat_assert(trudpWriteQueueSize(bulk->writeQueue) == 5);
+    cheat_assert(trudpWriteQueueSize(ctl->writeQueue) == 1);
+
+    sqd = trudpSendQueueGetFirst(bulk->sendQueue);
+    ack_length = trudpPacketACKcreate(ack, trudpSendQueueDataGetPacket(sqd));
+    trudpChannelProcessReceivedPacket(bulk, (uint8_t *)ack, ack_length);
+    cheat_assert(trudpWriteQueueSize(ctl->writeQueue) == 0);
+    cheat_assert(trudpSendQueueSize(ctl->sendQueue) == 1);
+    cheat_assert(trudpWriteQueueSize(bulk->writeQueue) == 5);
+
+    trudpChannelDestroy(ctl);
+    cheat_assert(bulk->peer->channels_num == 1);
+    trudpChannelDestroy(bulk); trudpChannelDestroy(other);
+    trudpDestroy(td);
+)
+
+CHEAT_TEST(shared_payload,
+    trudpData *td = trudpInit(0, 0, NULL, NULL);
+    cheat_assert(td != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    trudpChannelData *tcd[3];
+    int i;
+    for (i = 0; i < 3; i++) {
+        tcd[i] = trudpChannelNew(td, "0", 8000 + i, 0);
+        cheat_assert(tcd[i] != NULL);
+        cheat_yield(); // Exit test if pointer is null.
+        tcd[i]->connected_f = 1;
+    }
+
+    char ack[TRUDP_SACK_MAX_LENGTH];
+    size_t ack_length;
+    trudpSendQueueData *sqd;
+
+    // Send queues of all channels keep references to one payload
+    trudpPayload *payload = trudpPayloadNew("Hello", 6);
+    for (i = 0; i < 3; i++) {
+        cheat_assert(trudpChannelSendPayload(tcd[i], payload) ==
+                     TRUDP_HEADER_LENGTH + 6);
+    }
+    cheat_assert(payload->refs == 4);
+    sqd = trudpSendQueueGetFirst(tcd[0]->sendQueue);
+    cheat_assert(sqd->payload == payload);
+    cheat_assert(sqd->packet_length == TRUDP_HEADER_LENGTH + 6);
+    cheat_assert(trudpPacketGetDataLength(
+            trudpSendQueueDataGetPacket(sqd)) == 6);
+
+    // Acknowledged packet releases the payload, payload reference moves
+    // from write queue to send queue
+    ack_length = trudpPacketACKcreate(ack, trudpSendQueueDataGetPacket(sqd));
+    trudpChannelProcessReceivedPacket(tcd[0], (uint8_t *)ack, ack_length);
+    cheat_assert(payload->refs == 3);
+    trudpChannelSendPayload(tcd[1], payload);
+    cheat_assert(payload->refs == 4);
+    cheat_assert(trudpWriteQueueBytes(tcd[1]->writeQueue) ==
+                 TRUDP_HEADER_LENGTH + 6);
+    sqd = trudpSendQueueGetFirst(tcd[1]->sendQueue);
+    ack_length = trudpPacketACKcreate(ack, trudpSendQueueDataGetPacket(sqd));
+    trudpChannelProcessReceivedPacket(tcd[1], (uint8_t *)ack, ack_length);
+    cheat_assert(payload->refs == 3);
+    cheat_assert(trudpWriteQueueSize(tcd[1]->writeQueue) == 0);
+    cheat_assert(trudpSendQueueGetFirst(tcd[1]->sendQueue)->payload ==
+                 payload);
+    trudpPayloadRelease(payload);
+
+    // Send to all connected channels and to group members
+    cheat_assert(trudpSendDataToAll(td, "World", 6) == 3);
+    trudpGroupAdd(td, "odd", tcd[0]);
+    trudpGroupAdd(td, "odd", tcd[2]);
+    trudpGroupAdd(td, "odd", tcd[0]);
+    cheat_assert(trudpGroupSize(td, "odd") == 2);
+    cheat_assert(trudpGroupSize(td, "even") == 0);
+    cheat_assert(trudpSendDataToGroup(td, "odd", "Group", 6) == 2);
+    cheat_assert(trudpSendDataToGroup(td, "even", "Group", 6) == 0);
+    cheat_assert(trudpSendQueueSize(tcd[1]->sendQueue) == 2);
+    cheat_assert(trudpWriteQueueSize(tcd[2]->writeQueue) == 2);
+
+    // Destroyed member is skipped
+    cheat_assert(trudpGroupRemove(td, "odd", tcd[0]) == 0);
+    cheat_assert(trudpGroupRemove(td, "odd", tcd[0]) == -1);
+    trudpGroupAdd(td, "odd", tcd[1]);
+    trudpChannelDestroy(tcd[2]);
+    cheat_assert(trudpSendDataToGroup(td, "odd", "Group", 6) == 1);
+    trudpGroupDestroy(td, "odd");
+    cheat_assert(trudpGroupSize(td, "odd") == 0);
+
+    trudpChannelDestroy(tcd[0]); trudpChannelDestroy(tcd[1]);
+    trudpDestroy(td);
+)
+
+CHEAT_DECLARE(
+    static int dgram_sent = 0, dgram_received = 0, dgram_acked = 0;
+    static char dgram_packet[TRUDP_MAX_PACKET_LENGTH];
+    static size_t dgram_packet_length = 0;
+
+    static void DatagramEventCb(void *tcd, int event, void *data,
+                                size_t data_length, void *user_data) {
+        if (event == PROCESS_SEND) {
+            dgram_sent++;
+            memcpy(dgram_packet, data, data_length);
+            dgram_packet_length = data_length;
+        }
+        else if (event == GOT_DATA) dgram_received++;
+        else if (event == GOT_ACK) dgram_acked++;
+    }
+)
+
+CHEAT_TEST(unreliable_datagram,
+    trudpData *td = trudpInit(0, 0, DatagramEventCb, NULL);
+    cheat_assert(td != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    trudpChannelData *tcd = trudpChannelNew(td, "0", 8000, 0);
+    trudpChannelData *rcv = trudpChannelNew(td, "0", 8001, 0);
+    cheat_assert(tcd != NULL && rcv != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    // Datagram bypasses queues
+    cheat_assert(trudpChannelSendDatagram(tcd, "Hello", 6) ==
+                 TRUDP_HEADER_LENGTH + 6);
+    cheat_assert(dgram_sent == 1);
+    cheat_assert(trudpPacketGetType((trudpPacket *)dgram_packet) == TRU_DGRAM);
+    cheat_assert(trudpSendQueueSize(tcd->sendQueue) == 0);
+    cheat_assert(trudpWriteQueueSize(tcd->writeQueue) == 0);
+    cheat_assert(tcd->sendId == 0 && tcd->stat.packets_send == 1);
+
+    // Received datagram is delivered at once and is not acknowledged
+    rcv->receiveExpectedId = 10;
+    cheat_assert(trudpChannelProcessReceivedPacket(rcv,
+            (uint8_t *)dgram_packet, dgram_packet_length) == 1);
+    cheat_assert(dgram_received == 1 && dgram_sent == 1);
+    cheat_assert(rcv->receiveExpectedId == 10);
+    cheat_assert(rcv->stat.packets_receive == 1);
+
+    // Unreliable channel sends data by datagrams
+    trudpChannelSetUnreliable(tcd, 1);
+    trudpChannelSendData(tcd, "World", 6);
+    cheat_assert(dgram_sent == 2);
+    cheat_assert(trudpPacketGetType((trudpPacket *)dgram_packet) == TRU_DGRAM);
+    cheat_assert(trudpPacketGetId((trudpPacket *)dgram_packet) == 1);
+    cheat_assert(trudpSendQueueSize(tcd->sendQueue) == 0);
+    trudpChannelSetUnreliable(tcd, 0);
+    trudpChannelSendData(tcd, "World", 6);
+    cheat_assert(trudpPacketGetType((trudpPacket *)dgram_packet) == TRU_DATA);
+    cheat_assert(trudpSendQueueSize(tcd->sendQueue) == 1);
+
+    trudpChannelDestroy(tcd); trudpChannelDestroy(rcv);
+    trudpDestroy(td);
+)
+
+CHEAT_TEST(partial_reliability,
+    trudpData *td = trudpInit(0, 0, DatagramEventCb, NULL);
+    cheat_assert(td != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    trudpChannelData *tcd = trudpChannelNew(td, "0", 8000, 0);
+    trudpChannelData *rcv = trudpChannelNew(td, "0", 8001, 0);
+    cheat_assert(tcd != NULL && rcv != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    char ack[TRUDP_SACK_MAX_LENGTH];
+    char skip[TRUDP_HEADER_LENGTH];
+    size_t ack_length, packet_length;
+    uint64_t next_expected_time;
+    trudpSendQueueData *sqd;
+    trudpPacket *packet;
+
+    // Expired packet of write queue is sent as SKIP packet
+    trudpChannelSendData(tcd, "A", 2);
+    trudpChannelSendDataExpire(tcd, "B", 2, 10000000);
+    trudpChannelSendDataExpire(tcd, "C", 2, 10000000);
+    cheat_assert(trudpWriteQueueSize(tcd->writeQueue) == 2);
+    trudpWriteQueueGetFirst(tcd->writeQueue)->deadline = 1;
+    sqd = trudpSendQueueGetFirst(tcd->sendQueue);
+    ack_length = trudpPacketACKcreate(ack, trudpSendQueueDataGetPacket(sqd));
+    trudpChannelProcessReceivedPacket(tcd, (uint8_t *)ack, ack_length);
+    cheat_assert(trudpWriteQueueSize(tcd->writeQueue) == 0);
+    sqd = trudpSendQueueFindById(tcd->sendQueue, 1);
+    cheat_assert(sqd != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+    cheat_assert(trudpPacketGetType(trudpSendQueueDataGetPacket(sqd)) ==
+                 TRU_SKIP);
+    cheat_assert(sqd->packet_length == TRUDP_HEADER_LENGTH);
+
+    // ACK to SKIP packet does not send GOT_ACK event
+    int acked = dgram_acked;
+    ack_length = trudpPacketACKcreate(ack, trudpSendQueueDataGetPacket(sqd));
+    trudpChannelProcessReceivedPacket(tcd, (uint8_t *)ack, ack_length);
+    cheat_assert(dgram_acked == acked);
+    cheat_assert(trudpSendQueueFindById(tcd->sendQueue, 1) == NULL);
+
+    // Expired packet is replaced by SKIP packet instead of retransmit
+    sqd = trudpSendQueueFindById(tcd->sendQueue, 2);
+    cheat_assert(sqd != NULL && sqd->deadline);
+    cheat_yield(); // Exit test if pointer is null.
+    sqd->deadline = 1;
+    trudpSendQueueSetExpectedTime(tcd->sendQueue, sqd, 1);
+    trudpChannelSendQueueProcess(tcd, teoGetTimestampFull(),
+                                 &next_expected_time);
+    cheat_assert(sqd->packet_length == TRUDP_HEADER_LENGTH);
+    cheat_assert(trudpPacketGetType((trudpPacket *)dgram_packet) == TRU_SKIP);
+    cheat_assert(trudpPacketGetId((trudpPacket *)dgram_packet) == 2);
+
+    // Receiver skips ids of SKIP packets in order
+    int received = dgram_received;
+    packet = trudpPacketDATAcreateNew(0, 0, "A", 2, &packet_length);
+    trudpChannelProcessReceivedPacket(rcv, (uint8_t *)packet, packet_length);
+    trudpPacketCreatedFree(packet);
+    trudpPacketSKIPcreate(skip, 2, 0);
+    trudpChannelProcessReceivedPacket(rcv, (uint8_t *)skip,
+                                      TRUDP_HEADER_LENGTH);
+    cheat_assert(dgram_received == received + 1);
+    cheat_assert(rcv->receiveExpectedId == 1);
+    trudpPacketSKIPcreate(skip, 1, 0);
+    trudpChannelProcessReceivedPacket(rcv, (uint8_t *)skip,
+                                      TRUDP_HEADER_LENGTH);
+    cheat_assert(rcv->receiveExpectedId == 3);
+    cheat_assert(dgram_received == received + 1);
+    cheat_assert(trudpPacketGetType((trudpPacket *)dgram_packet) == TRU_ACK);
+
+    trudpChannelDestroy(tcd); trudpChannelDestroy(rcv);
+    trudpDestroy(td);
+)
+
+CHEAT_TEST(restarted_peer_reset,
+    trudpData *td = trudpInit(0, 0, DatagramEventCb, NULL);
+    cheat_assert(td != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    trudpChannelData *rcv = trudpChannelNew(td, "0", 8001, 0);
+    cheat_assert(rcv != NULL);
+    cheat_yield(); // Exit test if pointer is null.
+
+    size_t packet_length;
+    trudpPacket *packet = trudpPacketDATAcreateNew(0, 0, "A", 2,
+            &packet_length);
+
+    // Packet with id 0 of restarted peer resets channel though it is far
+    // from expected id
+    rcv->receiveExpectedId = 0x80000010;
+    trudpChannelProcessReceivedPacket(rcv, (uint8_t *)packet, packet_length);
+    cheat_assert(trudpPacketGetType((trudpPacket *)dgram_packet) == TRU_RESET);
+    cheat_assert(trudpReceiveQueueSize(rcv->receiveQueue) == 0);
+
+    // Repeated packet with id 0 is skipped when id 1 is expected
+    rcv->receiveExpectedId = 1;
+    uint32_t dropped = rcv->stat.packets_receive_dropped;
+    trudpChannelProcessReceivedPacket(rcv, (uint8_t *)packet, packet_length);
+    cheat_assert(trudpPacketGetType((trudpPacket *)dgram_packet) == TRU_ACK);
+    cheat_assert(rcv->stat.packets_receive_dropped == dropped + 1);
+
+    trudpPacketCreatedFree(packet);
+    trudpChannelDestroy(rcv);
+    trudpDestroy(td);
+)
+
+CHEAT_TEST(congestion_control,
+    trudpCc cc;
+    uint64_t ts = 1000000;
+
+    // Fixed window
+    trudpCcInit(&cc, trudpCcGetOps(TRUDP_CC_FIXED));
+    cheat_assert(trudpCcGetWindow(&cc) == NORMAL_S_SIZE);
+    trudpCcOnLoss(&cc, 0, ts);
+    cheat_assert(trudpCcGetWindow(&cc) == NORMAL_S_SIZE);
+
+    // NewReno: slow start doubles window every round trip, loss halves it
+    trudpCcInit(&cc, trudpCcGetOps(TRUDP_CC_RENO));
+    cheat_assert(trudpCcGetWindow(&cc) == TRUDP_CC_INITIAL_CWND);
+    trudpCcOnSend(&cc, 100, ts);
+    trudpCcOnAck(&cc, TRUDP_CC_INITIAL_CWND, 10000, ts);
+    cheat_assert(trudpCcGetWindow(&cc) == 2 * TRUDP_CC_INITIAL_CWND);
+    cheat_assert(cc.pacing_rate > 0);
+    trudpCcOnLoss(&cc, 0, ts);
+    cheat_assert(trudpCcGetWindow(&cc) == TRUDP_CC_INITIAL_CWND);
+    trudpCcOnAck(&cc, TRUDP_CC_INITIAL_CWND, 10000, ts);
+    cheat_assert(trudpCcGetWindow(&cc) == TRUDP_CC_INITIAL_CWND + 1);
+    trudpCcOnLoss(&cc, 1, ts);
+    cheat_assert(trudpCcGetWindow(&cc) == 1);
+
+    // CUBIC: reduce window by 30% at loss, window never exceeds maximum
+    trudpCcInit(&cc, trudpCcGetOps(TRUDP_CC_CUBIC));
+    trudpCcOnAck(&cc, 90, 10000, ts);
+    cheat_assert(trudpCcGetWindow(&cc) == 100);
+    trudpCcOnLoss(&cc, 0, ts);
+    cheat_assert(trudpCcGetWindow(&cc) == 70);
+    trudpCcOnAck(&cc, 10000, 10000, ts + 10000000);
+    cheat_assert(trudpCcGetWindow(&cc) == TRUDP_CC_MAX_CWND);
+)
+
+CHEAT_TEST(token_bucket,
+    trudpTokenBucket tb;
+    uint64_t ts = 1000000;
+
+    // Full bucket may be sent at once, next packet waits for tokens
+    // (rate is 1 byte per usec)
+    trudpTokenBucketInit(&tb, 1000000, 3000);
+    cheat_assert(trudpTokenBucketGetTime(&tb, ts) == ts);
+    trudpTokenBucketConsume(&tb, 3000, ts);
+    cheat_assert(trudpTokenBucketGetTime(&tb, ts) == ts);
+    trudpTokenBucketConsume(&tb, 1000, ts);
+    cheat_assert(trudpTokenBucketGetTime(&tb, ts) == ts + 1001);
+    cheat_assert(trudpTokenBucketGetTime(&tb, ts + 1001) == ts + 1001);
+
+    // Bucket never overflows its size
+    trudpTokenBucketConsume(&tb, 3001, ts + 1000000);
+    cheat_assert(trudpTokenBucketGetTime(&tb, ts + 1000000) > ts + 1000000);
+
+    // Not limited bucket never delays packets
+    trudpTokenBucketSetRate(&tb, 0, ts + 2000000);
+    trudpTokenBucketConsume(&tb, 100000, ts + 2000000);
+    cheat_assert(trudpTokenBucketGetTime(&tb, ts + 2000000) == ts + 2000000);
+)
+
+#if defined(TEONET_OS_LINUX)
+CHEAT_TEST(udp_send_batch_coalescing,
+    struct sockaddr_storage addr_a, addr_b;
+    socklen_t addr_a_len, addr_b_len;
+    cheat_assert(!trudpUdpMakeAddr("127.0.0.1", 8000,
+            (struct sockaddr *)&addr_a, &addr_a_len));
+    cheat_assert(!trudpUdpMakeAddr("127.0.0.1", 8001,
+            (struct sockaddr *)&addr_b, &addr_b_len));
+    cheat_yield();
+
+    uint8_t buffer[1400] = { 0 };
+    trudpUdpSendBatch *batch = trudpUdpSendBatchNew(128, sizeof(buffer));
+    cheat_assert(batch != NULL);
+    cheat_yield();
+    struct iovec *iovs = (struct iovec *)batch->iovs;
+    batch->gso = 1;
+
+    // Equal datagrams for one peer are coalesced, shorter one is the last
+    // segment, other peer or longer datagram starts next message
+    const size_t lengths[] = { 100, 100, 100, 60, 100, 100, 120 };
+    const int peers[] = { 0, 0, 0, 0, 0, 1, 1 };
+    size_t i;
+    for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        trudpUdpSendBatchAdd(batch, buffer, lengths[i], peers[i] ?
+                (struct sockaddr *)&addr_b : (struct sockaddr *)&addr_a,
+                peers[i] ? addr_b_len : addr_a_len, 0);
+    }
+    cheat_assert(trudpUdpSendBatchMakeMsgs(batch, 0, batch->count) == 4);
+    cheat_assert(batch->msg_datagrams[0] == 4);
+    cheat_assert(batch->msg_datagrams[1] == 1);
+    cheat_assert(batch->msg_datagrams[2] == 1);
+    cheat_assert(batch->msg_datagrams[3] == 1);
+    cheat_assert(iovs[3].iov_len == 60);
+    cheat_assert(iovs[4].iov_base == batch->buffers + 4 * batch->buffer_size);
+
+    // Coalesced message carries segment size
+    struct cmsghdr *cmsg = (struct cmsghdr *)batch->cmsgs;
+    uint16_t segment_size;
+    memcpy(&segment_size, CMSG_DATA(cmsg), sizeof(segment_size));
+    cheat_assert(segment_size == 100);
+
+    // Messages are made from first datagram
+    cheat_assert(trudpUdpSendBatchMakeMsgs(batch, 2, batch->count) == 4);
+    cheat_assert(batch->msg_datagrams[0] == 2);
+
+    // Without GSO each datagram is separate message
+    batch->gso = 0;
+    cheat_assert(trudpUdpSendBatchMakeMsgs(batch, 0, batch->count) ==
+            batch->count);
+    batch->gso = 1;
+
+    // Number of segments is limited
+    batch->count = 0;
+    for (i = 0; i < UDP_GSO_MAX_SEGMENTS + 6; i++) {
+        trudpUdpSendBatchAdd(batch, buffer, 100,
+                (struct sockaddr *)&addr_a, addr_a_len, 0);
+    }
+    cheat_assert(trudpUdpSendBatchMakeMsgs(batch, 0, batch->count) == 2);
+    cheat_assert(batch->msg_datagrams[0] == UDP_GSO_MAX_SEGMENTS);
+    cheat_assert(batch->msg_datagrams[1] == 6);
+
+    // Length of coalesced datagram is limited
+    batch->count = 0;
+    size_t max_segments = UDP_GSO_MAX_LENGTH / sizeof(buffer);
+    for (i = 0; i < max_segments + 2; i++) {
+        trudpUdpSendBatchAdd(batch, buffer, sizeof(buffer),
+                (struct sockaddr *)&addr_a, addr_a_len, 0);
+    }
+    cheat_assert(trudpUdpSendBatchMakeMsgs(batch, 0, batch->count) == 2);
+    cheat_assert(batch->msg_datagrams[0] == max_segments);
+    cheat_assert(batch->msg_datagrams[1] == 2);
+
+    // Shared payload is the second buffer of its datagram
+    batch->count = 0;
+    uint8_t payload_data[80] = { 0 };
+    trudpPayload *payload = trudpPayloadNew(payload_data,
+            sizeof(payload_data));
+    trudpUdpSendBatchAdd(batch, buffer, 100, (struct sockaddr *)&addr_a,
+            addr_a_len, 0);
+    trudpUdpSendBatchAddPayload(batch, buffer, 20, payload,
+            (struct sockaddr *)&addr_a, addr_a_len, 0);
+    trudpUdpSendBatchAdd(batch, buffer, 100, (struct sockaddr *)&addr_a,
+            addr_a_len, 0);
+    trudpPayloadRelease(payload);
+    cheat_assert(trudpUdpSendBatchMakeMsgs(batch, 0, batch->count) == 1);
+    cheat_assert(iovs[1].iov_len == 20);
+    cheat_assert(iovs[2].iov_base == payload->data);
+    cheat_assert(iovs[2].iov_len == sizeof(payload_data));
+    cheat_assert(iovs[3].iov_len == 100);
+
+    trudpUdpSendBatchDestroy(batch);
+)
+#endif
+
+CHEAT_DECLARE(
+    // Fill datagram with its number
+    static void FillDatagram(uint8_t *buffer, size_t length, int number) {
+        memset(buffer, number, length);
+    }
+
+    // Receive datagrams to batch and split coalesced ones, returns number
+    // of datagrams which equal expected
+    static size_t ReceiveDatagrams(int fd, trudpUdpRecvBatch *batch,
+            const size_t *lengths, size_t count) {
+        size_t received = 0, i;
+        uint64_t timeout = teoGetTimestampFull() + 1000000;
+        while (received < count && teoGetTimestampFull() < timeout) {
+            if (trudpUdpRecvBatchReceive(fd, batch, 0) <= 0) continue;
+            for (i = 0; i < batch->count; i++) {
+                uint8_t *data = batch->buffers + i * batch->buffer_size;
+                size_t length = batch->lengths[i], ptr = 0;
+                size_t segment_size = batch->segment_sizes[i] ?
+                        batch->segment_sizes[i] : length;
+                while (ptr < length && received < count) {
+                    size_t len = length - ptr < segment_size ?
+                            length - ptr : segment_size;
+                    if (len != lengths[received] ||
+                            data[ptr] != (uint8_t)received ||
+                            data[ptr + len - 1] != (uint8_t)received) {
+                        return received;
+                    }
+                    received++;
+                    ptr += len;
+                }
+            }
+        }
+        return received;
+    }
+)
+
+CHEAT_TEST(udp_send_batch_loopback,
+    int port_from = 9000, port_to = 9100;
+    int fd_from = trudpUdpBindRaw(&port_from, 1);
+    int fd_to = trudpUdpBindRaw(&port_to, 1);
+    cheat_assert(fd_from >= 0 && fd_to >= 0);
+    cheat_yield();
+    trudpUdpSetNonblock(fd_to);
+    trudpUdpSetGRO(fd_to, 1); // Coalesced datagrams are split if supported
+
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    cheat_assert(!trudpUdpMakeAddr("127.0.0.1", port_to,
+            (struct sockaddr *)&addr, &addr_len));
+    cheat_yield();
+
+    // Mixed batch: same size datagrams, shorter one, datagram with shared
+    // payload and longer one
+    const size_t lengths[] = { 200, 200, 200, 80, 200, 200, 300 };
+    const size_t count = sizeof(lengths) / sizeof(lengths[0]);
+    trudpUdpSendBatch *batch = trudpUdpSendBatchNew(16, 1500);
+    trudpUdpRecvBatch *recv_batch = trudpUdpRecvBatchNew(16, 65536);
+    cheat_assert(batch != NULL && recv_batch != NULL);
+    cheat_yield();
+    batch->gso = !trudpUdpCheckGSO(fd_from);
+
+    uint8_t buffer[1500];
+    size_t i;
+    for (i = 0; i < count; i++) {
+        FillDatagram(buffer, lengths[i], (int)i);
+        if (i == 5) {
+            trudpPayload *payload = trudpPayloadNew(buffer + 50,
+                    lengths[i] - 50);
+            trudpUdpSendBatchAddPayload(batch, buffer, 50, payload,
+                    (struct sockaddr *)&addr, addr_len, 0);
+            trudpPayloadRelease(payload);
+        }
+        else trudpUdpSendBatchAdd(batch, buffer, lengths[i],
+                (struct sockaddr *)&addr, addr_len, 0);
+    }
+    cheat_assert(trudpUdpSendBatchFlush(fd_from, batch) == (int)count);
+    cheat_assert(batch->count == 0);
+
+    // All datagrams are received in order
+    cheat_assert(ReceiveDatagrams(fd_to, recv_batch, lengths, count) ==
+            count);
+
+    trudpUdpSendBatchDestroy(batch);
+    trudpUdpRecvBatchDestroy(recv_batch);
+    teosockClose(fd_from);
+    teosockClose(fd_to);
+)
+
+#if defined(TEONET_OS_LINUX)
+CHEAT_TEST(udp_send_batch_gso_fallback,
+    int port_from = 9200, port_to = 9300;
+    int fd_from = trudpUdpBindRaw(&port_from, 1);
+    int fd_to = trudpUdpBindRaw(&port_to, 1);
+    cheat_assert(fd_from >= 0 && fd_to >= 0);
+    cheat_yield();
+    trudpUdpSetNonblock(fd_to);
+
+    // Kernel rejects GSO on socket without UDP checksums (EINVAL)
+    int gso_supported = !trudpUdpCheckGSO(fd_from), on = 1;
+    setsockopt(fd_from, SOL_SOCKET, SO_NO_CHECK, &on, sizeof(on));
+    setsockopt(fd_from, IPPROTO_UDP, 101 /* UDP_NO_CHECK6_TX */, &on,
+            sizeof(on));
+
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    cheat_assert(!trudpUdpMakeAddr("127.0.0.1", port_to,
+            (struct sockaddr *)&addr, &addr_len));
+    cheat_yield();
+
+    const size_t lengths[] = { 100, 100, 100 };
+    const size_t count = sizeof(lengths) / sizeof(lengths[0]);
+    trudpUdpSendBatch *batch = trudpUdpSendBatchNew(16, 1500);
+    trudpUdpRecvBatch *recv_batch = trudpUdpRecvBatchNew(16, 1500);
+    cheat_assert(batch != NULL && recv_batch != NULL);
+    cheat_yield();
+    batch->gso = 1;
+
+    uint8_t buffer[100];
+    size_t i;
+    for (i = 0; i < count; i++) {
+        FillDatagram(buffer, lengths[i], (int)i);
+        trudpUdpSendBatchAdd(batch, buffer, lengths[i],
+                (struct sockaddr *)&addr, addr_len, 0);
+    }
+
+    // Batch is resent without GSO
+    cheat_assert(trudpUdpSendBatchFlush(fd_from, batch) == (int)count);
+    if (gso_supported) cheat_assert(batch->gso == 0);
+    cheat_assert(ReceiveDatagrams(fd_to, recv_batch, lengths, count) ==
+            count);
+
+    trudpUdpSendBatchDestroy(batch);
+    trudpUdpRecvBatchDestroy(recv_batch);
+    teosockClose(fd_from);
+    teosockClose(fd_to);
+)
+#endif
+
+CHEAT_DECLARE(
+    int gro_received_count;
+
+    static void GroEventCb(void *tcd_pointer, int event, void *data,
+            size_t data_length, void *user_data) {
+        if (event == GOT_DATA) gro_received_count++;
+    }
+)
+
+CHEAT_TEST(udp_receive_batch_gro,
+    int port_from = 9400, port_to = 9500;
+    int fd_from = trudpUdpBindRaw(&port_from, 1);
+    int fd_to = trudpUdpBindRaw(&port_to, 1);
+    cheat_assert(fd_from >= 0 && fd_to >= 0);
+    cheat_yield();
+    trudpUdpSetNonblock(fd_from);
+    trudpUdpSetNonblock(fd_to);
+
+    // Receiver splits datagrams coalesced by GRO to packets
+    trudpData *td = trudpInit(fd_to, port_to, GroEventCb, NULL);
+    cheat_assert(td != NULL);
+    cheat_yield();
+    trudpSetUdpOffload(td, 1);
+
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    cheat_assert(!trudpUdpMakeAddr("127.0.0.1", port_to,
+            (struct sockaddr *)&addr, &addr_len));
+    cheat_yield();
+
+    // Same size DATA packets are sent with GSO if supported
+    const uint32_t count = 4;
+    trudpUdpSendBatch *batch = trudpUdpSendBatchNew(16, 1500);
+    cheat_assert(batch != NULL);
+    cheat_yield();
+    batch->gso = !trudpUdpCheckGSO(fd_from);
+    uint8_t packet[1500], data[100];
+    uint32_t id;
+    for (id = 0; id < count; id++) {
+        memset(data, (int)id, sizeof(data));
+        size_t length = trudpPacketDATAcreate(packet, id, 0, data,
+                sizeof(data));
+        trudpUdpSendBatchAdd(batch, packet, length,
+                (struct sockaddr *)&addr, addr_len, 0);
+    }
+    cheat_assert(trudpUdpSendBatchFlush(fd_from, batch) == (int)count);
+
+    gro_received_count = 0;
+    uint64_t timeout = teoGetTimestampFull() + 1000000;
+    while (gro_received_count < (int)count &&
+            teoGetTimestampFull() < timeout) {
+        trudpProcessReceivedBatch(td, 0);
+    }
+    cheat_assert(gro_received_count == (int)count);
+
+    trudpUdpSendBatchDestroy(batch);
+    trudpDestroy(td);
+    teosockClose(fd_from);
+    teosockClose(fd_to);
+)
+
+#if defined(TEONET_OS_LINUX)
+CHEAT_TEST(shards_steering,
+    trudpShards *shards = trudpShardsNew(9600, 4, NULL, NULL);
+    cheat_assert(shards != NULL);
+    cheat_yield();
+
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    cheat_assert(!trudpUdpMakeAddr("127.0.0.1", shards->port,
+            (struct sockaddr *)&addr, &addr_len));
+    cheat_yield();
+
+    // Kernel delivers datagrams of each peer to shard selected by
+    // trudpShardsGetIndex
+    if (shards->steering) {
+        trudpUdpRecvBatch *batch = trudpUdpRecvBatchNew(1, 1500);
+        int peer, received = 0, shard_received[4] = { 0 };
+        for (peer = 0; peer < 16; peer++) {
+            int port = 9700 + peer;
+            int fd = trudpUdpBindRaw(&port, 1);
+            cheat_assert(fd >= 0);
+            trudpUdpSendto(fd, (uint8_t *)&peer, sizeof(peer),
+                    (struct sockaddr *)&addr, addr_len);
+            size_t i;
+            uint64_t timeout = teoGetTimestampFull() + 1000000;
+            int done = 0;
+            while (!done && teoGetTimestampFull() < timeout) {
+                for (i = 0; i < shards->num; i++) {
+                    if (trudpUdpRecvBatchReceive(shards->shard[i].td->fd,
+                            batch, 1) != 1) continue;
+                    cheat_assert(trudpShardsGetIndex(shards,
+                            (struct sockaddr *)&batch->addrs[0],
+                            batch->addr_lengths[0]) == (int)i);
+                    shard_received[i]++;
+                    received++;
+                    done = 1;
+                }
+            }
+            teosockClose(fd);
+        }
+        cheat_assert(received == 16);
+        cheat_assert(shard_received[0] + shard_received[1] < 16);
+        trudpUdpRecvBatchDestroy(batch);
+    }
+
+    // Without steering program shard of peer is unknown
+    shards->steering = 0;
+    cheat_assert(trudpShardsGetIndex(shards, (struct sockaddr *)&addr,
+            addr_len) == -1);
+    cheat_assert(trudpShardsSubmitSendData(shards, (struct sockaddr *)&addr,
+            addr_len, 0, "data", 5) == -1);
+
+    trudpShardsDestroy(shards);
+)
+#endif
+
 CHEAT_TEST(create_trudp,
     // Create TR-UDP
     trudpData *td = trudpInit(0, 0, NULL, NULL);